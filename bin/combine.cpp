@@ -293,6 +293,9 @@ int main(int argc, char **argv) {
   runtimedef::set("ADDNLL_PRODNLL",1);
   runtimedef::set("ADDNLL_HFNLL",1);
   runtimedef::set("ADDNLL_HISTFUNCNLL",1);
+  runtimedef::set("ADDNLL_SPINZERONLL",1);
+  runtimedef::set("ADDNLL_SPLINENLL",1);
+  runtimedef::set("ADDNLL_BERNSTEINNLL",1);
   runtimedef::set("ADDNLL_ROOREALSUM_CHEAPPROD",1);
  
 
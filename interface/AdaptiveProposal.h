@@ -0,0 +1,53 @@
+#ifndef HiggsAnalysis_CombinedLimit_AdaptiveProposal_h
+#define HiggsAnalysis_CombinedLimit_AdaptiveProposal_h
+
+#include <Rtypes.h>
+
+#include <RooArgSet.h>
+#include <vector>
+
+#include <RooStats/ProposalFunction.h>
+
+/** Adaptive multi-gaussian proposal (Haario et al.)
+ *
+ *  Starts from uncorrelated gaussian steps of width (max-min)/divisor, then 
+ *  after startAfter steps it proposes from a gaussian with the covariance of 
+ *  the chain so far, scaled by 2.38^2/N, re-estimated every updateEvery steps.
+ */
+class AdaptiveProposal : public RooStats::ProposalFunction {
+
+   public:
+      AdaptiveProposal() : RooStats::ProposalFunction() {}
+      AdaptiveProposal(double divisor, unsigned int startAfter=500, unsigned int updateEvery=200) ;
+
+      // Populate xPrime with a new proposed point
+      virtual void Propose(RooArgSet& xPrime, RooArgSet& x);
+
+      // The proposal is a gaussian centered on the current point
+      virtual Bool_t IsSymmetric(RooArgSet& x1, RooArgSet& x2) ;
+
+      // Return the probability of proposing the point x1 given the starting
+      // point x2
+      virtual Double_t GetProposalDensity(RooArgSet& x1, RooArgSet& x2);
+
+      virtual ~AdaptiveProposal() {}
+
+      ClassDef(AdaptiveProposal,1) // Gaussian proposal with covariance learned from the chain
+    
+    private:
+      double divisor_;
+      unsigned int startAfter_, updateEvery_;
+      /// number of points accumulated so far
+      unsigned int n_;
+      /// running mean and sum of squared deviations (dense, n x n) of the chain
+      std::vector<double> mean_, m2_;
+      /// lower triangular factor of the proposal covariance (dense, n x n)
+      std::vector<double> chol_;
+      std::vector<double> step_, delta_;
+
+      void init(const RooArgSet &x) ;
+      void accumulate(const RooArgSet &x) ;
+      bool updateCholesky() ;
+};
+
+#endif
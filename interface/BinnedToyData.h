@@ -0,0 +1,44 @@
+#ifndef HiggsAnalysis_CombinedLimit_BinnedToyData_h
+#define HiggsAnalysis_CombinedLimit_BinnedToyData_h
+
+#include <string>
+#include <vector>
+#include <RooDataSet.h>
+
+// Binned toys as plain arrays: for each channel (bin of the index category of the
+// RooSimultaneous) the contents of all the bins of the generation template, empty
+// ones included, in the same order as the entries of the toy dataset of that channel.
+// The arrays are owned by the generator (toymcoptutils::SinglePdfGenInfo) and are
+// overwritten by each new toy; CachingSimNLL reads them directly.
+class BinnedToyData {
+    public:
+        struct Channel {
+            Channel() : source(0), weights(0) {}
+            std::string label;
+            const void *source;                  // what made the bins (same source = same binning); 0 if not binned
+            const std::vector<double> *weights;  // contents of the bins, 0 if not binned
+        };
+        void resize(unsigned int nch) { channels_.resize(nch); }
+        unsigned int size() const { return channels_.size(); }
+        Channel & operator[](unsigned int ich) { return channels_[ich]; }
+        const Channel & operator[](unsigned int ich) const { return channels_[ich]; }
+        bool empty() const {
+            for (const Channel &ch : channels_) { if (ch.weights) return false; }
+            return true;
+        }
+    private:
+        std::vector<Channel> channels_;
+};
+
+// The RooAbsData for RooStats: a RooDataSet with the same content as a BinnedToyData,
+// and a pointer to it. Copies of this are plain RooDataSets.
+class BinnedToyDataSet : public RooDataSet {
+    public:
+        BinnedToyDataSet(const char *name, const char *title, const RooArgSet &vars, const RooCmdArg &arg1, const RooCmdArg &arg2, const BinnedToyData *binned) :
+            RooDataSet(name, title, vars, arg1, arg2), binned_(binned) {}
+        const BinnedToyData * binned() const { return binned_; }
+    private:
+        const BinnedToyData *binned_;
+};
+
+#endif
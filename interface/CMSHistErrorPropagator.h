@@ -64,11 +64,16 @@ public:
   Double_t analyticalIntegral(Int_t code, const char* rangeName = 0) const;
 
   void setData(RooAbsData const& data) const;
+  // Same, from the values of the observable and the weights of all the entries
+  void setData(std::vector<double> const& xvals, std::vector<double> const& weights) const;
 
   void setAnalyticBarlowBeeston(bool flag) const;
 
   inline FastHisto const& cache() const { return cache_; }
 
+  // Bytes currently allocated for the caches
+  std::size_t memoryUsage() const;
+
   RooArgList wrapperList() const;
   RooArgList const& coefList() const { return coeffs_; }
   RooArgList const& funcList() const { return funcs_; }
@@ -86,6 +91,8 @@ public:
   std::vector<std::vector<unsigned>> bintypes_;
 
   mutable std::vector<double> coeffvals_; //!
+  mutable std::vector<unsigned long> func_versions_; //! cacheVersion() of each function at the last full update
+  mutable unsigned n_incremental_; //! coefficient-only updates since the last full update
   mutable FastHisto valsum_; //!
   mutable FastHisto cache_; //!
   mutable std::vector<double> err2sum_; //!
@@ -106,6 +113,7 @@ public:
 
   void initialize() const;
   void updateCache(int eval = 1) const;
+  void allocBinMods(std::vector<std::vector<double>> & mods) const;
 
   void runBarlowBeeston() const;
 
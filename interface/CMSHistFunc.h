@@ -3,6 +3,7 @@
 #include <ostream>
 #include <vector>
 #include <memory>
+#include <utility>
 #include "RooAbsReal.h"
 #include "RooArgSet.h"
 #include "RooListProxy.h"
@@ -57,6 +58,10 @@ class CMSHistFunc : public RooAbsReal {
     double sigma;
 
     bool meansig_set = false;
+
+    // Integral-morphed templates already computed for a given value of the
+    // horizontal morphing parameter, most recently used first
+    std::vector<std::pair<double, FastTemplate>> hmemo;
   };
 
  public:
@@ -138,7 +143,20 @@ class CMSHistFunc : public RooAbsReal {
   };
 
   inline FastTemplate const& errors() const { return binerrors_; }
+  inline std::vector<FastTemplate> const& storage() const { return storage_; }
+
+  // Replace the templates in storage_ with read-only copies owned elsewhere
+  // (see SharedTemplateStore), and release the private ones. The templates
+  // can't be modified afterwards, and the function should not be written out.
+  void useSharedStorage(std::vector<const double*> const& ptrs);
+  inline bool hasSharedStorage() const { return !shared_storage_.empty(); }
+
+  // Bytes currently allocated for the templates and the evaluation caches
+  // (templates in shared storage are not counted)
+  std::size_t memoryUsage() const;
   inline FastHisto const& cache() const { return rebin_ ? rebin_cache_ : cache_; }
+  // Changes whenever cache() has been recomputed by updateCache()
+  inline unsigned long cacheVersion() const { return cache_version_; }
 
   CMSHistFuncWrapper const* wrapper() const;
 
@@ -189,6 +207,19 @@ class CMSHistFunc : public RooAbsReal {
 
   static bool enable_fast_vertical_; //! not to be serialized
 
+  std::vector<const double*> shared_storage_; //! not to be serialized
+  std::vector<unsigned> shared_sizes_; //! not to be serialized
+  std::vector<unsigned> shared_fullsizes_; //! not to be serialized
+  mutable FastTemplate shared_scratch_; //! not to be serialized
+  // incremented every time cache_ is recomputed
+  mutable unsigned long cache_version_ = 0; //! not to be serialized
+  // scratch space for cdfMorph
+  mutable std::vector<double> morph_xdisn_; //! not to be serialized
+  mutable std::vector<double> morph_sigdisf_; //! not to be serialized
+
+  // max number of morphed templates remembered per Cache::hmemo
+  static const unsigned kMaxHMorphMemo = 4;
+
  private:
   void initialize() const;
   void setGlobalCache() const;
@@ -213,6 +244,14 @@ class CMSHistFunc : public RooAbsReal {
 
   void applyRebin() const;
 
+  // the template at this index in storage_, or a copy of the shared one
+  FastTemplate const& stored(unsigned idx) const;
+  // copies the template at this index into dest, reading the shared one directly
+  void copyStored(unsigned idx, FastTemplate& dest) const;
+  // the values of the template at this index, without copies
+  const double* storedData(unsigned idx) const;
+  unsigned storedSize(unsigned idx) const;
+
   ClassDef(CMSHistFunc, 1)
 };
 
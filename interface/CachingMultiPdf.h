@@ -7,6 +7,7 @@
 #include <RooAddPdf.h>
 #include <RooProduct.h>
 #include <vector>
+#include <memory>
 
 namespace cacheutils {
     class CachingMultiPdf : public CachingPdfBase {
@@ -20,6 +21,12 @@ namespace cacheutils {
         protected:
             const RooMultiPdf * pdf_;
             boost::ptr_vector<CachingPdfBase>  cachingPdfs_;
+            // Values of the composite members (sums, products) for the last few
+            // values of their parameters, so that switching back to a recently
+            // used index is free. Null for members that are CachingPdfs, which
+            // already have such a cache.
+            std::vector<std::unique_ptr<ValuesCache> > memos_;
+            const RooAbsData * lastData_;
     };
 
     class CachingAddPdf : public CachingPdfBase {
@@ -27,6 +34,7 @@ namespace cacheutils {
             CachingAddPdf(const RooAddPdf &pdf, const RooArgSet &obs) ;
             ~CachingAddPdf() ;
             virtual const std::vector<Double_t> & eval(const RooAbsData &data) ;
+            virtual void evalInto(const RooAbsData &data, std::vector<Double_t> &out) ;
             const RooAbsReal *pdf() const { return pdf_; }
             virtual void  setDataDirty() ;
             virtual void  setIncludeZeroWeights(bool includeZeroWeights) ;
@@ -42,6 +50,7 @@ namespace cacheutils {
             CachingProduct(const RooProduct &pdf, const RooArgSet &obs) ;
             ~CachingProduct() ;
             virtual const std::vector<Double_t> & eval(const RooAbsData &data) ;
+            virtual void evalInto(const RooAbsData &data, std::vector<Double_t> &out) ;
             const RooAbsReal *pdf() const { return pdf_; }
             virtual void  setDataDirty() ;
             virtual void  setIncludeZeroWeights(bool includeZeroWeights) ;
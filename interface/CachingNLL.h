@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <map>
+#include <set>
 #include <RooAbsPdf.h>
 #include <RooAddPdf.h>
 #include <RooRealSumPdf.h>
@@ -18,6 +19,7 @@
 #include "HiggsAnalysis/CombinedLimit/interface/SimpleGaussianConstraint.h"
 #include "HiggsAnalysis/CombinedLimit/interface/SimplePoissonConstraint.h"
 #include "HiggsAnalysis/CombinedLimit/interface/SimpleConstraintGroup.h"
+#include "HiggsAnalysis/CombinedLimit/interface/BinnedToyData.h"
 #include <boost/ptr_container/ptr_vector.hpp>
 
 class RooMultiPdf;
@@ -68,6 +70,8 @@ class CachingPdfBase {
         CachingPdfBase() {}
         virtual ~CachingPdfBase() {}
         virtual const std::vector<Double_t> & eval(const RooAbsData &data) = 0;
+        /// fill out with the same values as eval, for callers that keep their own copy
+        virtual void evalInto(const RooAbsData &data, std::vector<Double_t> &out) { out = eval(data); }
         virtual const RooAbsReal *pdf() const = 0;
         virtual void  setDataDirty() = 0;
         virtual void  setIncludeZeroWeights(bool includeZeroWeights) = 0;
@@ -81,6 +85,12 @@ class CachingPdf : public CachingPdfBase {
         const RooAbsReal *pdf() const { return pdf_; }
         virtual void  setDataDirty() { lastData_ = 0; }
         virtual void  setIncludeZeroWeights(bool includeZeroWeights) { includeZeroWeights_ = includeZeroWeights;  setDataDirty(); }
+        /// the components cloned for this object (empty if the pdf is used without cloning)
+        const RooArgSet & clonedPieces() const { return pdfPieces_; }
+        /// all the CachingPdfs currently alive (e.g. to account for the memory of their clones)
+        static const std::set<const CachingPdf *> & instances() { return instances_; }
+    private:
+        static std::set<const CachingPdf *> instances_;
     protected:
         const RooArgSet *obs_;
         RooAbsReal *pdfOriginal_;
@@ -121,9 +131,21 @@ class CachingAddNLL : public RooAbsReal {
         virtual Bool_t isDerived() const { return kTRUE; }
         virtual Double_t defaultErrorLevel() const { return 0.5; }
         void setData(const RooAbsData &data) ;
+        /// if data is the current dataset, refilled with the same entries and only
+        /// different weights, update the weights keeping all the caches and return true
+        bool refreshWeights(const RooAbsData &data) ;
+        /// remember that the current data is made of the bins of this channel of a binned toy,
+        /// the non-empty ones or all of them (as CachingSimNLL::splitWithWeights does). returns false if it isn't
+        bool setBinnedSource(const BinnedToyData::Channel &binned) ;
+        /// if binned comes from the same source as the current data, and has the same empty bins,
+        /// take the weights directly from it keeping all the caches and return true
+        bool setBinnedWeights(const BinnedToyData::Channel &binned) ;
         virtual RooArgSet* getObservables(const RooArgSet* depList, Bool_t valueOnly = kTRUE) const ;
         virtual RooArgSet* getParameters(const RooArgSet* depList, Bool_t stripDisconnected = kTRUE) const ;
         double  sumWeights() const { return sumWeights_; }
+        /// NLL of the saturated model of the current data (a pdf equal to the data binned in
+        /// the observables, as in GoodnessOfFit), computed directly from the weights
+        double  saturatedNLL() const ;
         const RooAbsPdf *pdf() const { return pdf_; }
         void setZeroPoint() ;
         void clearZeroPoint() ;
@@ -137,11 +159,21 @@ class CachingAddNLL : public RooAbsReal {
         RooSetProxy & catParams() { return catParams_; }
     private:
         void setup_();
+        void weightsChanged_();
         void addPdfs_(RooAddPdf *addpdf, bool recursive, const RooArgList & basecoeffs) ;
         RooAbsPdf *pdf_;
         RooSetProxy params_, catParams_;
         const RooAbsData *data_;
         std::vector<Double_t>  weights_, binWidths_;
+        /// observables of the dataset and their values in all the entries, at the last setData
+        std::vector<RooRealVar *> layoutVars_;
+        std::vector<Double_t>  layout_;
+        /// source of the binned toy the current data is made of (0 if none), and which bins were used
+        const void *binnedSource_;
+        std::vector<uint8_t>   binnedUsed_;
+        /// for saturatedNLL: the bin of each weight, and the log of the volume of each bin (empty if not computed yet)
+        mutable std::vector<uint32_t> saturatedBins_;
+        mutable std::vector<Double_t> saturatedLogVolumes_;
         double               sumWeights_;
         bool includeZeroWeights_;
         mutable std::vector<RooAbsReal*> coeffs_;
@@ -149,6 +181,10 @@ class CachingAddNLL : public RooAbsReal {
         mutable boost::ptr_vector<RooAbsReal>  prods_;
         mutable std::vector<RooAbsReal*> integrals_;
         mutable std::vector<std::pair<const RooMultiPdf*,CachingPdfBase*> > multiPdfs_;
+        /// for channels with RooMultiPdfs, the NLL for the last few values of the
+        /// parameters and of the pdf indices (stored as one-element vectors)
+        mutable std::unique_ptr<ValuesCache> multiPdfNLLs_;
+        void clearMultiPdfNLLs_() const { if (multiPdfNLLs_.get()) multiPdfNLLs_->clear(); }
         mutable std::vector<Double_t> partialSum_;
         mutable std::vector<Double_t> workingArea_;
         mutable bool isRooRealSum_, fastExit_;
@@ -170,6 +206,9 @@ class CachingSimNLL  : public RooAbsReal {
         virtual RooArgSet* getObservables(const RooArgSet* depList, Bool_t valueOnly = kTRUE) const ;
         virtual RooArgSet* getParameters(const RooArgSet* depList, Bool_t stripDisconnected = kTRUE) const ;
         void splitWithWeights(const RooAbsData &data, const RooAbsCategory& splitCat, Bool_t createEmptyDataSets) ;
+        /// set the weights of all channels from a binned toy, without going through the dataset. returns false
+        /// if some channel can't (e.g. different empty bins), and then the data has to be set in full with setData
+        bool setBinnedData(const BinnedToyData &binned) ;
         static void setNoDeepLogEvalError(bool noDeep) { noDeepLEE_ = noDeep; }
         void setZeroPoint() ; 
         void clearZeroPoint() ;
@@ -182,6 +221,11 @@ class CachingSimNLL  : public RooAbsReal {
         void setHideConstants(bool flag) { hideConstants_ = flag; }
         void setMaskConstraints(bool flag) ;
         void setMaskNonDiscreteChannels(bool mask) ;
+        /// mask all the channels, leaving only the constraint terms and their parameters.
+        /// Unlike the other masks, this doesn't keep the value of the NLL continuous
+        void setMaskAllChannels(bool mask) ;
+        /// sum of CachingAddNLL::saturatedNLL over the channels that are not masked
+        double saturatedChannelsNLL() const ;
         friend class CachingAddNLL;
         // trap this call, since we don't care about propagating it to the sub-components
         virtual void constOptimizeTestStatistic(ConstOpCode opcode, Bool_t doAlsoTrackingOpt=kTRUE) { }
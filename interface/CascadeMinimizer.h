@@ -34,6 +34,7 @@ class CascadeMinimizer {
         static void  initOptions() ;
         static void  applyOptions(const boost::program_options::variables_map &vm) ;
         static const boost::program_options::options_description & options() { return options_; }
+        static int minosWorkers() { return minosWorkers_; }
         void trivialMinimize(const RooAbsReal &nll, RooRealVar &r, int points=100) const ;
         //void collectIrrelevantNuisances(RooAbsCollection &irrelevant) const ;
 	bool freezeDiscParams(const bool);
@@ -60,6 +61,9 @@ class CascadeMinimizer {
        
         bool iterativeMinimize(double &,int,bool); 
 
+        /// run minos for each parameter in a separate forked process, return the minos status
+        int parallelMinos(const RooArgSet &, int verbose);
+
         void remakeMinimizer() ;
 
         /// options configured from command line
@@ -96,6 +100,10 @@ class CascadeMinimizer {
         static bool firstHesse_, lastHesse_;
         /// storage level for minuit2 (toggles storing of intermediate covariances)
         static int minuit2StorageLevel_;
+        /// number of processes used to run minos on several parameters
+        static int minosWorkers_;
+        /// number of processes used to fit the combinations of discrete indices
+        static int discreteWorkers_;
 
 	static double discreteMinTol_;
 
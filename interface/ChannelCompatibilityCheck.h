@@ -9,6 +9,8 @@
  *
  */
 #include "HiggsAnalysis/CombinedLimit/interface/FitterAlgoBase.h"
+class RooAbsPdf;
+class RooRealVar;
 
 class ChannelCompatibilityCheck : public FitterAlgoBase {
 public:
@@ -21,6 +23,10 @@ public:
 
 protected:
   std::string nameForLabel(const char *label) ;
+  /// run MINOS (or the robust fit) for a single parameter, starting from the minimum in best; returns lo, hi, min68, max68, has95, min95, max95, or nothing if no interval was found
+  std::vector<double> runInterval(RooAbsPdf &pdf, RooAbsData &data, RooRealVar &var, const RooFitResult &best, const RooCmdArg &constrain) ;
+  /// minimize the NLL of pdf and return its value, or NAN if the fit failed
+  double fitNLL(RooAbsPdf &pdf, RooAbsData &data, const RooCmdArg &constrain) ;
 
   static float mu_;
   static bool  fixedMu_;
@@ -30,6 +36,10 @@ protected:
 
   static std::vector<std::string> groups_;
 
+  static int workers_;
+  static int toys_;
+  static double pValue_;
+
   virtual bool runSpecific(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint);
 };
 
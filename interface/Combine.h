@@ -95,6 +95,8 @@ private:
 
   // input-output related variables
   bool saveWorkspace_;
+  bool sharedTemplates_;
+  bool memoryReport_;
   std::string workspaceName_;
   std::string snapshotName_;
   std::string modelConfigName_, modelConfigNameB_;
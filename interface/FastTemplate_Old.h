@@ -52,6 +52,8 @@ class FastTemplate {
         /// return the active size of the template (can be less than the full size if the SetActiveSize
         /// has been used to inform the code that only the first N bins are not empty)
         const unsigned int size() const { return size_; }
+        /// return the number of bytes allocated for the bin contents
+        size_t MemoryUsage() const { return values_.capacity()*sizeof(T); }
         
         /// *this = log(*this) 
         void Log();
@@ -73,6 +75,8 @@ class FastTemplate {
         /// Tell the code that only the first N bins of the template are non-empty,
         /// and so that only those have to be considered when doing operations
         void SetActiveSize(unsigned int size) { size_ = size; }
+        /// Free the memory of the bin contents, leaving an empty template
+        void Release() { size_ = 0; AT().swap(values_); }
 
         void Dump() const ;
 
@@ -124,6 +128,9 @@ class FastHisto : public FastTemplate {
         const T & GetEdge(unsigned int i) const { return binEdges_[i]; }
         const T & GetWidth(unsigned int i) const { return binWidths_[i]; }
 
+        /// return the number of bytes allocated for the bin contents, edges and widths
+        size_t MemoryUsage() const { return (values_.capacity()+binEdges_.capacity()+binWidths_.capacity())*sizeof(T); }
+
     private:
         AT binEdges_;
         AT binWidths_;
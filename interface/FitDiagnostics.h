@@ -14,6 +14,7 @@
 #include <RooFitResult.h>
 #include <boost/utility.hpp>
 #include <map>
+class RooRealVar;
 
 class FitDiagnostics : public FitterAlgoBase {
 public:
@@ -26,6 +27,9 @@ public:
   virtual void applyOptions(const boost::program_options::variables_map &vm) ;
   virtual void setToyNumber(const int) ;
   virtual void setNToys(const int);
+  /// expected yields of pdf in the first nbins bins of the binning of x, normalized to norm: the same as
+  /// createHistogram + Scale(norm/Integral("width")), without making the histogram
+  static void evalBinnedShape(const RooAbsReal &pdf, RooRealVar &x, double norm, int nbins, double *out);
 
 protected:
   virtual bool runSpecific(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint);
@@ -53,6 +57,8 @@ protected:
   static bool       robustHesse_;
   static bool        saveWithUncertsRequested_;
   static bool        ignoreCovWarning_;
+  static std::string shapeUncertaintyMethod_;
+  static int         shapeUncertaintyWorkers_;
   int currentToy_, nToys;
   int overallBins_,overallNorms_,overallNuis_,overallCons_;
   int fitStatus_, numbadnll_;
@@ -89,8 +95,14 @@ protected:
         virtual void  generate(int ntoys) = 0;
         virtual const RooAbsCollection & get(int itoy) = 0;
         virtual const RooAbsCollection & centralValues() = 0;
+        /// covariance of the centralValues(), if known (enables the linear propagation of the uncertainties)
+        virtual const TMatrixDSym * covariance() { return 0; }
   };
   void getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, RooArgSet &out, NuisanceSampler &sampler, TDirectory *fOut, const std::string &postfix,RooAbsData &data);
+  /// normalization and binned shape (as densities) of a process at the current parameter values, in out[0] and out[1..nbins]
+  void evalPrediction(const ShapeAndNorm &sn, int nbins, double *out);
+  /// evalPrediction for all processes at each of the points (values of vars), concatenated; the channels can be split across forked processes
+  void evalPredictions(const std::vector<const ShapeAndNorm *> &procs, const std::vector<int> &nbins, const std::vector<RooRealVar *> &vars, const std::vector<std::vector<double> > &points, std::vector<std::vector<double> > &out);
 
   class CovarianceReSampler : public NuisanceSampler {
     public:
@@ -98,6 +110,7 @@ protected:
         virtual void  generate(int ntoys) {}
         virtual const RooAbsCollection & get(int) { return res_->randomizePars(); }
         virtual const RooAbsCollection & centralValues() { return res_->floatParsFinal(); }
+        virtual const TMatrixDSym * covariance() { return &res_->covarianceMatrix(); }
     protected:
         RooFitResult *res_;
   };
@@ -10,8 +10,15 @@
  */
 #include "HiggsAnalysis/CombinedLimit/interface/LimitAlgo.h"
 #include "HiggsAnalysis/CombinedLimit/interface/Significance.h"
+#include <map>
+#include <memory>
+#include <vector>
+#include <RooAbsReal.h>
+#include <RooArgSet.h>
 
 class TDirectory;
+class RooAbsPdf;
+class RooRealVar;
 
 class GoodnessOfFit : public LimitAlgo {
 public:
@@ -24,6 +31,7 @@ public:
   virtual void applyOptions(const boost::program_options::variables_map &vm) ;
 
   virtual bool runSaturatedModel(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint);
+  virtual bool runSaturatedModelAnalytic(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint);
   virtual bool runKSandAD(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint, bool kolmo);
   void initKSandAD(RooStats::ModelConfig *mc_s);
   double EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, RooRealVar& observable, bool kolmo);
@@ -46,10 +54,29 @@ protected:
   static std::string setParametersForFit_;
   static std::string setParametersForEval_;
 
+  static bool analyticSaturated_;
+  // For the analytic saturated model: the NLL of the nominal model, kept across toys
+  RooAbsPdf *saturatedSource_ = nullptr;
+  std::unique_ptr<RooAbsReal> saturatedNominalNLL_;
+
   // Return a pdf that matches this data perfectly.
   RooAbsPdf *makeSaturatedPdf(RooAbsData &data);
   mutable std::vector<RooAbsData*> tempData_;
 
+  // For KS and AD: the pdf without constraints, made only once
+  RooAbsPdf *ksadSource_ = nullptr, *ksadPdf_ = nullptr;
+  // The expected CDF of a pdf for KS and AD: the cdf is created only once, and its values
+  // at the upper edges of the bins of the observable are recomputed only for new parameters
+  struct ExpectedCdf {
+    RooRealVar *observable = nullptr;
+    std::unique_ptr<RooAbsReal> cdf;
+    std::unique_ptr<RooArgSet> params;
+    std::vector<double> paramVals;
+    std::vector<double> values; // NAN if not computed yet
+  };
+  std::map<const RooAbsPdf *, ExpectedCdf> expectedCdfs_;
+  ExpectedCdf & expectedCdf(RooAbsPdf &pdf, RooRealVar &observable);
+
 };
 
 
@@ -1,3 +1,6 @@
+#ifndef HiggsAnalysis_CombinedLimit_JacknifeQuantile_h
+#define HiggsAnalysis_CombinedLimit_JacknifeQuantile_h
+
 #include <vector>
 #include <algorithm>
 struct RooAbsData;
@@ -14,6 +17,13 @@ class QuantileCalculator {
         /// Randomize points before sectioning
         void randomizePoints() ;
         std::pair<double,double> quantileAndError(double quantile, Method method);
+
+        /// Find the first element, in increasing order, at which the running sum of the weights goes above
+        /// threshold (or reaches it, if orEqual); return end if it never does. The range is reordered so that
+        /// the elements before it come before it, as in std::nth_element, and sumBefore is set to their weight.
+        /// Same result as sorting and scanning, in linear time on average.
+        template<typename It, typename WeightFunc>
+        static It weightedSelect(It begin, It end, double threshold, bool orEqual, WeightFunc weight, double &sumBefore) ;
     private:
         struct point { 
             float x, w; 
@@ -25,9 +35,39 @@ class QuantileCalculator {
         std::vector<float> quantiles_;
 
         int guessPartitions(int size, double quantile) ;
+        double simpleQuantile(double quantile) const ;
         template<typename T> void import(const std::vector<T> &values, const std::vector<T> &weights) ;
         void partition(int m, bool doJacknife) ;
         void quantiles(double quantile, bool doJacknife);
          
 };
 
+template<typename It, typename WeightFunc>
+It QuantileCalculator::weightedSelect(It begin, It end, double threshold, bool orEqual, WeightFunc weight, double &sumBefore)
+{
+    // the element searched for is always in [lo, hi), and everything before lo comes before it
+    sumBefore = 0;
+    It lo = begin, hi = end;
+    while (lo != hi) {
+        It mid = lo + (hi - lo)/2;
+        std::nth_element(lo, mid, hi);
+        double wleft = 0;
+        for (It it = lo; it != mid; ++it) wleft += weight(*it);
+        double upToMid = sumBefore + wleft + weight(*mid);
+        if (orEqual ? upToMid >= threshold : upToMid > threshold) {
+            double beforeMid = sumBefore + wleft;
+            if (lo != mid && (orEqual ? beforeMid >= threshold : beforeMid > threshold)) {
+                hi = mid;
+            } else {
+                sumBefore = beforeMid;
+                return mid;
+            }
+        } else {
+            sumBefore = upToMid;
+            lo = mid + 1;
+        }
+    }
+    return end;
+}
+
+#endif
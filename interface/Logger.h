@@ -12,6 +12,10 @@
 #include <vector>
 #include <string>
 #include <mutex>
+#include <atomic>
+
+// Define COMBINE_LOGGER_NODEBUG at compile time to drop all the messages
+// of level kLogLevelDebug (Logger::enabled is then constant false for them)
 
 class Logger
 {
@@ -27,6 +31,18 @@ public:
 	// Returns a reference to the singleton Logger object
 	static Logger& instance();
 
+	// Returns true if messages of this level are written out. Check this
+	// before formatting a message in code that is called often.
+	static bool enabled(const std::string& inLogLevel) {
+#ifdef COMBINE_LOGGER_NODEBUG
+		if (inLogLevel == kLogLevelDebug) return false;
+#endif
+		return levelNumber(inLogLevel) >= sMinLevel;
+	}
+
+	// Only write out messages of this level or above (throws on an unknown level)
+	static void setMinLevel(const std::string& inLogLevel);
+
 	// Logs a single message at the given log level
 	void log(const std::string& inMessage, 
 		const std::string& inLogLevel,
@@ -37,11 +53,14 @@ public:
 		const std::string& inLogLevel,
 		const std::string& inFunction);
 	
+	// Writes out the messages buffered by the calling thread
+	void flush();
+
 	void printLog();
 
 protected:
 	// Static variable for the one-and-only instance  
-	static Logger* pInstance;
+	static std::atomic<Logger*> pInstance;
 
 	// Constant for the filename
 	static const char* const kLogFileName;
@@ -58,11 +77,26 @@ protected:
 		~Cleanup();
 	};
 
-	// Logs message. The thread should own a lock on sMutex
-	// before calling this function.
+	// Messages are formatted into a per-thread buffer without any locking,
+	// and only written to mOutputStream (holding sMutex) when the buffer
+	// is full, on flush(), for errors, and when the thread ends.
+	struct Buffer
+	{
+		std::string text;
+		int nInfo = 0, nDebug = 0, nError = 0;
+		~Buffer();
+	};
+	static Buffer& threadBuffer();
+	static const std::size_t kBufferSize;
+
+	// Appends the message to the buffer of the calling thread
 	void logHelper(const std::string& inMessage, 
 		const std::string& inLogLevel,
 		const std::string& inFunction);
+
+	// Writes out the buffer. The thread should own a lock on sMutex
+	// before calling this function.
+	void writeBuffer(Buffer& buffer);
 	
 
 private:
@@ -70,5 +104,9 @@ private:
 	virtual ~Logger();
 	Logger(const Logger&);
 	Logger& operator=(const Logger&);
+	static int levelNumber(const std::string& inLogLevel) {
+		return (inLogLevel == kLogLevelError ? 2 : (inLogLevel == kLogLevelInfo ? 1 : 0));
+	}
+	static int sMinLevel;
 	static std::mutex sMutex;
 };
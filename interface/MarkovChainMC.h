@@ -23,7 +23,7 @@ public:
     return name;
   }
 private:
-  enum ProposalType { FitP, UniformP, MultiGaussianP, TestP };
+  enum ProposalType { FitP, UniformP, MultiGaussianP, TestP, AdaptiveP };
   static std::string proposalTypeName_;
   static ProposalType proposalType_;
   static bool runMinos_, noReset_, updateProposalParams_, updateHint_;
@@ -37,6 +37,10 @@ private:
   static bool adaptiveBurnIn_;
   /// compute the limit N times
   static unsigned int tries_;
+  /// run the tries in this number of forked processes
+  static unsigned int parallelChains_;
+  /// adaptive proposal: start adapting after this number of steps, and update every this number of steps
+  static unsigned int adaptAfter_, adaptEvery_;
   /// Ignore up to this fraction of results if they're too far from the median
   static float truncatedMeanFraction_;
   /// do adaptive truncated mean
@@ -69,7 +73,15 @@ private:
   mutable TList chains_;
 
   // return number of items in chain, 0 for error
-  int runOnce(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint) const ;
+  // if packedChain is not null, the (slimmed) chain is appended to it instead of being saved or merged
+  int runOnce(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint, std::vector<double> *packedChain = 0) const ;
+  // run all the tries in parallelChains_ forked processes, filling limits; return the total number of items in the chains
+  int runParallel(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, const double *hint, std::vector<double> &limits) const ;
+  /// save and/or keep for merging a chain, according to the options
+  void storeChain(RooStats::MarkovChain *chain) const ;
+  /// flatten a chain to (values of poi..., nll, weight) for each entry, and back
+  void packChain(const RooArgSet &poi, const RooStats::MarkovChain &chain, std::vector<double> &out) const ;
+  RooStats::MarkovChain *unpackChain(const RooArgSet &poi, const std::vector<double> &in, unsigned int start) const ;
 
   RooStats::MarkovChain *mergeChains(const RooArgSet &poi, const std::vector<double> &limits) const;
   void readChains(const RooArgSet &poi, std::vector<double> &limits);
@@ -61,6 +61,10 @@ protected:
   static std::string robustHesseLoad_;
   static std::string robustHesseSave_;
 
+  static int  impactWorkers_;
+  static bool impactWarmStart_;
+  static bool impactHesse_;
+
   static std::string saveSpecifiedFuncs_;
   static std::string saveSpecifiedNuis_;
   static std::string saveSpecifiedIndex_;
@@ -98,6 +98,15 @@ public:
 
     }
 
+  const RooAbsReal & xvar() const { return _x.arg(); }
+
+  // coefficients of the polynomial in powers of (x-xmin)/(xmax-xmin), N+1 of them
+  void getPowerCoefficients(double *coefs) const
+    {
+      updatePowerCoefficients();
+      for (int ipow=0; ipow<=N; ++ipow) coefs[ipow] = _powvector[ipow];
+    }
+
 protected:
 
   typedef ROOT::Math::SMatrix<double,N+1,N+1,ROOT::Math::MatRepStd<double,N+1,N+1> > MType;
@@ -111,11 +120,11 @@ protected:
   mutable VType _powvector;  //coefficients in power basis
   mutable VType _xvector;    //vector of powers of x variable
   
-  Double_t evaluate() const
+  // refresh _powvector if the coefficients changed
+  void updatePowerCoefficients() const
     {
-
+      bool changed = (_bernvector[0] != 1.0); // first call
       _bernvector[0] = 1.0;
-      bool changed = false;
       for (int ipow=1; ipow<=N; ++ipow) {
         double rval = static_cast<RooAbsReal*>(_coefList.at(ipow-1))->getVal();
         if (_bernvector[ipow] != rval) {
@@ -127,6 +136,12 @@ protected:
       if (changed) {
         _powvector = _cmatrix*_bernvector;   
       }
+    }
+
+  Double_t evaluate() const
+    {
+
+      updatePowerCoefficients();
       
       double xmin = _x.min();
       double xmax = _x.max();
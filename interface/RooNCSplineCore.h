@@ -62,6 +62,11 @@ public:
   virtual Int_t getAnalyticalIntegral(RooArgSet& allVars, RooArgSet& analVars, const char* rangeName=0)const = 0;
   virtual Double_t analyticalIntegral(Int_t code, const char* rangeName=0)const = 0;
 
+  // Coordinates of the spline (x[, y[, z]])
+  virtual RooArgList getCoordinates()const = 0;
+  // Values at n points, coords[d][i] being coordinate d of point i, the same as evaluate() would give
+  virtual void evaluateBatch(unsigned int n, const std::vector<const Double_t*>& coords, Double_t* out)const = 0;
+
 protected:
   VerbosityLevel verbosity;
   Bool_t useFloor;
@@ -97,6 +102,9 @@ protected:
   virtual std::vector<std::vector<T>> getCoefficientsAlongDirection(const std::vector<T>& kappas, const TMatrix_t& Ainv, const std::vector<T>& fcnList, BoundaryCondition const& bcBegin, BoundaryCondition const& bcEnd, const Int_t pickBin)const;
   virtual std::vector<T> getCoefficients(const TVector_t& S, const std::vector<T>& kappas, const std::vector<T>& fcnList, const Int_t& bin)const;
 
+  // Batch getWhichBin and getTVar along coord, with binary search; inRange[i] is set to false if testRangeValidity fails
+  void getBinsAndTVars(unsigned int n, const Double_t* vals, const std::vector<T>& coord, const std::vector<T>& kappas, const Int_t whichDirection, std::vector<Int_t>& bins, std::vector<T>& tvars, std::vector<char>& inRange)const;
+
   virtual T evalSplineSegment(const std::vector<T>& coefs, const T& kappa, const T& tup, const T& tdn, Bool_t doIntegrate=false)const;
 
 
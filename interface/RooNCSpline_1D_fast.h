@@ -18,6 +18,7 @@ protected:
 
   std::vector<T> kappaX;
   std::vector<std::vector<T>> coefficients;
+  mutable std::vector<T> flatCoefficients; //! coefficients as one array [ix][A,B,C,D], filled by evaluateBatch
 
 public:
   RooNCSpline_1D_fast();
@@ -46,6 +47,9 @@ public:
   virtual Int_t getAnalyticalIntegral(RooArgSet& allVars, RooArgSet& analVars, const char* rangeName=0)const;
   virtual Double_t analyticalIntegral(Int_t code, const char* rangeName=0)const;
 
+  virtual RooArgList getCoordinates()const;
+  virtual void evaluateBatch(unsigned int n, const std::vector<const Double_t*>& coords, Double_t* out)const;
+
 protected:
   virtual void emptyFcnList(){ std::vector<T> tmp; FcnList.swap(tmp); }
 
@@ -26,6 +26,7 @@ protected:
   std::vector<T> kappaX;
   std::vector<T> kappaY;
   std::vector<std::vector<std::vector<std::vector<T>>>> coefficients; // [ix][A_x,B_x,C_x,D_x][iy][A_x_y,B_x_y,C_x_y,D_x_y]
+  mutable std::vector<T> flatCoefficients; //! coefficients as one array [ix][iy][A_x..D_x][A_x_y..D_x_y], filled by evaluateBatch
 
 public:
   RooNCSpline_2D_fast();
@@ -58,6 +59,9 @@ public:
   virtual Int_t getAnalyticalIntegral(RooArgSet& allVars, RooArgSet& analVars, const char* rangeName=0) const;
   virtual Double_t analyticalIntegral(Int_t code, const char* rangeName=0)const;
 
+  virtual RooArgList getCoordinates()const;
+  virtual void evaluateBatch(unsigned int n, const std::vector<const Double_t*>& coords, Double_t* out)const;
+
 protected:
   virtual void emptyFcnList(){ std::vector<std::vector<T>> tmp; FcnList.swap(tmp); }
 
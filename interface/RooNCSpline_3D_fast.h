@@ -37,6 +37,7 @@ protected:
     std::vector<std::vector<T>>
     >>
     >> coefficients; // [ix][A_x,B_x,C_x,D_x][iy][A_x_y,B_x_y,C_x_y,D_x_y][iz][A_x_y_z,B_x_y_z,C_x_y_z,D_x_y_z]
+  mutable std::vector<T> flatCoefficients; //! coefficients as one array [ix][iy][iz][A_x..D_x][A_x_y..D_x_y][A_x_y_z..D_x_y_z], filled by evaluateBatch
 
 public:
   RooNCSpline_3D_fast();
@@ -73,6 +74,9 @@ public:
   virtual Int_t getAnalyticalIntegral(RooArgSet& allVars, RooArgSet& analVars, const char* rangeName=0) const;
   virtual Double_t analyticalIntegral(Int_t code, const char* rangeName=0)const;
 
+  virtual RooArgList getCoordinates()const;
+  virtual void evaluateBatch(unsigned int n, const std::vector<const Double_t*>& coords, Double_t* out)const;
+
 protected:
   virtual void emptyFcnList(){ std::vector<std::vector<std::vector<T>>> tmp; FcnList.swap(tmp); }
 
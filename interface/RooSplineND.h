@@ -53,6 +53,12 @@ different functions after decomposition is performed.
 
 4) Any better linear algebra packages from / rather than ROOT
 
+Evaluation runs over a flat (structure-of-arrays) copy of the rescaled 
+sample points, built on first use. If a cutoff is set (in units of eps), 
+points further away than cutoff*eps are neglected and the remaining ones 
+are found with a kd-tree, so the cost no longer scales with M.
+A cutoff of ~6 neglects terms below exp(-36) relative to the weights.
+
 </p>
 END_HTML
 ************************************************************************/
@@ -60,7 +66,7 @@ END_HTML
 class RooSplineND : public RooAbsReal {
 
    public:
-      RooSplineND() : ndim_(0),M_(0),eps_(3.) {}
+      RooSplineND() : ndim_(0),M_(0),eps_(3.),cutoff_(0.),init_(false) {}
       RooSplineND(const char *name, const char *title, RooArgList &vars, TTree *tree, const char* fName="f", double eps=3., bool rescale=false, std::string cutstring="" ) ;
       RooSplineND(const RooSplineND& other, const char *name) ; 
       RooSplineND(const char *name, const char *title, const RooListProxy &vars, int ndim, int M, double eps, bool rescale, std::vector<double> &w, std::map<int,std::vector<double> > &map, std::map<int,std::pair<double,double> > & ,double,double) ;
@@ -70,6 +76,10 @@ class RooSplineND : public RooAbsReal {
 
       TGraph* getGraph(const char *xvar, double step) ;
 
+      /// neglect sample points further than cutoff*eps (0 = use all points)
+      void setCutoff(double cutoff) { cutoff_ = cutoff; }
+      double getCutoff() const { return cutoff_; }
+
     protected:
         Double_t evaluate() const;
 
@@ -93,9 +103,24 @@ class RooSplineND : public RooAbsReal {
 	double radialFunc(double d2, double eps) const;
 
 	bool rescaleAxis;
-	
 
-  ClassDef(RooSplineND,1) 
+	double cutoff_;
+
+	// rescaled sample points, ndim_ blocks of M_ values (not persisted)
+	mutable std::vector<double> pts_; //!
+	mutable std::vector<double> scale_; //!
+	mutable std::vector<double> work_, work2_; //!
+	mutable std::vector<double> x_; //! rescaled values of vars_, for the kd-tree search
+	// implicit kd-tree: point permutation and split axis at each median, built only if a cutoff is used
+	mutable std::vector<int> kdIdx_; //!
+	mutable std::vector<int> kdDim_; //!
+	mutable bool init_; //!
+
+	void initCache() const;
+	void buildKDTree(int lo, int hi) const;
+	double sumKDTree(int lo, int hi, const double *x, double r2) const;
+
+  ClassDef(RooSplineND,2) 
 };
 
 #endif
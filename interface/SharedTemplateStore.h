@@ -0,0 +1,50 @@
+#ifndef HiggsAnalysis_CombinedLimit_SharedTemplateStore_h
+#define HiggsAnalysis_CombinedLimit_SharedTemplateStore_h
+/** \class SharedTemplateStore
+ *
+ * Node-wide, read-only copy of large immutable arrays (e.g. the template
+ * storage of CMSHistFunc) in a POSIX shared memory segment.
+ * The first process that opens a given key creates and fills the segment,
+ * all the others attach to it, so the arrays are in memory only once per node.
+ * Segments stay in /dev/shm after the jobs finish, so that later jobs can reuse them.
+ *
+ */
+#include <string>
+#include <vector>
+#include <cstddef>
+
+class RooWorkspace;
+
+class SharedTemplateStore {
+    public:
+        explicit SharedTemplateStore(const std::string &key) ;
+        ~SharedTemplateStore() ;
+
+        /// add an array to the layout (before calling open)
+        void add(const double *data, unsigned int size) ;
+        /// create or attach to the segment. return false if it's not possible, in which case nothing is shared
+        bool open() ;
+        /// pointer to the i-th array in the segment
+        const double *get(unsigned int i) const { return data_ ? data_ + offsets_[i] : 0; }
+        /// size of the segment in bytes
+        std::size_t bytes() const { return length_; }
+        const std::string & name() const { return name_; }
+
+        /// move the template storage of all the CMSHistFuncs in the workspace into a shared segment for this key.
+        /// return the number of functions that were moved
+        static unsigned int shareCMSHistFuncs(RooWorkspace &w, const std::string &key, int verbose=0) ;
+    private:
+        std::string name_;
+        std::vector<const double *> inputs_;
+        std::vector<unsigned int> sizes_;
+        std::vector<std::size_t> offsets_;
+        std::size_t length_;
+        void  *addr_;
+        const double *data_;
+
+        unsigned long long layoutHash() const ;
+        bool attach() ;
+        bool create() ;
+};
+
+#endif
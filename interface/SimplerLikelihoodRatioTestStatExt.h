@@ -15,6 +15,8 @@
   <li>Simultaneous pdfs are split at construction time; when evaluating the likelihood, no lookups of components by name are performed.</li>
   <li>The amount of objects created and destroyed for each evaluation is reduced to a minimum.</li>
   <li>Only one loop is performed on the dataset (since only one is necessary), and the data is not copied.</li>
+  <li>The log of the two pdfs at each entry and their expected events are cached: if the next dataset has the same entries
+      up to the weights (as binned toys do) and the parameters are the same, the pdfs are not evaluated again.</li>
 
   </ul>
   Author: Giovanni Petrucciani (UCSD/CMS/CERN), May 2011
@@ -24,6 +26,7 @@
 
 #include <memory>
 #include <stdexcept>
+#include <vector>
 #include <RooAbsPdf.h>
 #include <RooAbsData.h>
 #include <RooSimultaneous.h>
@@ -67,8 +70,31 @@ class SimplerLikelihoodRatioTestStatOpt : public RooStats::TestStatistic {
         /// components of the sim pdfs after factorization, for each bin in sim. category. can contain nulls
         std::vector<RooAbsPdf *> simPdfComponentsNull_, simPdfComponentsAlt_;
 
-        double evalSimNLL(RooAbsData &data,  RooSimultaneous *pdf, std::vector<RooAbsPdf *> &components);
-        double evalSimpleNLL(RooAbsData &data,  RooAbsPdf *pdf);
+        /// terms of one of the two NLLs for each entry of the last dataset
+        struct CachedNLL {
+            std::vector<double> params;    // values of the parameters of the pdf
+            std::vector<double> logVals;   // log of the pdf at each entry
+            std::vector<int> bins;         // channel of each entry, -1 if not computed
+            std::vector<double> expected;  // expected events in each channel, NaN if the pdf can't be extended
+            std::vector<double> fixedTerm; // extended term of a pdf that can't be extended, for fixedObserved events
+            std::vector<int> fixedObserved; // -1 if there's no such term in the channel
+            void reset(unsigned int nentries, unsigned int nchannels) ;
+        };
+        CachedNLL cacheNull_, cacheAlt_;
+        /// values of the observables of each entry of the last dataset
+        std::vector<double> cacheEntries_;
+
+        double evalSimNLL(RooAbsData &data,  RooSimultaneous *pdf, std::vector<RooAbsPdf *> &components, CachedNLL &cache);
+        double evalSimpleNLL(RooAbsData &data,  RooAbsPdf *pdf, CachedNLL &cache);
+        /// extended term of pdf for the given events, remembering in the cache what is needed to recompute it
+        double cacheExtendedTerm(RooAbsPdf &pdf, UInt_t observed, CachedNLL &cache, unsigned int channel);
+        /// NLL from the cached terms, or NaN if some entry with non-zero weight is not there
+        double evalCachedNLL(RooAbsData &data, const CachedNLL &cache);
+        /// return true if the entries of data are the same as in the last dataset (weights apart); if not, remember them
+        bool sameEntries(RooAbsData &data);
+        /// return true if the values of params are the ones in the cache; if not, remember them
+        static bool sameParams(const RooArgSet &params, std::vector<double> &values);
+        static double extendedTerm(double expected, double observed);
         void unrollSimPdf(RooSimultaneous *pdf, std::vector<RooAbsPdf *> &out);
 
 }; // 
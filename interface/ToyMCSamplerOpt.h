@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <RooStats/ToyMCSampler.h>
+#include "HiggsAnalysis/CombinedLimit/interface/BinnedToyData.h"
 struct RooProdPdf;
 struct RooPoisson;
 
@@ -15,6 +16,10 @@ namespace toymcoptutils {
             RooAbsData *generate(const RooDataSet* protoData = NULL, int forceEvents = 0) ;
             RooDataSet *generateAsimov(RooRealVar *&weightVar, double weightScale = 1.0, int verbose = 0) ;
             RooDataSet *generatePseudoAsimov(RooRealVar *&weightVar, int nPoints, double weightScale = 1.0, int verbose = 0) ;
+            /// toy with Poisson fluctuations in each bin of the template (what generate does in Poisson mode),
+            /// with weightVar as weight; the contents of the bins are then also in binWeights()
+            RooDataSet *generatePoisson(RooRealVar *&weightVar) { return generateWithHisto(weightVar, false); }
+            const std::vector<double> & binWeights() const { return binWeights_; }
             const RooAbsPdf * pdf() const { return pdf_; }
             void setCacheTemplates(bool cache) { keepHistoSpec_ = cache; }
             Mode mode() const { return mode_; }
@@ -26,6 +31,7 @@ namespace toymcoptutils {
             TH1        *histoSpec_;
             bool        keepHistoSpec_;
             RooRealVar *weightVar_;
+            std::vector<double> binWeights_;
             RooDataSet *generateWithHisto(RooRealVar *&weightVar, bool asimov, double weightScale = 1.0, int verbose = 0) ;
             RooDataSet *generateCountingAsimov() ;
             void setToExpected(RooProdPdf &prod, RooArgSet &obs) ;
@@ -48,6 +54,7 @@ namespace toymcoptutils {
             RooArgSet                        ownedCrap_;
             std::map<std::string,RooAbsData*> datasetPieces_;
             bool                              copyData_;
+            BinnedToyData                     binned_;
             //std::map<std::string,RooDataSet*> datasetPieces_;
 
     }; 
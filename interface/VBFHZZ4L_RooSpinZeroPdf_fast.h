@@ -7,6 +7,7 @@
 #include "RooConstVar.h"
 #include "RooRealProxy.h"
 #include "RooListProxy.h"
+#include <vector>
 
 
 class VBFHZZ4L_RooSpinZeroPdf_fast : public RooAbsPdf{
@@ -32,6 +33,9 @@ public:
   inline virtual ~VBFHZZ4L_RooSpinZeroPdf_fast(){}
 
   Float_t interpolateFcn(Int_t code, const char* rangeName=0) const;
+  // Coefficients of the components in coefList at the current point (false if the pdf is zero there)
+  bool getCoefficients(std::vector<Float_t>& coefs) const;
+  const RooArgList& getCoefList() const { return coefList; }
   Double_t evaluate() const;
   Int_t getAnalyticalIntegral(RooArgSet& allVars, RooArgSet& analVars, const char* rangeName=0) const;
   Double_t analyticalIntegral(Int_t code, const char* rangeName=0) const;
@@ -0,0 +1,26 @@
+#ifndef VectorizedBernsteinFast_h
+#define VectorizedBernsteinFast_h
+
+#include <RooAbsData.h>
+#include <vector>
+
+template<int N> class RooBernsteinFast;
+
+// Batch evaluation of RooBernsteinFast<N>. The powers of the rescaled x of all the
+// entries of the dataset (the basis matrix) are computed once; for each point only
+// the N+1 power-basis coefficients are computed, and the values are the product of
+// the matrix with them, normalized with the analytical integral of the polynomial.
+template<int N>
+class VectorizedBernsteinFast {
+    public:
+        VectorizedBernsteinFast(const RooBernsteinFast<N> &pdf, const RooAbsData &data, bool includeZeroWeights=false) ;
+        void fill(std::vector<Double_t> &out) const ;
+    private:
+        const RooBernsteinFast<N> * pdf_;
+        unsigned int nentries_;
+        Double_t xrange_;              // xmax - xmin
+        std::vector<Double_t> basis_;  // x^1 ... x^N, one block of nentries_ per power
+        mutable Double_t coefs_[N+1];
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define VectorizedCBShape_h
 
 #include <RooCBShape.h>
+#include "HiggsAnalysis/CombinedLimit/interface/RooDoubleCBFast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/GaussExp.h"
 #include <RooAbsData.h>
 #include <vector>
 #include <cmath>
@@ -38,4 +40,79 @@ class VectorizedCBShape {
         void cbCB(double* __restrict__ t, unsigned int n, double norm, double* __restrict__ out,  double* __restrict__ work2) const ;
 };
 
+// x values of the entries of a dataset, and the same values sorted (if they were
+// not already), for the batch evaluators that split the entries in regions of x
+class VectorizedSortedX {
+    public:
+        // read the values of x for the entries with non-zero weight (or all of them)
+        void init(const RooRealVar &x, const RooAbsData &data, bool includeZeroWeights) ;
+        unsigned int size() const { return xvals_.size(); }
+        const std::vector<Double_t> & values() const { return xvals_; }
+        const std::vector<Double_t> & sorted() const { return (xindex_.empty() ? xvals_ : xsorted_); }
+        // true if values() were already sorted, so that sorted() is the same
+        bool isSorted() const { return xindex_.empty(); }
+        // out[xindex[i]] = sortedvals[i], i.e. from the order of sorted() back to that of values()
+        void unsort(const std::vector<Double_t> &sortedvals, std::vector<Double_t> &out) const ;
+        // the same two steps on explicit vectors, also used by VectorizedCBShape in its pre-sort modes:
+        // index = permutation that sorts vals, sorted[i] = vals[index[i]]; and out[index[i]] = sortedvals[i]
+        static void sort(const std::vector<Double_t> &vals, std::vector<int> &index, std::vector<Double_t> &sorted) ;
+        static void unsort(const std::vector<int> &index, const std::vector<Double_t> &sortedvals, std::vector<Double_t> &out) ;
+    private:
+        std::vector<Double_t> xvals_;
+        std::vector<int> xindex_;     // empty if xvals_ is already sorted
+        std::vector<Double_t> xsorted_;
+};
+
+// Same strategy as VectorizedCBShape in its default mode (pre-sorted x, vdt fast math),
+// with three regions: left tail, gaussian core, right tail. The integral is the one of
+// the pdf, recomputed only when the parameters change.
+class VectorizedDoubleCBFast {
+    class Worker : public RooDoubleCBFast {
+        public:
+            Worker(const RooDoubleCBFast &g) : RooDoubleCBFast(g, "") {}
+            const RooAbsReal & xvar()      const { return x.arg(); }
+            const RooAbsReal & meanvar()   const { return mean.arg(); }
+            const RooAbsReal & widthvar()  const { return width.arg(); }
+            const RooAbsReal & alpha1var() const { return alpha1.arg(); }
+            const RooAbsReal & n1var()     const { return n1.arg(); }
+            const RooAbsReal & alpha2var() const { return alpha2.arg(); }
+            const RooAbsReal & n2var()     const { return n2.arg(); }
+    };
+    public:
+        VectorizedDoubleCBFast(const RooDoubleCBFast &pdf, const RooAbsData &data, bool includeZeroWeights=false) ;
+        void fill(std::vector<Double_t> &out) const ;
+        double getIntegral() const ;
+    private:
+        const RooDoubleCBFast * pdf_;
+        const RooAbsReal * params_[6]; // mean, width, alpha1, n1, alpha2, n2
+        VectorizedSortedX x_;
+        mutable std::vector<Double_t> work1_, work2_, work3_;
+        mutable double lastParams_[6], lastIntegral_;
+        // out = norm * exp(-0.5*alpha^2) * (1 - alpha/n * (alpha + sign*t))^-n; t is overwritten
+        void tail(double* __restrict__ t, unsigned int n, double alpha, double nn, double sign, double norm, double* __restrict__ out, double* __restrict__ work2) const ;
+};
+
+// GaussExp: gaussian core and exponential right tail, evaluated as VectorizedDoubleCBFast.
+// GaussExp has no analytical integral, so it is computed here, and cached the same way.
+class VectorizedGaussExp {
+    class Worker : public GaussExp {
+        public:
+            Worker(const GaussExp &g) : GaussExp(g, "") {}
+            const RooAbsReal & xvar()  const { return x.arg(); }
+            const RooAbsReal & p0var() const { return p0.arg(); }
+            const RooAbsReal & p1var() const { return p1.arg(); }
+            const RooAbsReal & p2var() const { return p2.arg(); }
+    };
+    public:
+        VectorizedGaussExp(const GaussExp &pdf, const RooAbsData &data, bool includeZeroWeights=false) ;
+        void fill(std::vector<Double_t> &out) const ;
+        double getIntegral() const ;
+    private:
+        const RooRealVar * xvar_;
+        const RooAbsReal * params_[3]; // mean (p0), sigma (p1), start of the tail in sigmas (p2)
+        VectorizedSortedX x_;
+        mutable std::vector<Double_t> work1_, work2_, work3_;
+        mutable double lastParams_[3], lastIntegral_;
+};
+
 #endif
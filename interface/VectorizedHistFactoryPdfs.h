@@ -36,6 +36,7 @@ namespace cacheutils {
             CachingPiecewiseInterpolation(const PiecewiseInterpolation &pdf, const RooArgSet &obs) ;
             ~CachingPiecewiseInterpolation() ;
             virtual const std::vector<Double_t> & eval(const RooAbsData &data) ;
+            virtual void evalInto(const RooAbsData &data, std::vector<Double_t> &out) ;
             const RooAbsReal *pdf() const { return pdf_; }
             virtual void  setDataDirty() ;
             virtual void  setIncludeZeroWeights(bool includeZeroWeights) ;
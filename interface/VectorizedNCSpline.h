@@ -0,0 +1,21 @@
+#ifndef VectorizedNCSpline_h
+#define VectorizedNCSpline_h
+
+#include "HiggsAnalysis/CombinedLimit/interface/RooNCSplineCore.h"
+#include <RooAbsData.h>
+#include <vector>
+
+// Values of a RooNCSpline_*_fast at the entries of a dataset, for splines whose
+// coordinates are all observables: they do not depend on anything else, so they
+// are computed once per dataset with RooNCSplineCore::evaluateBatch.
+class VectorizedNCSpline {
+    public:
+        VectorizedNCSpline(const RooNCSplineCore &spline, const RooAbsData &data, bool includeZeroWeights=false) ;
+        void fill(std::vector<Double_t> &out) const { out = values_; }
+        // true if all the coordinates of the spline are RooRealVars in obs
+        static bool canVectorize(const RooNCSplineCore &spline, const RooArgSet &obs) ;
+    private:
+        std::vector<Double_t> values_;
+};
+
+#endif
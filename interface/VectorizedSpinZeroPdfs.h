@@ -0,0 +1,28 @@
+#ifndef VectorizedSpinZeroPdfs_h
+#define VectorizedSpinZeroPdfs_h
+
+#include <RooAbsData.h>
+#include <vector>
+
+// Batch evaluation of the *_fast HZZ anomalous couplings pdfs (HZZ4L_RooSpinZeroPdf_1D_fast,
+// _2D_fast, _phase_fast, VBFHZZ4L_RooSpinZeroPdf_fast, VVHZZ4L_RooSpinZeroPdf_1D_fast), which
+// are sums of templates with coefficients that only depend on the couplings. The templates are
+// read once for all the entries of the dataset, together with their integrals; then for each
+// point only the coefficients are computed, and used for both the values and the normalization.
+template<typename PdfT>
+class VectorizedSpinZeroPdf {
+    public:
+        VectorizedSpinZeroPdf(const PdfT &pdf, const RooAbsData &data, bool includeZeroWeights=false) ;
+        void fill(std::vector<Double_t> &out) const ;
+        // true if none of the templates depends on anything other than obs, as the values
+        // read in the constructor are then valid for every point of the fit
+        static bool canVectorize(const PdfT &pdf, const RooArgSet &obs) ;
+    private:
+        const PdfT * pdf_;
+        unsigned int nentries_;
+        std::vector<Double_t> templates_;  // values of the components, one block of nentries_ per component
+        std::vector<Double_t> integrals_;  // integrals of the components over the observables
+        mutable std::vector<Float_t> coefs_;
+};
+
+#endif
@@ -265,14 +265,35 @@ protected:
   // For additive morphing, histograms of (fUp-f0)+(fDown-f0) and (fUp-f0)-(fDown-f0)
   // For multiplicative morphing, log(fUp/f0)+log(fDown/f0),  log(fUp/f0)-log(fDown/f0)
   // NOTE: it's the responsibility of the daughter to make sure these are initialized!!!
-  std::vector<Morph> _morphs;  
+  // Once packed (see _packedMorphs) the templates are released, and only restored to be written out.
+  mutable std::vector<Morph> _morphs;  
 
   // Coefficients of the list in _coefList, already dynamic_cast'ed and in a vector
   mutable std::vector<const RooAbsReal *> _morphParams; //! not to be serialized
 
+  // The diff and sum templates of _morphs packed one after the other in a single
+  // block (diff_0, sum_0, diff_1, sum_1, ...), each row being _packedStride long,
+  // of which the first _packedActiveSize bins are used. When not empty, this is
+  // the only copy of the morphs in memory
+  mutable std::vector<double> _packedMorphs; //! not to be serialized
+  mutable unsigned int _packedStride; //! not to be serialized
+  mutable unsigned int _packedActiveSize; //! not to be serialized
+  // Nominal plus all morphs, before the exponential/cropping of syncTotal,
+  // and the coefficient with which each packed row is currently included in it
+  mutable FastTemplate _morphSum; //! not to be serialized
+  mutable std::vector<double> _morphCoeffs; //! not to be serialized
+  // Incremental updates of _morphSum since the last full recomputation
+  mutable unsigned int _nIncremental; //! not to be serialized
+  static const unsigned int kMaxIncrementalUpdates = 200;
+
   // Prepare morphing data for a triplet of templates
   void initMorph(Morph &out, const FastTemplate &nominal, FastTemplate &lo, FastTemplate &hi) const;
 
+  // Move the templates of _morphs into _packedMorphs, and force a full recomputation at the next syncTotal
+  void packMorphs() const ;
+  // Move the templates back from _packedMorphs into _morphs (e.g. before writing the pdf out)
+  void unpackMorphs() const ;
+
   // Do the vertical morphing from nominal value and morphs into cache. 
   // Do not normalize yet, as that depends on the dimension of the template
   void syncTotal(FastTemplate &cache, const FastTemplate &cacheNominal, const FastTemplate &cacheNominalLog) const ;
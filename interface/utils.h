@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <functional>
 #include <unordered_map>
 #include <TGraphAsymmErrors.h>
 #include <TString.h>
@@ -121,6 +122,20 @@ namespace utils {
     RooArgSet returnAllVars(RooWorkspace *);
     bool freezeAllDisassociatedRooMultiPdfParameters(const RooArgSet & multiPdfs, const RooArgSet & allRooMultiPdfParams, bool freeze=true);
 
+    /// Run job(0) ... job(njobs-1) spread over nworkers forked processes, and return what each job returned.
+    /// Results are sent back to the parent through pipes, all read at the same time; a job that throws or doesn't
+    /// report back gives an empty vector, and the missing jobs and failed workers are printed on stderr.
+    /// If reseed is true, RooRandom is reseeded before each job with a seed drawn in the parent, so that the
+    /// random streams depend only on the job index and not on the number of workers; if false, the random
+    /// stream of the parent is not touched.
+    /// Jobs must not write to files or objects owned by the parent (e.g. the output file): they're lost or corrupted.
+    std::vector<std::vector<double> > forkJobs(unsigned int njobs, unsigned int nworkers, const std::function<std::vector<double>(unsigned int)> &job, bool reseed=true) ;
+
+    /// Print the memory allocated by the templates and caches of the binned shape classes (CMSHistFunc, CMSHistErrorPropagator),
+    /// summed per class and per channel of pdf (if it is a RooSimultaneous), together with the resident size of the process.
+    /// The clones made for the NLLs that are still alive are reported separately.
+    void printMemoryReport(const RooWorkspace &w, const RooAbsPdf *pdf) ;
+
     // This is a workaround for a bug (?) in RooAddPdf that limits the number of elements
     // to 100 when de-serialised from a TFile. We have to access a protected array and reallocate
     // it with the correct size
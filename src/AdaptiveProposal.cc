@@ -0,0 +1,109 @@
+#include "HiggsAnalysis/CombinedLimit/interface/AdaptiveProposal.h"
+#include <RooArgSet.h>
+#include <RooRealVar.h>
+#include <iostream>
+#include <cmath>
+#include <TIterator.h>
+#include <RooRandom.h>
+#include <RooStats/RooStatsUtils.h>
+
+AdaptiveProposal::AdaptiveProposal(double divisor, unsigned int startAfter, unsigned int updateEvery) : 
+    RooStats::ProposalFunction(),
+    divisor_(1./divisor),
+    startAfter_(startAfter),
+    updateEvery_(updateEvery ? updateEvery : 1),
+    n_(0)
+{
+}
+
+void AdaptiveProposal::init(const RooArgSet &x) 
+{
+    unsigned int d = x.getSize();
+    mean_.assign(d, 0.);
+    m2_.assign(d*d, 0.);
+    chol_.assign(d*d, 0.);
+    step_.resize(d);
+    delta_.resize(d);
+    RooLinkedListIter it(x.iterator());
+    RooRealVar* var;
+    for (unsigned int i = 0; (var = (RooRealVar*)it.Next()) != NULL; ++i) {
+        chol_[i*d+i] = (var->getMax() - var->getMin()) * divisor_;
+    }
+    n_ = 0;
+}
+
+void AdaptiveProposal::accumulate(const RooArgSet &x) 
+{
+    // Welford update of mean and covariance 
+    unsigned int d = mean_.size();
+    RooLinkedListIter it(x.iterator());
+    RooRealVar* var;
+    ++n_;
+    for (unsigned int i = 0; (var = (RooRealVar*)it.Next()) != NULL; ++i) {
+        delta_[i] = var->getVal() - mean_[i];
+        mean_[i] += delta_[i]/n_;
+    }
+    it = x.iterator();
+    for (unsigned int i = 0; (var = (RooRealVar*)it.Next()) != NULL; ++i) {
+        double after = var->getVal() - mean_[i];
+        for (unsigned int j = 0; j <= i; ++j) m2_[i*d+j] += after * delta_[j];
+    }
+}
+
+bool AdaptiveProposal::updateCholesky() 
+{
+    unsigned int d = mean_.size();
+    if (n_ < 2) return false;
+    double scale = 2.38*2.38/(d*(n_-1));
+    std::vector<double> L(d*d, 0.);
+    for (unsigned int i = 0; i < d; ++i) {
+        for (unsigned int j = 0; j <= i; ++j) {
+            double sum = scale * m2_[i*d+j];
+            for (unsigned int k = 0; k < j; ++k) sum -= L[i*d+k]*L[j*d+k];
+            if (i == j) {
+                if (sum <= 0) return false; // e.g. a parameter that was never moved: keep the old proposal
+                L[i*d+i] = std::sqrt(sum);
+            } else {
+                L[i*d+j] = sum / L[j*d+j];
+            }
+        }
+    }
+    chol_.swap(L);
+    return true;
+}
+
+// Populate xPrime with a new proposed point
+void AdaptiveProposal::Propose(RooArgSet& xPrime, RooArgSet& x )
+{
+   if (mean_.size() != (unsigned int) x.getSize()) init(x);
+   accumulate(x);
+   if (n_ >= startAfter_ && n_ % updateEvery_ == 0) updateCholesky();
+
+   RooStats::SetParameters(&x, &xPrime);
+   unsigned int d = mean_.size();
+   for (unsigned int i = 0; i < d; ++i) step_[i] = RooRandom::gaussian();
+   RooLinkedListIter it(xPrime.iterator());
+   RooRealVar* var;
+   for (unsigned int i = 0; (var = (RooRealVar*)it.Next()) != NULL; ++i) {
+        double dx = 0;
+        for (unsigned int j = 0; j <= i; ++j) dx += chol_[i*d+j]*step_[j];
+        double val = var->getVal() + dx, max = var->getMax(), min = var->getMin(), len = max - min;
+        while (val > max) val -= len;
+        while (val < min) val += len;
+        var->setVal(val);
+   }
+}
+
+Bool_t AdaptiveProposal::IsSymmetric(RooArgSet& x1, RooArgSet& x2) {
+   return true;
+}
+
+// Return the probability of proposing the point x1 given the starting
+// point x2
+Double_t AdaptiveProposal::GetProposalDensity(RooArgSet& x1,
+                                          RooArgSet& x2)
+{
+   return 1.0; // should not be needed
+}
+
+ClassImp(AdaptiveProposal)
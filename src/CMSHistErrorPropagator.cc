@@ -4,6 +4,7 @@
 #include <vector>
 #include <ostream>
 #include <memory>
+#include <cmath>
 #include "Math/ProbFuncMathCore.h"
 #include "Math/QuantFuncMathCore.h"
 #include "RooRealProxy.h"
@@ -17,6 +18,10 @@
 
 #define HFVERBOSE 0
 
+// Number of consecutive coefficient-only (incremental) updates after which
+// the sums are rebuilt from scratch, to stop rounding errors accumulating
+static const unsigned kMaxIncrementalUpdates = 200;
+
 CMSHistErrorPropagator::CMSHistErrorPropagator() : initialized_(false) {}
 
 CMSHistErrorPropagator::CMSHistErrorPropagator(const char* name,
@@ -86,9 +91,12 @@ void CMSHistErrorPropagator::initialize() const {
   cache_.Clear();
   err2sum_.resize(nb, 0.);
   toterr_.resize(nb, 0.);
-  binmods_.resize(nf, std::vector<double>(nb, 0.));
-  scaledbinmods_.resize(nf, std::vector<double>(nb, 0.));
+  // binmods_ and scaledbinmods_ are only allocated when first needed, see
+  // allocBinMods()
   coeffvals_.resize(nf, 0.);
+  // make sure the first update is a full one
+  func_versions_.assign(nf, ~0ul);
+  n_incremental_ = 0;
 
   sentry_.addVars(coeffs_);
   binsentry_.addVars(binpars_);
@@ -99,6 +107,11 @@ void CMSHistErrorPropagator::initialize() const {
   initialized_ = true;
 }
 
+void CMSHistErrorPropagator::allocBinMods(std::vector<std::vector<double>> & mods) const {
+  if (mods.size()) return;
+  mods.resize(vfuncs_.size(), std::vector<double>(valsum_.size(), 0.));
+}
+
 
 void CMSHistErrorPropagator::updateCache(int eval) const {
   initialize();
@@ -107,21 +120,46 @@ void CMSHistErrorPropagator::updateCache(int eval) const {
   std::cout << "Sentry: " << sentry_.good() << "\n";
 #endif
   if (!sentry_.good() || eval != last_eval_) {
+    // If none of the shapes moved since the last full update we only need
+    // to add (c_new - c_old) * shape for the coefficients that changed
+    bool full = (n_incremental_ >= kMaxIncrementalUpdates);
     for (unsigned i = 0; i < vfuncs_.size(); ++i) {
       vfuncs_[i]->updateCache();
-      coeffvals_[i] = vcoeffs_[i]->getVal();
+      if (vfuncs_[i]->cacheVersion() != func_versions_[i]) full = true;
+      // a delta from or to a non-finite coefficient would spoil the sums until the next full update
+      if (!std::isfinite(coeffvals_[i]) || !std::isfinite(vcoeffs_[i]->getVal())) full = true;
     }
 
-    valsum_.Clear();
-    std::fill(err2sum_.begin(), err2sum_.end(), 0.);
-    for (unsigned i = 0; i < vfuncs_.size(); ++i) {
-      vectorized::mul_add(valsum_.size(), coeffvals_[i], &(vfuncs_[i]->cache()[0]), &valsum_[0]);
-      vectorized::mul_add_sqr(valsum_.size(), coeffvals_[i], &(vfuncs_[i]->errors()[0]), &err2sum_[0]);
+    if (full) {
+      valsum_.Clear();
+      std::fill(err2sum_.begin(), err2sum_.end(), 0.);
+      for (unsigned i = 0; i < vfuncs_.size(); ++i) {
+        coeffvals_[i] = vcoeffs_[i]->getVal();
+        func_versions_[i] = vfuncs_[i]->cacheVersion();
+        vectorized::mul_add(valsum_.size(), coeffvals_[i], &(vfuncs_[i]->cache()[0]), &valsum_[0]);
+        vectorized::mul_add_sqr(valsum_.size(), coeffvals_[i], &(vfuncs_[i]->errors()[0]), &err2sum_[0]);
+      }
+      n_incremental_ = 0;
+    } else {
+      for (unsigned i = 0; i < vfuncs_.size(); ++i) {
+        double c = vcoeffs_[i]->getVal();
+        if (c == coeffvals_[i]) continue;
+        vectorized::mul_add(valsum_.size(), c - coeffvals_[i], &(vfuncs_[i]->cache()[0]), &valsum_[0]);
+        vectorized::sqr_mul_add(valsum_.size(), c * c - coeffvals_[i] * coeffvals_[i], &(vfuncs_[i]->errors()[0]), &err2sum_[0]);
+        coeffvals_[i] = c;
+      }
+      // cancellations can leave a tiny negative sum of squares
+      for (unsigned j = 0; j < valsum_.size(); ++j) {
+        if (err2sum_[j] < 0.) err2sum_[j] = 0.;
+      }
+      ++n_incremental_;
     }
     vectorized::sqrt(valsum_.size(), &err2sum_[0], &toterr_[0]);
     cache_ = valsum_;
 
     if (eval == 0 && bintypes_.size()) {
+      allocBinMods(binmods_);
+      allocBinMods(scaledbinmods_);
       for (unsigned j = 0; j < valsum_.size(); ++j) {
         if (bintypes_[j][0] == 1) {
 #if HFVERBOSE > 1
@@ -170,6 +208,7 @@ void CMSHistErrorPropagator::updateCache(int eval) const {
           }
         }
       } else {
+        allocBinMods(scaledbinmods_);
         for (unsigned i = 0; i < bintypes_[j].size(); ++i) {
           if (bintypes_[j][i] == 2) {
             // Poisson: this is a multiplier on the process yield
@@ -459,6 +498,11 @@ void CMSHistErrorPropagator::applyErrorShifts(unsigned idx,
   // if (bintypes_.size() == 0) return;
   // std::cout << "Start of function\n";
   updateCache(0);
+  // Nothing to apply if no bin has ever been modified
+  if (scaledbinmods_.empty()) {
+    result.CopyValues(nominal);
+    return;
+  }
   for (unsigned i = 0; i < result.size(); ++i) {
     result[i] = nominal[i] + scaledbinmods_[idx][i];
   }
@@ -473,6 +517,16 @@ std::unique_ptr<RooArgSet> CMSHistErrorPropagator::getSentryArgs() const {
   return args;
 }
 
+std::size_t CMSHistErrorPropagator::memoryUsage() const {
+  std::size_t res = valsum_.MemoryUsage() + cache_.MemoryUsage();
+  res += (err2sum_.capacity() + toterr_.capacity() + coeffvals_.capacity() +
+          data_.capacity()) * sizeof(double);
+  for (auto const& v : binmods_) res += v.capacity() * sizeof(double);
+  for (auto const& v : scaledbinmods_) res += v.capacity() * sizeof(double);
+  for (auto const& v : bintypes_) res += v.capacity() * sizeof(unsigned);
+  return res;
+}
+
 Double_t CMSHistErrorPropagator::evaluate() const {
   updateCache(1);
   return cache().GetAt(x_);
@@ -536,6 +590,15 @@ void CMSHistErrorPropagator::setData(RooAbsData const& data) const {
   }
 }
 
+void CMSHistErrorPropagator::setData(std::vector<double> const& xvals, std::vector<double> const& weights) const {
+  updateCache(1);
+  data_.clear();
+  data_.resize(cache_.fullsize(), 0.);
+  for (unsigned i = 0; i < weights.size(); ++i) {
+    data_[cache_.FindBin(xvals[i])] = weights[i];
+  }
+}
+
 RooArgList CMSHistErrorPropagator::wrapperList() const {
   RooArgList result;
   for (int i = 0; i < funcs_.getSize(); ++i) {
@@ -4,6 +4,7 @@
 #include <vector>
 #include <ostream>
 #include <memory>
+#include <algorithm>
 #include "RooRealProxy.h"
 #include "RooArgSet.h"
 #include "RooAbsData.h"
@@ -120,7 +121,10 @@ CMSHistFunc::CMSHistFunc(CMSHistFunc const& other, const char* name)
       vtype_(other.vtype_),
       divide_by_width_(other.divide_by_width_),
       vsmooth_par_(other.vsmooth_par_),
-      fast_vertical_(false) {
+      fast_vertical_(false),
+      shared_storage_(other.shared_storage_),
+      shared_sizes_(other.shared_sizes_),
+      shared_fullsizes_(other.shared_fullsizes_) {
   // initialize();
 }
 
@@ -180,6 +184,9 @@ void CMSHistFunc::setActiveBins(unsigned bins) {
   for (unsigned i = 0; i < storage_.size(); ++i) {
     storage_[i].SetActiveSize(bins);
   }
+  for (unsigned i = 0; i < shared_sizes_.size(); ++i) {
+    shared_sizes_[i] = bins;
+  }
   resetCaches();
   setGlobalCache();
 }
@@ -233,8 +240,66 @@ void CMSHistFunc::prepareStorage() {
   storage_[getIdx(0, 0, 0, 0)] = cache_;
 }
 
+void CMSHistFunc::useSharedStorage(std::vector<const double*> const& ptrs) {
+  assert(ptrs.size() == storage_.size());
+  shared_sizes_.resize(storage_.size());
+  shared_fullsizes_.resize(storage_.size());
+  for (unsigned i = 0; i < storage_.size(); ++i) {
+    shared_sizes_[i] = storage_[i].size();
+    shared_fullsizes_[i] = storage_[i].fullsize();
+  }
+  // swap with fresh templates, so that the memory is actually released
+  std::vector<FastTemplate>(storage_.size()).swap(storage_);
+  shared_storage_ = ptrs;
+}
+
+FastTemplate const& CMSHistFunc::stored(unsigned idx) const {
+  if (shared_storage_.empty()) return storage_[idx];
+  unsigned n = shared_fullsizes_[idx];
+  if (shared_scratch_.fullsize() != n) shared_scratch_ = FastTemplate(n);
+  const double* src = shared_storage_[idx];
+  for (unsigned i = 0; i < n; ++i) shared_scratch_[i] = src[i];
+  shared_scratch_.SetActiveSize(shared_sizes_[idx]);
+  return shared_scratch_;
+}
+
+void CMSHistFunc::copyStored(unsigned idx, FastTemplate& dest) const {
+  if (shared_storage_.empty()) {
+    dest = storage_[idx];
+    return;
+  }
+  unsigned n = shared_fullsizes_[idx];
+  if (dest.fullsize() != n) dest = FastTemplate(n);
+  std::copy(shared_storage_[idx], shared_storage_[idx] + n, &dest[0]);
+  dest.SetActiveSize(shared_sizes_[idx]);
+}
+
+const double* CMSHistFunc::storedData(unsigned idx) const {
+  return shared_storage_.empty() ? &storage_[idx][0] : shared_storage_[idx];
+}
+
+unsigned CMSHistFunc::storedSize(unsigned idx) const {
+  return shared_storage_.empty() ? storage_[idx].size() : shared_sizes_[idx];
+}
+
+std::size_t CMSHistFunc::memoryUsage() const {
+  std::size_t res = cache_.MemoryUsage() + rebin_cache_.MemoryUsage() +
+                    binerrors_.MemoryUsage() + shared_scratch_.MemoryUsage();
+  for (auto const& t : storage_) res += t.MemoryUsage();
+  res += mcache_.capacity() * sizeof(Cache);
+  for (auto const& c : mcache_) {
+    res += c.cdf.MemoryUsage() + c.sum.MemoryUsage() + c.diff.MemoryUsage() +
+           c.step1.MemoryUsage() + c.step2.MemoryUsage();
+    res += (c.x1.capacity() + c.x2.capacity() + c.y.capacity()) * sizeof(double);
+    for (auto const& m : c.hmemo) res += m.second.MemoryUsage();
+  }
+  res += (morph_xdisn_.capacity() + morph_sigdisf_.capacity()) * sizeof(double);
+  return res;
+}
+
 void CMSHistFunc::setShape(unsigned hindex, unsigned hpoint, unsigned vindex,
                            unsigned vpoint, TH1 const& hist) {
+  assert(shared_storage_.empty());
   unsigned idx = getIdx(hindex, hpoint, vindex, vpoint);
 #if HFVERBOSE > 0
   std::cout << "hindex: " << hindex << " hpoint: " << hpoint
@@ -332,7 +397,7 @@ void CMSHistFunc::updateCache() const {
               // define vec of mean vals
               unsigned idx = getIdx(0, hi, v, vi);
               if (!mcache_[idx].meansig_set) {
-                setMeanSig(mcache_[idx], storage_[idx]);
+                setMeanSig(mcache_[idx], stored(idx));
               }
               global_.means[hi] = mcache_[idx].mean;
               global_.sigmas[hi] = mcache_[idx].sigma;
@@ -342,7 +407,7 @@ void CMSHistFunc::updateCache() const {
 
             unsigned cidx = getIdx(0, global_.p1, v, vi);
             // The step1 cache might not have been allocated yet...
-            mcache_[cidx].step1.Resize(storage_[cidx].size());
+            mcache_[cidx].step1.Resize(storedSize(cidx));
             mcache_[cidx].step1.Clear();
 
             for (unsigned hi = 0; hi < hpoints_[0].size(); ++hi) {
@@ -361,20 +426,22 @@ void CMSHistFunc::updateCache() const {
 #endif
 
               unsigned idx = getIdx(0, hi, v, vi);
-
+              // read the template in place, also when it is in shared storage
+              const double* h = storedData(idx);
+              unsigned hsize = storedSize(idx);
 
               // TODO: Scope for optimisation here if we know binning is regular?
               double xl = cache_.GetEdge(0) * global_.slopes[hi] + global_.offsets[hi];
               int il =  cache_.FindBin(xl);
               double xh = 0.;
               int ih = 0;
-              int n = storage_[idx].size();
+              int n = hsize;
 
 #if HFVERBOSE > 0
-              storage_[idx].Dump();
+              stored(idx).Dump();
 #endif
 
-              for (unsigned ib = 0; ib < storage_[idx].size(); ++ib) {
+              for (unsigned ib = 0; ib < hsize; ++ib) {
 
                 double sum = 0.;
 
@@ -388,37 +455,37 @@ void CMSHistFunc::updateCache() const {
 #endif
 
                 if (il != -1 && il != n && il != ih) {
-                  sum += (cache_.GetEdge(il + 1) - xl) * storage_[idx][il];
+                  sum += (cache_.GetEdge(il + 1) - xl) * h[il];
 #if HFVERBOSE > 1
                   std::cout << "Adding from lower edge: to boundary = "
                             << cache_.GetEdge(il + 1)
-                            << "\tcontent = " << storage_[idx][il] << "\n";
+                            << "\tcontent = " << h[il] << "\n";
 #endif
                 }
 
                 for (int step = il + 1; step < ih; ++step) {
-                  sum += cache_.GetWidth(step) * storage_[idx][step];
+                  sum += cache_.GetWidth(step) * h[step];
 #if HFVERBOSE > 1
                   std::cout << "Adding whole bin: bin = " << step
-                            << "\tcontent = " << storage_[idx][step] << "\n";
+                            << "\tcontent = " << h[step] << "\n";
 #endif
                 }
                 // Add the fraction of the last bin
                 if (ih != -1 && ih != n && il != ih) {
-                  sum += (xh - cache_.GetEdge(ih)) * storage_[idx][ih];
+                  sum += (xh - cache_.GetEdge(ih)) * h[ih];
 #if HFVERBOSE > 1
                   std::cout
                       << "Adding to upper edge: from boundary = "
                       << cache_.GetEdge(ih)
-                      << "\tcontent = " << storage_[idx][ih] << "\n";
+                      << "\tcontent = " << h[ih] << "\n";
 #endif
                 }
 
                 if (il == ih && il != -1 && il != n) {
-                  sum += (xh - xl) * storage_[idx][il];
+                  sum += (xh - xl) * h[il];
 #if HFVERBOSE > 1
                   std::cout << "Adding partial bin: bin = " << il
-                            << "\tcontent = " << storage_[idx][il] << "\n";
+                            << "\tcontent = " << h[il] << "\n";
 #endif
                 }
 
@@ -438,13 +505,13 @@ void CMSHistFunc::updateCache() const {
 #if HFVERBOSE > 0
               std::cout << "Setting cdf for " << 0 << " " << global_.p1 << " " << v << " " << vi << "\n";
 #endif
-              setCdf(mcache_[idx1], storage_[idx1]);
+              setCdf(mcache_[idx1], stored(idx1));
             }
             if (!mcache_[idx2].cdf_set) {
 #if HFVERBOSE > 0
               std::cout << "Setting cdf for " << 0 << " " << global_.p2 << " " << v << " " << vi << "\n";
 #endif
-              setCdf(mcache_[idx2], storage_[idx2]);
+              setCdf(mcache_[idx2], stored(idx2));
             }
             if (!mcache_[idx1].interp_set) {
 #if HFVERBOSE > 0
@@ -455,14 +522,26 @@ void CMSHistFunc::updateCache() const {
 #if HFVERBOSE > 0
             std::cout << "Doing horizontal morph for  " << 0 << " " << global_.p1 << " " << v << " " << vi << "\n";
 #endif
-            double x1 = hpoints_[0][global_.p1];
-            double x2 = hpoints_[0][global_.p2];
-            double y1 = mcache_[idx1].integral;
-            double y2 = mcache_[idx2].integral;
-            mcache_[idx1].step1 = cdfMorph(idx1, x1, x2, val);
-            mcache_[idx1].step1.CropUnderflows();
-            double ym = y1 + ((y2 - y1) / (x2 - x1)) * (val - x1);
-            mcache_[idx1].step1.Scale(ym / integrateTemplate(mcache_[idx1].step1));
+            // Scans and toys often come back to the same value of the
+            // morphing parameter, so check whether this was done already
+            auto & hmemo = mcache_[idx1].hmemo;
+            auto hit = std::find_if(hmemo.begin(), hmemo.end(),
+                [val](std::pair<double, FastTemplate> const& m) { return m.first == val; });
+            if (hit != hmemo.end()) {
+              mcache_[idx1].step1 = hit->second;
+              std::rotate(hmemo.begin(), hit, hit + 1);
+            } else {
+              double x1 = hpoints_[0][global_.p1];
+              double x2 = hpoints_[0][global_.p2];
+              double y1 = mcache_[idx1].integral;
+              double y2 = mcache_[idx2].integral;
+              mcache_[idx1].step1 = cdfMorph(idx1, x1, x2, val);
+              mcache_[idx1].step1.CropUnderflows();
+              double ym = y1 + ((y2 - y1) / (x2 - x1)) * (val - x1);
+              mcache_[idx1].step1.Scale(ym / integrateTemplate(mcache_[idx1].step1));
+              if (hmemo.size() >= kMaxHMorphMemo) hmemo.pop_back();
+              hmemo.emplace(hmemo.begin(), val, mcache_[idx1].step1);
+            }
           }
         }
 
@@ -496,31 +575,30 @@ void CMSHistFunc::updateCache() const {
 #if HFVERBOSE > 0
       std::cout << "Checking step 1 (single point)\n";
 #endif
-      for (int v = 0; v < vmorphs_.getSize() + 1; ++v) {
+      // No horizontal morphing: the nominal template is read directly from
+      // the storage in step 2, so no step1 copy is needed here
+      for (int v = 1; v < vmorphs_.getSize() + 1; ++v) {
         unsigned idx = getIdx(0, global_.p1, 0, 0);
-        if (v == 0) {
-          mcache_[idx].step1 = storage_[idx];
-        }
-        if (v >= 1) {
 #if HFVERBOSE > 0
-          std::cout << "Setting sumdiff for vmorph " << v << "\n";
+        std::cout << "Setting sumdiff for vmorph " << v << "\n";
 #endif
-          unsigned idxLo = getIdx(0, global_.p1, v, 0);
-          unsigned idxHi = getIdx(0, global_.p1, v, 1);
-          FastTemplate lo = storage_[idxLo];
-          FastTemplate hi = storage_[idxHi];
-          if (vtype_ == VerticalSetting::QuadLinear) {
-            hi.Subtract(storage_[idx]);
-            lo.Subtract(storage_[idx]);
-          } else if (vtype_ == VerticalSetting::LogQuadLinear) {
-            hi.LogRatio(storage_[idx]);
-            lo.LogRatio(storage_[idx]);
-          }
-          // TODO: could skip the next two lines if .sum and .diff have been set before
-          mcache_[idxLo].sum = storage_[idx];
-          mcache_[idxLo].diff = storage_[idx];
-          FastTemplate::SumDiff(hi, lo, mcache_[idxLo].sum, mcache_[idxLo].diff);
+        unsigned idxLo = getIdx(0, global_.p1, v, 0);
+        unsigned idxHi = getIdx(0, global_.p1, v, 1);
+        FastTemplate lo, hi;
+        copyStored(idxLo, lo);
+        copyStored(idxHi, hi);
+        FastTemplate const& nominal = stored(idx);
+        if (vtype_ == VerticalSetting::QuadLinear) {
+          hi.Subtract(nominal);
+          lo.Subtract(nominal);
+        } else if (vtype_ == VerticalSetting::LogQuadLinear) {
+          hi.LogRatio(nominal);
+          lo.LogRatio(nominal);
         }
+        // TODO: could skip the next two lines if .sum and .diff have been set before
+        mcache_[idxLo].sum = nominal;
+        mcache_[idxLo].diff = nominal;
+        FastTemplate::SumDiff(hi, lo, mcache_[idxLo].sum, mcache_[idxLo].diff);
       }
       hmorph_sentry_.reset();
     }
@@ -535,7 +613,12 @@ void CMSHistFunc::updateCache() const {
         vertical_prev_vals_.resize(vmorphs_.getSize());
       }
       if (!fast_vertical_) {
-        mcache_[idx].step2 = mcache_[idx].step1;
+        // with shared storage, copy the nominal template straight into step2, without the scratch buffer
+        if (global_.single_point) {
+          copyStored(idx, mcache_[idx].step2);
+        } else {
+          mcache_[idx].step2 = mcache_[idx].step1;
+        }
         if (vtype_ == VerticalSetting::LogQuadLinear) {
           mcache_[idx].step2.Log();
         }
@@ -585,6 +668,7 @@ void CMSHistFunc::updateCache() const {
   }
 
   if (rebin_ && (step1 || step2)) applyRebin();
+  if (step1 || step2) ++cache_version_;
 }
 
 
@@ -984,11 +1068,11 @@ FastTemplate CMSHistFunc::cdfMorph(unsigned idx, double par1, double par2,
   int ix = nbn;
 
   int nx3 = c1.y.size();
-  std::vector<double> xdisn(nx3);
-  for (int i = 0; i < nx3; ++i) {
-    xdisn[i] = wt1 * c1.x1[i] + wt2 * c1.x2[i];
-  }
-  std::vector<double> sigdisf(nbe, 0.);
+  std::vector<double> & xdisn = morph_xdisn_;
+  xdisn.resize(nx3);
+  vectorized::lin_comb(nx3, wt1, &c1.x1[0], wt2, &c1.x2[0], &xdisn[0]);
+  std::vector<double> & sigdisf = morph_sigdisf_;
+  sigdisf.assign(nbe, 0.);
 
 
   nx3 = nx3 - 1;
@@ -1059,9 +1143,9 @@ FastTemplate CMSHistFunc::cdfMorph(unsigned idx, double par1, double par2,
       while (xdisn[ix3 + 1] <= x && ix3 < 2 * nbn) {
         ix3 = ix3 + 1;
       }
-      int bin = cache_.FindBin(x);
-      if (bin == -1) bin = 0;
-      // std::cout << "x=" << x << ", bin=" << bin << "\n";
+      // x is the edge between bins ix-1 and ix, for which FindBin(x)
+      // returns ix-1: no need for the binary search
+      int bin = ix > 0 ? ix - 1 : 0;
       Double_t dx2 = cache_.GetWidth(bin);
       if (xdisn[ix3 + 1] - x > 1.1 * dx2) {  // Empty bin treatment
         y = c1.y[ix3 + 1];
@@ -6,13 +6,16 @@
 //#define CachingMultiPdf_VALIDATE
 
 cacheutils::CachingMultiPdf::CachingMultiPdf(const RooMultiPdf &pdf, const RooArgSet &obs) :
-    pdf_(&pdf)
+    pdf_(&pdf),
+    lastData_(0)
 {
     //std::cout << "Making a CachingMultiPdf for " << pdf.GetName() << " with " <<  pdf_->getNumPdfs() << " pdfs." << std::endl;
     for (int i = 0, n = pdf_->getNumPdfs(); i < n; ++i) {
         cachingPdfs_.push_back(makeCachingPdf(pdf_->getPdf(i), &obs));
         //cachingPdfs_.push_back(new CachingPdf(pdf_->getPdf(i), &obs));
         //std::cout << "      MultiPdfAdding " <<  pdf.GetName() << "[" << i << "]: " << pdf_->getPdf(i)->ClassName() << " " << pdf_->getPdf(i)->GetName() << " using " << typeid(cachingPdfs_.back()).name() << std::endl;
+        bool hasCache = (dynamic_cast<CachingPdf *>(&cachingPdfs_.back()) != 0);
+        memos_.emplace_back(hasCache ? 0 : new ValuesCache(*pdf_->getPdf(i), obs));
     }
 #ifdef CachingMultiPdf_VALIDATE
     cachingPdfs_.push_back(new CachingPdf((RooAbsPdf*)&pdf,&obs));
@@ -26,7 +29,17 @@ cacheutils::CachingMultiPdf::~CachingMultiPdf()
 
 const std::vector<Double_t> & cacheutils::CachingMultiPdf::eval(const RooAbsData &data)
 {
-    const std::vector<Double_t> & ret = cachingPdfs_[pdf_->getCurrentIndex()].eval(data);
+    int index = pdf_->getCurrentIndex();
+    if (&data != lastData_) {
+        for (auto & memo : memos_) { if (memo) memo->clear(); }
+        lastData_ = &data;
+    }
+    std::pair<std::vector<Double_t> *, bool> memo(0, false);
+    if (memos_[index]) {
+        memo = memos_[index]->get();
+        if (!memo.second) cachingPdfs_[index].evalInto(data, *memo.first);
+    }
+    const std::vector<Double_t> & ret = memo.first ? *memo.first : cachingPdfs_[index].eval(data);
 #ifdef CachingMultiPdf_VALIDATE
     cachingPdfs_.back().setDataDirty();
     const std::vector<Double_t> & chk = cachingPdfs_.back().eval(data);
@@ -60,6 +73,7 @@ void cacheutils::CachingMultiPdf::setDataDirty()
     for (CachingPdfBase &pdf : cachingPdfs_) {
         pdf.setDataDirty();
     }
+    lastData_ = 0;
 }
 
 void cacheutils::CachingMultiPdf::setIncludeZeroWeights(bool includeZeroWeights) 
@@ -67,6 +81,7 @@ void cacheutils::CachingMultiPdf::setIncludeZeroWeights(bool includeZeroWeights)
     for (CachingPdfBase &pdf : cachingPdfs_) {
         pdf.setIncludeZeroWeights(includeZeroWeights);
     }
+    lastData_ = 0;
 }
 
 
@@ -92,6 +107,12 @@ cacheutils::CachingAddPdf::~CachingAddPdf()
 }
 
 const std::vector<Double_t> & cacheutils::CachingAddPdf::eval(const RooAbsData &data)
+{
+    evalInto(data, work_);
+    return work_;
+}
+
+void cacheutils::CachingAddPdf::evalInto(const RooAbsData &data, std::vector<Double_t> &out)
 {
     double coefSum = 0.0;
     std::vector<double> coefVals(cachingPdfs_.size());
@@ -108,13 +129,12 @@ const std::vector<Double_t> & cacheutils::CachingAddPdf::eval(const RooAbsData &
     }
     const std::vector<Double_t> & one = cachingPdfs_.front().eval(data);
     unsigned int size = one.size();
-    work_.resize(size);
-    std::fill(work_.begin(), work_.end(), 0.0);
+    out.resize(size);
+    std::fill(out.begin(), out.end(), 0.0);
     for (int i = 0, n =  coefVals.size(); i < n; ++i) {
-        vectorized::mul_add(size, coefVals[i], &(i ? cachingPdfs_[i].eval(data) : one)[0], &work_[0]);
+        vectorized::mul_add(size, coefVals[i], &(i ? cachingPdfs_[i].eval(data) : one)[0], &out[0]);
     }
     //std::cout << "Evaluated " << pdf_->GetName() << " of type CachingAddPdf" << std::endl;
-    return work_;
 }
 
 void cacheutils::CachingAddPdf::setDataDirty()
@@ -147,15 +167,20 @@ cacheutils::CachingProduct::~CachingProduct()
 }
 
 const std::vector<Double_t> & cacheutils::CachingProduct::eval(const RooAbsData &data)
+{
+    evalInto(data, work_);
+    return work_;
+}
+
+void cacheutils::CachingProduct::evalInto(const RooAbsData &data, std::vector<Double_t> &out)
 {
     const std::vector<Double_t> & one = cachingPdfs_.front().eval(data);
     unsigned int size = one.size();
-    work_.resize(size);
-    std::copy(one.begin(), one.end(), work_.begin());
+    out.resize(size);
+    std::copy(one.begin(), one.end(), out.begin());
     for (int i = 1, n =  cachingPdfs_.size(); i < n; ++i) {
-        vectorized::mul_inplace(size, &cachingPdfs_[i].eval(data)[0], &work_[0]);
+        vectorized::mul_inplace(size, &cachingPdfs_[i].eval(data)[0], &out[0]);
     }
-    return work_;
 }
 
 void cacheutils::CachingProduct::setDataDirty()
@@ -18,6 +18,18 @@
 #include <HiggsAnalysis/CombinedLimit/interface/VectorizedCB.h>
 #include <HiggsAnalysis/CombinedLimit/interface/VectorizedSimplePdfs.h>
 #include <HiggsAnalysis/CombinedLimit/interface/VectorizedHistFactoryPdfs.h>
+#include <HiggsAnalysis/CombinedLimit/interface/VectorizedSpinZeroPdfs.h>
+#include <HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_1D_fast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_2D_fast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_phase_fast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/VBFHZZ4L_RooSpinZeroPdf_fast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/VVHZZ4L_RooSpinZeroPdf_1D_fast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/VectorizedNCSpline.h>
+#include <HiggsAnalysis/CombinedLimit/interface/VectorizedBernsteinFast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/RooBernsteinFast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/RooNCSpline_1D_fast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/RooNCSpline_2D_fast.h>
+#include <HiggsAnalysis/CombinedLimit/interface/RooNCSpline_3D_fast.h>
 #include <HiggsAnalysis/CombinedLimit/interface/CachingMultiPdf.h>
 #include <HiggsAnalysis/CombinedLimit/interface/RooCheapProduct.h>
 #include <HiggsAnalysis/CombinedLimit/interface/Accumulators.h>
@@ -32,8 +44,17 @@ namespace cacheutils {
     typedef OptimizedCachingPdfT<CMSHistErrorPropagator, CMSHistV<CMSHistErrorPropagator>> CachingCMSHistErrorPropagator;
     typedef OptimizedCachingPdfT<RooGaussian,VectorizedGaussian> CachingGaussPdf;
     typedef OptimizedCachingPdfT<RooCBShape,VectorizedCBShape> CachingCBPdf;
+    typedef OptimizedCachingPdfT<RooDoubleCBFast,VectorizedDoubleCBFast> CachingDoubleCBPdf;
+    typedef OptimizedCachingPdfT<GaussExp,VectorizedGaussExp> CachingGaussExpPdf;
     typedef OptimizedCachingPdfT<RooExponential,VectorizedExponential> CachingExpoPdf;
     typedef OptimizedCachingPdfT<RooPower,VectorizedPower> CachingPowerPdf;
+    typedef OptimizedCachingPdfT<HZZ4L_RooSpinZeroPdf_1D_fast,VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_1D_fast>> CachingSpinZeroPdf1D;
+    typedef OptimizedCachingPdfT<HZZ4L_RooSpinZeroPdf_2D_fast,VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_2D_fast>> CachingSpinZeroPdf2D;
+    typedef OptimizedCachingPdfT<HZZ4L_RooSpinZeroPdf_phase_fast,VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_phase_fast>> CachingSpinZeroPdfPhase;
+    typedef OptimizedCachingPdfT<VBFHZZ4L_RooSpinZeroPdf_fast,VectorizedSpinZeroPdf<VBFHZZ4L_RooSpinZeroPdf_fast>> CachingSpinZeroPdfVBF;
+    typedef OptimizedCachingPdfT<VVHZZ4L_RooSpinZeroPdf_1D_fast,VectorizedSpinZeroPdf<VVHZZ4L_RooSpinZeroPdf_1D_fast>> CachingSpinZeroPdfVV;
+    typedef OptimizedCachingPdfT<RooNCSplineCore,VectorizedNCSpline> CachingNCSpline;
+    template<int N> using CachingBernsteinFast = OptimizedCachingPdfT<RooBernsteinFast<N>,VectorizedBernsteinFast<N>>;
 
     class ReminderSum : public RooAbsReal {
         public:
@@ -248,6 +269,8 @@ std::pair<std::vector<Double_t> *, bool> cacheutils::ValuesCache::get()
     return std::pair<std::vector<Double_t> *, bool>(&items[found]->values, good);
 }
 
+std::set<const cacheutils::CachingPdf *> cacheutils::CachingPdf::instances_;
+
 cacheutils::CachingPdf::CachingPdf(RooAbsReal *pdf, const RooArgSet *obs) :
     obs_(obs),
     pdfOriginal_(pdf),
@@ -260,6 +283,7 @@ cacheutils::CachingPdf::CachingPdf(RooAbsReal *pdf, const RooArgSet *obs) :
     if (runtimedef::get("CACHINGPDF_DIRECT") || pdf->getAttribute("CachingPdf_Direct")) {
         cache_.setDirectMode(true);
     }
+    instances_.insert(this);
 }
 
 cacheutils::CachingPdf::CachingPdf(const CachingPdf &other) :
@@ -274,11 +298,12 @@ cacheutils::CachingPdf::CachingPdf(const CachingPdf &other) :
     if (runtimedef::get("CACHINGPDF_DIRECT") || other.pdfOriginal_->getAttribute("CachingPdf_Direct")) {
         cache_.setDirectMode(true);
     }
-
+    instances_.insert(this);
 }
 
 cacheutils::CachingPdf::~CachingPdf() 
 {
+    instances_.erase(this);
 }
 
 const std::vector<Double_t> & 
@@ -382,6 +407,7 @@ cacheutils::CachingAddNLL::CachingAddNLL(const char *name, const char *title, Ro
     pdf_(pdf),
     params_("params","parameters",this),
     catParams_("catParams","RooCategory parameters",this),
+    binnedSource_(0),
     includeZeroWeights_(includeZeroWeights),
     zeroPoint_(0),
     constantZeroPoint_(0)
@@ -391,6 +417,7 @@ cacheutils::CachingAddNLL::CachingAddNLL(const char *name, const char *title, Ro
     setup_();
     propagateData();
     constantZeroPoint_ = -evaluate();
+    clearMultiPdfNLLs_();
 }
 
 cacheutils::CachingAddNLL::CachingAddNLL(const CachingAddNLL &other, const char *name) :
@@ -398,14 +425,23 @@ cacheutils::CachingAddNLL::CachingAddNLL(const CachingAddNLL &other, const char
     pdf_(other.pdf_),
     params_("params","parameters",this),
     catParams_("catParams","RooCategory parameters",this),
+    binnedSource_(0),
     includeZeroWeights_(other.includeZeroWeights_),
     zeroPoint_(0),
     constantZeroPoint_(0)
 {
     setData(*other.data_);
+    if (other.binnedSource_ != 0 && other.weights_.size() == weights_.size()) {
+        // the weights may come from a binned toy more recent than the dataset
+        weights_ = other.weights_;
+        sumWeights_ = other.sumWeights_;
+        binnedSource_ = other.binnedSource_;
+        binnedUsed_ = other.binnedUsed_;
+    }
     setup_();
     propagateData();
     constantZeroPoint_ = -evaluate();
+    clearMultiPdfNLLs_();
 }
 
 cacheutils::CachingAddNLL::~CachingAddNLL() 
@@ -468,6 +504,9 @@ cacheutils::makeCachingPdf(RooAbsReal *pdf, const RooArgSet *obs) {
     static bool histfuncNll  = runtimedef::get("ADDNLL_HISTFUNCNLL");
     static bool cbNll  = runtimedef::get("ADDNLL_CBNLL");
     static bool hfNll  = runtimedef::get("ADDNLL_HFNLL");
+    static bool spinZeroNll  = runtimedef::get("ADDNLL_SPINZERONLL");
+    static bool splineNll  = runtimedef::get("ADDNLL_SPLINENLL");
+    static bool bernsteinNll  = runtimedef::get("ADDNLL_BERNSTEINNLL");
     static bool verb  = runtimedef::get("ADDNLL_VERBOSE_CACHING");
 
     if (histNll && typeid(*pdf) == typeid(FastVerticalInterpHistPdf)) {
@@ -482,6 +521,10 @@ cacheutils::makeCachingPdf(RooAbsReal *pdf, const RooArgSet *obs) {
         return new CachingGaussPdf(pdf, obs);
     } else if (cbNll && typeid(*pdf) == typeid(RooCBShape)) {
         return new CachingCBPdf(pdf, obs);
+    } else if (cbNll && typeid(*pdf) == typeid(RooDoubleCBFast)) {
+        return new CachingDoubleCBPdf(pdf, obs);
+    } else if (cbNll && typeid(*pdf) == typeid(GaussExp)) {
+        return new CachingGaussExpPdf(pdf, obs);
     } else if (gaussNll && typeid(*pdf) == typeid(RooExponential)) {
 	std::auto_ptr<RooArgSet> params(pdf->getParameters(obs));
 	if(params->getSize()!=1) {return new CachingPdf(pdf,obs);}
@@ -507,6 +550,38 @@ cacheutils::makeCachingPdf(RooAbsReal *pdf, const RooArgSet *obs) {
         return new CachingCMSHistFuncWrapper(pdf, obs);
     } else if (histfuncNll && typeid(*pdf) == typeid(CMSHistErrorPropagator)) {
         return new CachingCMSHistErrorPropagator(pdf, obs);
+    } else if (spinZeroNll && typeid(*pdf) == typeid(HZZ4L_RooSpinZeroPdf_1D_fast) &&
+                VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_1D_fast>::canVectorize(static_cast<HZZ4L_RooSpinZeroPdf_1D_fast&>(*pdf), *obs)) {
+        return new CachingSpinZeroPdf1D(pdf, obs);
+    } else if (spinZeroNll && typeid(*pdf) == typeid(HZZ4L_RooSpinZeroPdf_2D_fast) &&
+                VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_2D_fast>::canVectorize(static_cast<HZZ4L_RooSpinZeroPdf_2D_fast&>(*pdf), *obs)) {
+        return new CachingSpinZeroPdf2D(pdf, obs);
+    } else if (spinZeroNll && typeid(*pdf) == typeid(HZZ4L_RooSpinZeroPdf_phase_fast) &&
+                VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_phase_fast>::canVectorize(static_cast<HZZ4L_RooSpinZeroPdf_phase_fast&>(*pdf), *obs)) {
+        return new CachingSpinZeroPdfPhase(pdf, obs);
+    } else if (spinZeroNll && typeid(*pdf) == typeid(VBFHZZ4L_RooSpinZeroPdf_fast) &&
+                VectorizedSpinZeroPdf<VBFHZZ4L_RooSpinZeroPdf_fast>::canVectorize(static_cast<VBFHZZ4L_RooSpinZeroPdf_fast&>(*pdf), *obs)) {
+        return new CachingSpinZeroPdfVBF(pdf, obs);
+    } else if (spinZeroNll && typeid(*pdf) == typeid(VVHZZ4L_RooSpinZeroPdf_1D_fast) &&
+                VectorizedSpinZeroPdf<VVHZZ4L_RooSpinZeroPdf_1D_fast>::canVectorize(static_cast<VVHZZ4L_RooSpinZeroPdf_1D_fast&>(*pdf), *obs)) {
+        return new CachingSpinZeroPdfVV(pdf, obs);
+    } else if (splineNll && (typeid(*pdf) == typeid(RooNCSpline_1D_fast) || typeid(*pdf) == typeid(RooNCSpline_2D_fast) || typeid(*pdf) == typeid(RooNCSpline_3D_fast)) &&
+                VectorizedNCSpline::canVectorize(static_cast<RooNCSplineCore&>(*pdf), *obs)) {
+        return new CachingNCSpline(pdf, obs);
+    } else if (bernsteinNll && typeid(*pdf) == typeid(RooBernsteinFast<1>)) {
+        return new CachingBernsteinFast<1>(pdf, obs);
+    } else if (bernsteinNll && typeid(*pdf) == typeid(RooBernsteinFast<2>)) {
+        return new CachingBernsteinFast<2>(pdf, obs);
+    } else if (bernsteinNll && typeid(*pdf) == typeid(RooBernsteinFast<3>)) {
+        return new CachingBernsteinFast<3>(pdf, obs);
+    } else if (bernsteinNll && typeid(*pdf) == typeid(RooBernsteinFast<4>)) {
+        return new CachingBernsteinFast<4>(pdf, obs);
+    } else if (bernsteinNll && typeid(*pdf) == typeid(RooBernsteinFast<5>)) {
+        return new CachingBernsteinFast<5>(pdf, obs);
+    } else if (bernsteinNll && typeid(*pdf) == typeid(RooBernsteinFast<6>)) {
+        return new CachingBernsteinFast<6>(pdf, obs);
+    } else if (bernsteinNll && typeid(*pdf) == typeid(RooBernsteinFast<7>)) {
+        return new CachingBernsteinFast<7>(pdf, obs);
     } else {
         if (verb) {
             std::cout << "I don't have an optimized implementation for " << pdf->ClassName() << " (" << pdf->GetName() << ")" << std::endl;
@@ -586,7 +661,13 @@ cacheutils::CachingAddNLL::setup_()
             multiPdfs_.push_back(std::make_pair(mpdf, &*itp));
         }
     }
- 
+    // The discrete profiling flips back and forth between the same few indices,
+    // so remember the NLL of this channel for the last few configurations
+    if (!multiPdfs_.empty()) {
+        RooArgSet allParams(params_);
+        allParams.add(catParams_);
+        multiPdfNLLs_.reset(new ValuesCache(allParams));
+    }
 }
 
 void
@@ -596,6 +677,7 @@ cacheutils::CachingAddNLL::setIncludeZeroWeights(bool includeZeroWeights)
     for (CachingPdfBase &pdf : pdfs_) {
         pdf.setIncludeZeroWeights(includeZeroWeights_);
     }
+    clearMultiPdfNLLs_();
 }
 
 Double_t 
@@ -605,6 +687,13 @@ cacheutils::CachingAddNLL::evaluate() const
     PerfCounter::add("CachingAddNLL::evaluate called");
 #endif
 
+    std::vector<Double_t> *memo = 0;
+    if (multiPdfNLLs_.get()) {
+        std::pair<std::vector<Double_t> *, bool> found = multiPdfNLLs_->get();
+        if (found.second) return found.first->front() + zeroPoint_;
+        memo = found.first;
+    }
+
     std::fill( partialSum_.begin(), partialSum_.end(), 0.0 );
 
     std::vector<RooAbsReal*>::iterator  itc = coeffs_.begin(), edc = coeffs_.end();
@@ -689,6 +778,7 @@ cacheutils::CachingAddNLL::evaluate() const
             }
             std::cout << "WARNING: underflow to " << *its << " in " << pdf_->GetName() << " for bin " << its-bgs << ", weight " << weights_[its-bgs] << std::endl; 
             if (!CachingSimNLL::noDeepLEE_) logEvalError("Number of events is negative or error"); else CachingSimNLL::hasError_ = true;
+            memo = 0; clearMultiPdfNLLs_(); // the error must be reported again next time
             if (fastExit_) { std::cout << "FASTEXIT from " << pdf_->GetName() << std::endl; return 9e9; }
             else *its = 1;
         }
@@ -704,9 +794,10 @@ cacheutils::CachingAddNLL::evaluate() const
     double expectedEvents = (isRooRealSum_ && !expEventsNoNorm ? pdf_->getNorm(data_->get()) : sumCoeff);
     if (expectedEvents <= 0) {
         std::cout << "WARNING: underflow in total event yield for " << pdf_->GetName() << ", expected yield = " << expectedEvents << " (observed: " << sumWeights_ << ")" << std::endl;
-    	Logger::instance().log(std::string(Form("CachingNLL.cc: %d -- underflow (expected events <=0) in total event yield for %s, expected yield = %g (observed: %g)",__LINE__,pdf_->GetName(), expectedEvents, sumWeights_)),Logger::kLogLevelInfo,__func__);
+    	if (Logger::enabled(Logger::kLogLevelInfo)) Logger::instance().log(std::string(Form("CachingNLL.cc: %d -- underflow (expected events <=0) in total event yield for %s, expected yield = %g (observed: %g)",__LINE__,pdf_->GetName(), expectedEvents, sumWeights_)),Logger::kLogLevelInfo,__func__);
         if (!CachingSimNLL::noDeepLEE_) logEvalError("Expected number of events is negative"); else CachingSimNLL::hasError_ = true;
         expectedEvents = 1e-6;
+        memo = 0; clearMultiPdfNLLs_();
     }
     // I can add any arbitrary constant that does not depend on the expected events,
     // so I choose it in order to minimize the number assuming that expectedEvents ~ sumWeights_
@@ -722,6 +813,7 @@ cacheutils::CachingAddNLL::evaluate() const
         // Add correction 
         ret += correctionFactor;
     }
+    if (memo) memo->assign(1, ret);
 
     ret += zeroPoint_;
 
@@ -749,6 +841,7 @@ void
 cacheutils::CachingAddNLL::clearConstantZeroPoint()
 {
     constantZeroPoint_ = 0.0;
+    clearMultiPdfNLLs_();
     setValueDirty();
 }
 
@@ -759,11 +852,25 @@ cacheutils::CachingAddNLL::setData(const RooAbsData &data)
     //utils::printRAD(&data);
     data_ = &data;
     setValueDirty();
+    clearMultiPdfNLLs_();
     weights_.clear(); weights_.reserve(data.numEntries());
+    binnedSource_ = 0;
+    saturatedBins_.clear();
+    // remember where the entries are, so that refreshWeights can recognize new
+    // data with the same layout (e.g. binned toys)
+    layoutVars_.clear(); layout_.clear();
+    RooFIter iter = data.get()->fwdIterator();
+    for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+        RooRealVar *rrv = dynamic_cast<RooRealVar *>(a);
+        if (rrv == 0) { layoutVars_.clear(); break; }
+        layoutVars_.push_back(rrv);
+    }
+    layout_.reserve(data.numEntries() * layoutVars_.size());
     for (int i = 0, n = data.numEntries(); i < n; ++i) {
         data.get(i);
         double w = data.weight();
         if (w || includeZeroWeights_) weights_.push_back(w); 
+        for (RooRealVar *rrv : layoutVars_) layout_.push_back(rrv->getVal());
     }
     sumWeights_ = sumDefault(weights_);
     partialSum_.resize(weights_.size());
@@ -800,17 +907,135 @@ cacheutils::CachingAddNLL::setData(const RooAbsData &data)
     propagateData();
 }
 
+bool
+cacheutils::CachingAddNLL::refreshWeights(const RooAbsData &data)
+{
+    // The cached pdf values and bin lookups only depend on the values of the
+    // observables in each entry, not on the weights, so they stay valid (see weightsChanged_)
+    int n = data.numEntries();
+    if (&data != data_ || layoutVars_.empty() || n != int(weights_.size())) return false;
+    std::vector<Double_t> newWeights(n);
+    std::vector<Double_t>::const_iterator itl = layout_.begin();
+    for (int i = 0; i < n; ++i) {
+        data.get(i);
+        newWeights[i] = data.weight();
+        if (newWeights[i] == 0 && !includeZeroWeights_) return false;
+        for (RooRealVar *rrv : layoutVars_) {
+            if (rrv->getVal() != *itl) return false;
+            ++itl;
+        }
+    }
+    weights_.swap(newWeights);
+    weightsChanged_();
+    return true;
+}
+
+bool
+cacheutils::CachingAddNLL::setBinnedSource(const BinnedToyData::Channel &binned)
+{
+    binnedSource_ = 0;
+    if (binned.source == 0 || binned.weights == 0 || binned.label != GetName()) return false;
+    // the bins have to be the entries of the dataset, so that later only the weights change
+    if (layoutVars_.empty() || layout_.size() != weights_.size() * layoutVars_.size()) return false;
+    const std::vector<double> &bins = *binned.weights;
+    binnedUsed_.resize(bins.size());
+    unsigned int j = 0, n = weights_.size();
+    for (unsigned int i = 0, nbins = bins.size(); i < nbins; ++i) {
+        binnedUsed_[i] = (bins[i] > 0 || includeZeroWeights_);
+        if (!binnedUsed_[i]) continue;
+        if (j == n || weights_[j] != bins[i]) return false;
+        ++j;
+    }
+    if (j != n) return false;
+    binnedSource_ = binned.source;
+    return true;
+}
+
+bool
+cacheutils::CachingAddNLL::setBinnedWeights(const BinnedToyData::Channel &binned)
+{
+    // same as refreshWeights, but without reading back the dataset (which is then left behind)
+    if (binned.source == 0 || binned.source != binnedSource_ || binned.weights->size() != binnedUsed_.size()) return false;
+    const std::vector<double> &bins = *binned.weights;
+    std::vector<Double_t>::iterator itw = weights_.begin();
+    for (unsigned int i = 0, nbins = bins.size(); i < nbins; ++i) {
+        bool used = (bins[i] > 0 || includeZeroWeights_);
+        if (used != bool(binnedUsed_[i])) { binnedSource_ = 0; return false; }
+        if (used) { *itw = bins[i]; ++itw; }
+    }
+    weightsChanged_();
+    return true;
+}
+
+void
+cacheutils::CachingAddNLL::weightsChanged_()
+{
+    sumWeights_ = sumDefault(weights_);
+    setValueDirty();
+    clearMultiPdfNLLs_();
+    // the caches only depend on the entries, except for the analytic Barlow-Beeston of the CMSHistErrorPropagator
+    for (auto itp = pdfs_.begin(), edp = pdfs_.end(); itp != edp; ++itp) {
+        if (typeid(*(itp->pdf())) == typeid(CMSHistErrorPropagator)) itp->setDataDirty();
+    }
+    propagateData();
+}
+
 void cacheutils::CachingAddNLL::propagateData() {
+    // after setBinnedWeights only weights_ is up to date, not the dataset
+    bool fromWeights = (layoutVars_.size() == 1 && layout_.size() == weights_.size());
     for (auto const& funci : pdfs_) {
         if (typeid(*(funci.pdf())) == typeid(CMSHistErrorPropagator)) {
             // printf("Passing data to %s\n", funci.pdf()->GetName());
-            (static_cast<CMSHistErrorPropagator const*>(funci.pdf()))->setData(*data_);
+            if (fromWeights) (static_cast<CMSHistErrorPropagator const*>(funci.pdf()))->setData(layout_, weights_);
+            else (static_cast<CMSHistErrorPropagator const*>(funci.pdf()))->setData(*data_);
         }
     }
 }
 
 
+double
+cacheutils::CachingAddNLL::saturatedNLL() const
+{
+    if (saturatedBins_.size() != weights_.size()) {
+        // Group the entries by bin of the observables. The dataset is still the one of the
+        // last setData, and the fast updates of the weights keep the same non-empty entries.
+        saturatedBins_.clear(); saturatedLogVolumes_.clear();
+        std::vector<RooRealVar *> reals; std::vector<RooAbsCategory *> cats;
+        RooFIter iter = data_->get()->fwdIterator();
+        for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+            if (RooRealVar *rrv = dynamic_cast<RooRealVar *>(a)) reals.push_back(rrv);
+            else if (RooAbsCategory *cat = dynamic_cast<RooAbsCategory *>(a)) cats.push_back(cat);
+        }
+        std::map<std::vector<int>, uint32_t> ids;
+        std::vector<int> key(reals.size() + cats.size());
+        for (int i = 0, n = data_->numEntries(); i < n; ++i) {
+            data_->get(i);
+            if (data_->weight() == 0 && !includeZeroWeights_) continue;
+            double logVolume = 0;
+            for (unsigned int j = 0, nr = reals.size(); j < nr; ++j) {
+                const RooAbsBinning &binning = reals[j]->getBinning();
+                key[j] = binning.binNumber(reals[j]->getVal());
+                logVolume += std::log(binning.binWidth(key[j]));
+            }
+            for (unsigned int j = 0, nc = cats.size(); j < nc; ++j) key[reals.size()+j] = cats[j]->getIndex();
+            std::pair<std::map<std::vector<int>, uint32_t>::iterator, bool> found = ids.insert(std::make_pair(key, uint32_t(saturatedLogVolumes_.size())));
+            if (found.second) saturatedLogVolumes_.push_back(logVolume);
+            saturatedBins_.push_back(found.first->second);
+        }
+        if (saturatedBins_.size() != weights_.size()) throw std::logic_error(std::string("CachingAddNLL::saturatedNLL: dataset and weights don't match for ")+GetName());
+    }
+    std::vector<Double_t> sums(saturatedLogVolumes_.size(), 0.);
+    for (unsigned int i = 0, n = weights_.size(); i < n; ++i) sums[saturatedBins_[i]] += weights_[i];
+    // the pdf is sum/(sumWeights_ * volume) in each bin, and the expected events match the observed ones
+    DefaultAccumulator<double> ret = 0;
+    for (unsigned int ib = 0, nb = sums.size(); ib < nb; ++ib) {
+        if (sums[ib] > 0) ret -= sums[ib] * (std::log(sums[ib]/sumWeights_) - saturatedLogVolumes_[ib]);
+    }
+    return ret.sum();
+}
+
 void cacheutils::CachingAddNLL::setAnalyticBarlowBeeston(bool flag) {
+    clearMultiPdfNLLs_();
     for (auto const& funci : pdfs_) {
         if (typeid(*(funci.pdf())) == typeid(CMSHistErrorPropagator)) {
             (static_cast<CMSHistErrorPropagator const*>(funci.pdf()))->setAnalyticBarlowBeeston(flag);
@@ -1060,7 +1285,7 @@ cacheutils::CachingSimNLL::evaluate() const
             double pdfval = (*it)->getVal(nuis_);
             if (!isnormal(pdfval) || pdfval <= 0) {
                 std::cout << "WARNING: underflow constraint pdf " << (*it)->GetName() << ", value = " << pdfval << std::endl;
-    		Logger::instance().log(std::string(Form("CachingNLL.cc: %d -- underflow (pdf evaluates to <=0) of constraint pdf %s, value = %g ",__LINE__,(*it)->GetName(), pdfval)),Logger::kLogLevelInfo,__func__);
+    		if (Logger::enabled(Logger::kLogLevelInfo)) Logger::instance().log(std::string(Form("CachingNLL.cc: %d -- underflow (pdf evaluates to <=0) of constraint pdf %s, value = %g ",__LINE__,(*it)->GetName(), pdfval)),Logger::kLogLevelInfo,__func__);
                 if (gentleNegativePenalty_) { ret += 25; continue; }
                 if (!noDeepLEE_) logEvalError((std::string("Constraint pdf ")+(*it)->GetName()+" evaluated to zero, negative or error").c_str());
                 pdfval = 1e-9;
@@ -1106,11 +1331,19 @@ cacheutils::CachingSimNLL::setData(const RooAbsData &data)
     //std::cout << "combined data has " << data.numEntries() << " dataset entries (sumw " << data.sumEntries() << ", weighted " << data.isWeighted() << ")" << std::endl;
     //utils::printRAD(&data);
     //dataSets_.reset(dataOriginal_->split(pdfOriginal_->indexCat(), true));
+    static bool noFastSetData = runtimedef::get("SIMNLL_NO_FAST_SETDATA");
+    // binned toys from toymcoptutils carry their bins, which can be used directly
+    const BinnedToyData *binned = 0;
+    if (!noFastSetData && typeid(data) == typeid(BinnedToyDataSet)) {
+        binned = static_cast<const BinnedToyDataSet &>(data).binned();
+        if (setBinnedData(*binned)) return;
+    }
     if (!(RooCategory*)data.get()->find("CMS_channel")) { 
     	throw  std::logic_error("Error: no category in dataset. You should try to recreate your datacard as a Fake shape -- combineCards.py mycard.txt -S > myshapecard.txt OR rerun with option --forceRecreateNLL");
 	assert(0);
     }
     splitWithWeights(*dataOriginal_, pdfOriginal_->indexCat(), true);
+    BinnedToyData::Channel notBinned;
     for (int ib = 0, nb = pdfs_.size(); ib < nb; ++ib) {
         CachingAddNLL *canll = pdfs_[ib];
         if (canll == 0) continue;
@@ -1119,8 +1352,19 @@ cacheutils::CachingSimNLL::setData(const RooAbsData &data)
         if (data == 0) { throw std::logic_error("Error: no data"); }
         //std::cout << "   bin " << ib << " (label " << canll->GetName() << ") has pdf " << canll->pdf()->GetName() << " of type " << canll->pdf()->ClassName() <<
         //             " and " << (data ? data->numEntries() : -1) << " dataset entries (sumw " << data->sumEntries() << ", weighted " << data->isWeighted() << ")" << std::endl;
-        canll->setData(*data);
+        // datasets_ are refilled in place, so for toys with the same binning only the weights change
+        if (noFastSetData || !canll->refreshWeights(*data)) canll->setData(*data);
+        // and if it was a binned toy, the next ones from the same generator may not need the datasets at all
+        canll->setBinnedSource(binned && binned->size() == pdfs_.size() ? (*binned)[ib] : notBinned);
+    }
+}
+
+bool cacheutils::CachingSimNLL::setBinnedData(const BinnedToyData &binned) {
+    if (binned.size() != pdfs_.size()) return false;
+    for (int ib = 0, nb = pdfs_.size(); ib < nb; ++ib) {
+        if (pdfs_[ib] != 0 && !pdfs_[ib]->setBinnedWeights(binned[ib])) return false;
     }
+    return true;
 }
 
 void cacheutils::CachingSimNLL::splitWithWeights(const RooAbsData &data, const RooAbsCategory& splitCat, Bool_t createEmptyDataSets) {
@@ -1270,6 +1514,38 @@ void cacheutils::CachingSimNLL::setMaskConstraints(bool flag) {
     //            int(flag), nllBefore, nllAfter, (nllBefore-nllAfter), maskingOffset_, evaluate() - nllBefore);
 }
 
+void cacheutils::CachingSimNLL::setMaskAllChannels(bool mask) {
+    internalMasks_.clear(); // reset
+    activeParameters_.removeAll();
+    activeCatParameters_.removeAll();
+    if (mask) {
+        internalMasks_.resize(pdfs_.size(), false);
+        for (RooAbsPdf *pdf : constrainPdfs_) {
+            std::auto_ptr<RooArgSet> params(pdf->getParameters(*dataOriginal_));
+            activeParameters_.add(*params, /*silent=*/true);
+        }
+        for (SimpleGaussianConstraint *pdf : constrainPdfsFast_) {
+            std::auto_ptr<RooArgSet> params(pdf->getParameters(*dataOriginal_));
+            activeParameters_.add(*params, /*silent=*/true);
+        }
+        for (SimplePoissonConstraint *pdf : constrainPdfsFastPoisson_) {
+            std::auto_ptr<RooArgSet> params(pdf->getParameters(*dataOriginal_));
+            activeParameters_.add(*params, /*silent=*/true);
+        }
+    }
+    setValueDirty();
+}
+
+double cacheutils::CachingSimNLL::saturatedChannelsNLL() const {
+    DefaultAccumulator<double> ret = 0;
+    for (unsigned int idx = 0, n = pdfs_.size(); idx < n; ++idx) {
+        if (pdfs_[idx] == 0) continue;
+        if (!channelMasks_.empty() && channelMasks_[idx]->getVal() != 0.) continue;
+        ret += pdfs_[idx]->saturatedNLL();
+    }
+    return ret.sum();
+}
+
 void cacheutils::CachingSimNLL::setMaskNonDiscreteChannels(bool mask) {
     double nllBefore = evaluate();
     internalMasks_.clear(); // reset
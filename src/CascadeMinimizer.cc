@@ -36,6 +36,8 @@ std::string CascadeMinimizer::defaultMinimizerAlgo_=ROOT::Math::MinimizerOptions
 double CascadeMinimizer::defaultMinimizerTolerance_=1e-1;  
 double CascadeMinimizer::defaultMinimizerPrecision_=-1.0;
 int  CascadeMinimizer::strategy_=1; 
+int  CascadeMinimizer::minosWorkers_=0;
+int  CascadeMinimizer::discreteWorkers_=0;
 
 std::map<std::string,std::vector<std::string> > const CascadeMinimizer::minimizerAlgoMap_{
  {"Minuit"	 ,{"Migrad","Simplex","Combined","Scan"}}
@@ -246,7 +248,7 @@ bool CascadeMinimizer::minos(const RooArgSet & params , int verbose ) {
    //TStopwatch tw;
    // need to re-run Migrad before running minos
    minimizer_->minimize(myType.c_str(), "Migrad");
-   int iret = minimizer_->minos(params); 
+   int iret = (minosWorkers_ > 1 && params.getSize() > 1) ? parallelMinos(params, verbose) : minimizer_->minos(params);
    if (verbose>0 ) Logger::instance().log(std::string(Form("CascadeMinimizer.cc: %d -- Minos finished with status=%d",__LINE__,iret)),Logger::kLogLevelDebug,__func__);
 
    //std::cout << "Run Minos in  "; tw.Print(); std::cout << std::endl;
@@ -263,6 +265,52 @@ bool CascadeMinimizer::minos(const RooArgSet & params , int verbose ) {
    return (iret != 1) ? true : false; 
 }
 
+int CascadeMinimizer::parallelMinos(const RooArgSet & params, int verbose) {
+   // The MINOS scans of the different parameters are independent once the
+   // minimum is known, so each forked worker runs them for a subset of the
+   // parameters starting from the current minimum, and we collect the intervals
+   std::vector<RooRealVar *> vars;
+   RooFIter iter = params.fwdIterator();
+   for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+      RooRealVar *v = dynamic_cast<RooRealVar *>(a);
+      if (v && !v->isConstant()) vars.push_back(v);
+   }
+   if (verbose > 0) Logger::instance().log(std::string(Form("CascadeMinimizer.cc: %d -- Running Minos for %d parameters in %d processes",__LINE__,int(vars.size()),minosWorkers_)),Logger::kLogLevelInfo,__func__);
+   double nll0 = nll_.getVal();
+   std::vector<std::vector<double> > res = utils::forkJobs(vars.size(), minosWorkers_, [&](unsigned int i) {
+        // [ status, lower error, upper error, nll at the end of the scan ]
+        std::vector<double> ret(4);
+        ret[0] = minimizer_->minos(RooArgSet(*vars[i]));
+        ret[1] = vars[i]->getAsymErrorLo();
+        ret[2] = vars[i]->getAsymErrorHi();
+        ret[3] = nll_.getVal();
+        return ret;
+   }, /*reseed=*/false);
+   // A scan that finds a lower minimum moves to it, and in a single process the
+   // scans of the following parameters would start from there. The intervals of
+   // the other workers are then not valid, so in this case we run minos again in
+   // this process, from where we are, which gives the same result as without workers.
+   const double newMinimumTolerance = 0.01;
+   for (unsigned int i = 0; i < vars.size(); ++i) {
+      if (res[i].size() == 4 && res[i][3] < nll0 - newMinimumTolerance) {
+         Logger::instance().log(std::string(Form("CascadeMinimizer.cc: %d -- Minos for %s found a new minimum (NLL lower by %g): running Minos again in a single process",__LINE__,vars[i]->GetName(),nll0-res[i][3])),Logger::kLogLevelError,__func__);
+         return minimizer_->minos(params);
+      }
+   }
+   int iret = 0;
+   for (unsigned int i = 0; i < vars.size(); ++i) {
+      if (res[i].size() != 4) {
+         Logger::instance().log(std::string(Form("CascadeMinimizer.cc: %d -- Minos for %s did not report back",__LINE__,vars[i]->GetName())),Logger::kLogLevelError,__func__);
+         vars[i]->removeAsymError();
+         iret = 1;
+         continue;
+      }
+      vars[i]->setAsymError(res[i][1], res[i][2]);
+      if (iret == 0) iret = int(res[i][0]);
+   }
+   return iret;
+}
+
 bool CascadeMinimizer::hesse(int verbose ) {
    
    cacheutils::CachingSimNLL *simnllbb = dynamic_cast<cacheutils::CachingSimNLL *>(&nll_);
@@ -570,6 +618,108 @@ bool CascadeMinimizer::multipleMinimize(const RooArgSet &reallyCleanParameters,
     TStopwatch tw; tw.Start();
 
     int fitCounter = 0;
+    if (discreteWorkers_ > 1) {
+      // The fits of the different combinations all start from the same point, so they are
+      // run in waves of discreteWorkers_ forked processes, and the results are reduced here
+      // in the same order as in the sequential loop below, which is then skipped.
+      // In mode 1 a fit can remove indices from contributingIndeces: when this invalidates
+      // a later combination of the same wave, the rest of the wave is discarded and the next
+      // one starts from there, so the same combinations are fitted as in the sequential loop.
+      // The indices the categories are set from (to find the one that changed, for
+      // maskChannels == 2) are followed in the same way as the loop below sets them.
+      RooArgList paramList(*params);
+      // FIXME this should be made configurable!
+      double maxDeviation = 5;
+      std::vector<int> current(numIndeces);
+      for (int id=0;id<numIndeces;id++) current[id] = ((RooCategory*)(pdfCategoryIndeces.at(id)))->getIndex();
+      while (my_it != myCombos.end()) {
+        std::vector<std::vector<int> > todo;
+        std::vector<int> changed;
+        std::vector<std::vector<std::vector<int> >::iterator> where;
+        std::vector<std::vector<int> > after; // indices set after each fit of the wave
+        std::vector<int> sim = current;
+        std::vector<std::vector<int> >::iterator it = my_it;
+        for (; it != myCombos.end() && todo.size() < unsigned(discreteWorkers_); ++it) {
+          bool isValidCombo = true;
+          int changedIndex = -1;
+          for (int id=0;id<numIndeces;id++) {
+            if (!contributingIndeces[id][(*it)[id]]) { isValidCombo = false; break; }
+            if (sim[id] != (*it)[id]) changedIndex = id;
+            sim[id] = (*it)[id];
+          }
+          if (!isValidCombo) continue;
+          todo.push_back(*it); changed.push_back(changedIndex); where.push_back(it); after.push_back(sim);
+        }
+        if (todo.empty()) break;
+        int firstFit = fitCounter;
+        if (verbose > 2) std::cout << "Fitting " << todo.size() << " combinations of indices in " << discreteWorkers_ << " processes" << std::endl;
+        std::vector<std::vector<double> > res = utils::forkJobs(todo.size(), discreteWorkers_, [&](unsigned int i) {
+          for (int id=0;id<numIndeces;id++) ((RooCategory*)(pdfCategoryIndeces.at(id)))->setIndex(todo[i][id]);
+          if (firstFit + i > 0) params->assignValueOnly(reallyCleanParameters); // no need to reset from 0'th fit
+          if (maskChannels == 2 && simnll) {
+            for (int id=0;id<numIndeces;id++)  ((RooCategory*)(pdfCategoryIndeces.at(id)))->setConstant(id != changed[i] && changed[i] != -1);
+            simnll->setMaskNonDiscreteChannels(true);
+          }
+          freezeDiscParams(true);
+          if (mode_ == Unconstrained && poiOnlyFit_) {
+            trivialMinimize(nll_, *poi_, 200);
+          }
+          bool ok = improve(verbose, cascade, freezeDisassParams);
+          freezeDiscParams(false);
+          // [ nll, status, values of params ]
+          std::vector<double> out(1, nll_.getVal());
+          out.push_back(ok);
+          for (int ip = 0, np = paramList.getSize(); ip < np; ++ip) {
+            RooRealVar *v = dynamic_cast<RooRealVar *>(paramList.at(ip));
+            out.push_back(v ? v->getVal() : 0.);
+          }
+          return out;
+        }, /*reseed=*/false);
+
+        // by default the whole wave is used
+        my_it = it; current = sim;
+        for (unsigned int i = 0; i < todo.size(); ++i) {
+          if (i > 0) {
+            bool isValidCombo = true;
+            for (int id=0;id<numIndeces;id++) isValidCombo = isValidCombo && contributingIndeces[id][todo[i][id]];
+            if (!isValidCombo) {
+              // pruned by a fit of this wave: restart after the last fit that was used
+              my_it = where[i-1] + 1; current = after[i-1];
+              break;
+            }
+          }
+          fitCounter++;
+          if (res[i].size() != unsigned(paramList.getSize()+2)) {
+            Logger::instance().log(std::string(Form("CascadeMinimizer.cc: %d -- Fit for combination %d of the discrete indices did not report back",__LINE__,fitCounter)),Logger::kLogLevelError,__func__);
+            continue;
+          }
+          double thisNllValue = res[i][0];
+          ret = (res[i][1] != 0);
+          if (thisNllValue < minimumNLL) {
+            if (verbose>2) {
+              std::cout << " .... Found a better fit: new NLL = " << thisNllValue << " (improvement: " << (thisNllValue-minimumNLL) << std::endl;
+            }
+            minimumNLL = thisNllValue;
+            for (int ip = 0, np = paramList.getSize(); ip < np; ++ip) {
+              RooRealVar *v = dynamic_cast<RooRealVar *>(snap.find(paramList.at(ip)->GetName()));
+              if (v) v->setVal(res[i][ip+2]);
+            }
+            for (int id=0;id<numIndeces;id++) {
+              if (bestIndeces[id] != todo[i][id]) newDiscreteMinimum = true;
+              bestIndeces[id] = todo[i][id];
+            }
+          }
+          if (mode==1 && thisNllValue > minimumNLL+maxDeviation) {
+            int modid = 0, modcount = 0;
+            for (int id=0;id<numIndeces;id++) {
+              if (todo[i][id] != bestIndeces[id]) { modid = id; modcount++; }
+            }
+            if (modcount==1) contributingIndeces[modid][todo[i][modid]] = false;
+          }
+        }
+      }
+      my_it = myCombos.end();
+    }
     for (;my_it!=myCombos.end(); my_it++){
 
 	     bool isValidCombo = true;
@@ -722,6 +872,8 @@ void CascadeMinimizer::initOptions()
         ("cminRunAllDiscreteCombinations",  "Run all combinations for discrete nuisances")
         ("cminDiscreteMinTol", boost::program_options::value<double>(&discreteMinTol_)->default_value(discreteMinTol_), "tolerance on min NLL for discrete combination iterations")
         ("cminM2StorageLevel", boost::program_options::value<int>(&minuit2StorageLevel_)->default_value(minuit2StorageLevel_), "storage level for minuit2 (0 = don't store intermediate covariances, 1 = store them)")
+        ("cminMinosWorkers", boost::program_options::value<int>(&minosWorkers_)->default_value(minosWorkers_), "if N > 1, run Minos for several parameters in N forked processes, starting each scan from the common minimum")
+        ("cminDiscreteWorkers", boost::program_options::value<int>(&discreteWorkers_)->default_value(discreteWorkers_), "if N > 1, fit the combinations of discrete pdf indices in N forked processes")
         //("cminNuisancePruning", boost::program_options::value<float>(&nuisancePruningThreshold_)->default_value(nuisancePruningThreshold_), "if non-zero, discard constrained nuisances whose effect on the NLL when changing by 0.2*range is less than the absolute value of the threshold; if threshold is negative, repeat afterwards the fit with these floating")
 
         //("cminDefaultIntegratorEpsAbs", boost::program_options::value<double>(), "RooAbsReal::defaultIntegratorConfig()->setEpsAbs(x)")
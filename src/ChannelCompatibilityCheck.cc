@@ -14,9 +14,12 @@
 #include "HiggsAnalysis/CombinedLimit/interface/RooSimultaneousOpt.h"
 #include "HiggsAnalysis/CombinedLimit/interface/utils.h"
 #include "HiggsAnalysis/CombinedLimit/interface/CachingNLL.h"
+#include "HiggsAnalysis/CombinedLimit/interface/ToyMCSamplerOpt.h"
 
 
 #include <Math/MinimizerOptions.h>
+#include <algorithm>
+#include <cmath>
 
 using namespace RooStats;
 
@@ -25,6 +28,9 @@ bool  ChannelCompatibilityCheck::fixedMu_ = false;
 bool  ChannelCompatibilityCheck::saveFitResult_ = true;
 bool  ChannelCompatibilityCheck::runMinos_ = true;
 std::vector<std::string> ChannelCompatibilityCheck::groups_;
+int   ChannelCompatibilityCheck::workers_ = 0;
+int   ChannelCompatibilityCheck::toys_ = 0;
+double ChannelCompatibilityCheck::pValue_ = -1;
 
 ChannelCompatibilityCheck::ChannelCompatibilityCheck() :
     FitterAlgoBase("ChannelCompatibilityCheck specific options")
@@ -34,6 +40,8 @@ ChannelCompatibilityCheck::ChannelCompatibilityCheck() :
         ("saveFitResult",       "Save fit results in output file")
         ("group,g",             boost::program_options::value<std::vector<std::string> >(&groups_), "Group together channels that contain a given name. Can be used multiple times.")
         ("runMinos", boost::program_options::value<bool>(&runMinos_)->default_value(runMinos_), "Compute also uncertainties using profile likeilhood (MINOS or robust variants of it)")
+        ("compatibilityWorkers", boost::program_options::value<int>(&workers_)->default_value(workers_), "If N > 1, compute the uncertainties of the signal strengths, and the toys, in N forked processes")
+        ("compatibilityToys",    boost::program_options::value<int>(&toys_)->default_value(toys_), "Compute the p-value of the compatibility variable from N toys generated from the nominal fit (with systematics, the global observables are also generated, as with --toysFrequentist)")
     ;
 }
 
@@ -59,6 +67,7 @@ bool ChannelCompatibilityCheck::runSpecific(RooWorkspace *w, RooStats::ModelConf
   std::auto_ptr<RooSimultaneous> newsim((typeid(*sim) == typeid(RooSimultaneousOpt)) ? new RooSimultaneousOpt(satname, "", *cat) : new RooSimultaneous(satname, "", *cat)); 
   std::map<std::string,std::string> rs;
   RooArgList minosVars, minosOneVar; if (runMinos_) minosOneVar.add(*r);
+  std::vector<RooRealVar *> riVars;
   for (int ic = 0, nc = nbins; ic < nc; ++ic) {
       cat->setBin(ic);
       RooAbsPdf *pdfi = sim->getPdf(cat->getLabel());
@@ -72,25 +81,54 @@ bool ChannelCompatibilityCheck::runSpecific(RooWorkspace *w, RooStats::ModelConf
       customizer.replaceArg(*r, *w->var(riName));
       newsim->addPdf((RooAbsPdf&)*customizer.build(), cat->getLabel());
       if (runMinos_ && !minosVars.find(riName)) minosVars.add(*w->var(riName));
+      if (std::find(riVars.begin(), riVars.end(), w->var(riName)) == riVars.end()) riVars.push_back(w->var(riName));
   }
 
+  // With several workers, the two global fits only find the minima, and the
+  // intervals of the signal strengths, which are independent of each other once
+  // the minima are known, are computed afterwards in forked processes
+  bool parallelMinos = runMinos_ && workers_ > 1;
+
   CloseCoutSentry sentry(verbose < 2);
   const RooCmdArg &constCmdArg = withSystematics  ? RooFit::Constrain(*mc_s->GetNuisanceParameters()) : RooFit::NumCPU(1); // use something dummy 
-  std::auto_ptr<RooFitResult> result_nominal (doFit(   *sim, data, minosOneVar, constCmdArg, runMinos_)); // let's run Hesse if we want to run Minos
+  std::auto_ptr<RooFitResult> result_nominal (doFit(   *sim, data, parallelMinos ? RooArgList() : minosOneVar, constCmdArg, runMinos_)); // let's run Hesse if we want to run Minos
   if (dynamic_cast<cacheutils::CachingSimNLL*>(nll.get())) {
     static_cast<cacheutils::CachingSimNLL*>(nll.get())->clearConstantZeroPoint();
   }
   double nll_nominal   = nll->getVal();
-  std::auto_ptr<RooFitResult> result_freeform(doFit(*newsim, data, minosVars,   constCmdArg, runMinos_));
+  std::auto_ptr<RooFitResult> result_freeform(doFit(*newsim, data, parallelMinos ? RooArgList() : minosVars,   constCmdArg, runMinos_));
   if (dynamic_cast<cacheutils::CachingSimNLL*>(nll.get())) {
     static_cast<cacheutils::CachingSimNLL*>(nll.get())->clearConstantZeroPoint();
   }
   double nll_freeform   = nll->getVal();
-  sentry.clear();
 
   if (result_nominal.get()  == 0) return false;
   if (result_freeform.get() == 0) return false;
 
+  if (parallelMinos) {
+      // job 0 is the common signal strength (if floating), the others the one of each group
+      unsigned int first = fixedMu_ ? 1 : 0;
+      std::vector<std::vector<double> > res = utils::forkJobs(riVars.size() + 1 - first, workers_, [&](unsigned int i) {
+            return (i + first == 0) ? runInterval(*sim, data, *r, *result_nominal, constCmdArg) :
+                                      runInterval(*newsim, data, *riVars[i + first - 1], *result_freeform, constCmdArg);
+      }, /*reseed=*/false);
+      for (unsigned int i = first, n = riVars.size() + 1; i < n; ++i) {
+          const RooFitResult &best = (i == 0 ? *result_nominal : *result_freeform);
+          const char *name = (i == 0 ? r : riVars[i-1])->GetName();
+          RooRealVar *rf = (RooRealVar*) best.floatParsFinal().find(name);
+          const std::vector<double> &ri = res[i - first];
+          if (rf == 0) continue;
+          if (ri.size() != 7) {
+              fprintf(sentry.trueStdOut(), "Interval for %s was not found, or did not report back.\n", name);
+              continue;
+          }
+          rf->setAsymError(ri[0], ri[1]);
+          rf->setRange("err68", ri[2], ri[3]);
+          if (ri[4]) rf->setRange("err95", ri[5], ri[6]);
+      }
+  }
+  sentry.clear();
+
   //double nll_nominal   = result_nominal->minNll();
   //double nll_freeform = result_freeform->minNll();
   if (fabs(nll_nominal) > 1e10 || fabs(nll_freeform) > 1e10) return false;
@@ -125,6 +163,68 @@ bool ChannelCompatibilityCheck::runSpecific(RooWorkspace *w, RooStats::ModelConf
   //}
   std::cout << "Chi2-like compatibility variable: " << limit << std::endl;
 
+  if (toys_ > 0) {
+      static bool shouldCreateBranch = true;
+      if (shouldCreateBranch) { Combine::addBranch("compatibilityPValue", &pValue_, "compatibilityPValue/D"); shouldCreateBranch = false; }
+      std::auto_ptr<RooArgSet> paramsNominal(sim->getParameters(data)), paramsFreeform(newsim->getParameters(data));
+      RooArgSet bestFreeform(result_freeform->floatParsFinal());
+      RooRealVar *weightVar = 0; // made by the generator, must outlive it
+      std::vector<std::vector<double> > res;
+      // as for --toysFrequentist, the global observables are generated too,
+      // from the constraint terms at the nominal fit, and restored afterwards
+      const RooArgSet *gobs = withSystematics ? mc_s->GetGlobalObservables() : 0;
+      std::auto_ptr<RooAbsPdf> nuisancePdf;
+      std::auto_ptr<RooArgSet> gobsObserved;
+      if (gobs && gobs->getSize() > 0) {
+          nuisancePdf.reset(utils::makeNuisancePdf(*mc_s));
+          gobsObserved.reset((RooArgSet *) gobs->snapshot());
+      }
+      {
+          toymcoptutils::SimPdfGenInfo generator(*sim, *mc_s->GetObservables(), true);
+          // each toy is generated from the nominal fit, then fit with both models
+          auto job = [&](unsigned int itoy) {
+                std::vector<double> ret;
+                *paramsFreeform = bestFreeform;
+                *paramsNominal = result_nominal->floatParsFinal();
+                if (nuisancePdf.get()) {
+                    std::auto_ptr<RooDataSet> gobsToy(nuisancePdf->generate(*gobs, 1));
+                    if (gobsToy.get() == 0 || gobsToy->numEntries() != 1) return ret;
+                    RooArgSet gobsCopy(*gobs); gobsCopy.assignValueOnly(*gobsToy->get(0));
+                }
+                std::auto_ptr<RooAbsData> toy(generator.generate(weightVar));
+                double nllToyNominal = fitNLL(*sim, *toy, constCmdArg);
+                for (RooRealVar *ri : riVars) ri->setVal(r->getVal());
+                double nllToyFreeform = std::isnan(nllToyNominal) ? NAN : fitNLL(*newsim, *toy, constCmdArg);
+                nll.reset(); // it points to the toy
+                if (!std::isnan(nllToyFreeform)) ret.push_back(2*(nllToyNominal-nllToyFreeform));
+                return ret;
+          };
+          CloseCoutSentry sentry(verbose < 2);
+          if (workers_ > 1) {
+              res = utils::forkJobs(toys_, workers_, job);
+          } else {
+              for (int itoy = 0; itoy < toys_; ++itoy) res.push_back(job(itoy));
+          }
+      }
+      delete weightVar;
+      if (gobsObserved.get()) { RooArgSet gobsCopy(*gobs); gobsCopy.assignValueOnly(*gobsObserved); }
+      *paramsFreeform = bestFreeform;
+      *paramsNominal = result_nominal->floatParsFinal();
+      int ntoys = 0, nabove = 0;
+      for (const std::vector<double> &q : res) {
+          if (q.size() != 1) continue;
+          ntoys++;
+          if (q[0] >= limit) nabove++;
+      }
+      if (ntoys > 0) {
+          pValue_ = double(nabove)/ntoys;
+          printf("P-value of the compatibility from %d toys (%d failed): %.4f +/- %.4f\n", ntoys, toys_ - ntoys, pValue_, sqrt(pValue_*(1-pValue_)/ntoys));
+      } else {
+          pValue_ = -1;
+          printf("P-value of the compatibility: all the %d toys failed\n", toys_);
+      }
+  }
+
   if (saveFitResult_) {
       writeToysHere->GetFile()->WriteTObject(result_nominal.release(),  "fit_nominal"  );
       writeToysHere->GetFile()->WriteTObject(result_freeform.release(), "fit_alternate");
@@ -132,6 +232,38 @@ bool ChannelCompatibilityCheck::runSpecific(RooWorkspace *w, RooStats::ModelConf
   return true;
 }
 
+std::vector<double> ChannelCompatibilityCheck::runInterval(RooAbsPdf &pdf, RooAbsData &data, RooRealVar &var, const RooFitResult &best, const RooCmdArg &constrain)
+{
+    std::vector<double> ret;
+    std::auto_ptr<RooArgSet> params(pdf.getParameters(data));
+    *params = best.floatParsFinal();
+    std::auto_ptr<RooFitResult> res(doFit(pdf, data, RooArgList(var), constrain, false));
+    if (res.get() == 0) return ret;
+    RooRealVar *rf = (RooRealVar*) res->floatParsFinal().find(var.GetName());
+    // as in the sequential case, nothing is reported if the interval was not found
+    if (rf == 0 || !rf->hasRange("err68")) return ret;
+    bool has95 = rf->hasRange("err95");
+    ret.push_back(rf->getAsymErrorLo());
+    ret.push_back(rf->getAsymErrorHi());
+    ret.push_back(rf->getMin("err68"));
+    ret.push_back(rf->getMax("err68"));
+    ret.push_back(has95);
+    ret.push_back(has95 ? rf->getMin("err95") : 0);
+    ret.push_back(has95 ? rf->getMax("err95") : 0);
+    return ret;
+}
+
+double ChannelCompatibilityCheck::fitNLL(RooAbsPdf &pdf, RooAbsData &data, const RooCmdArg &constrain)
+{
+    std::auto_ptr<RooFitResult> res(doFit(pdf, data, RooArgList(), constrain, false, 1, false, false));
+    if (res.get() == 0) return NAN;
+    if (dynamic_cast<cacheutils::CachingSimNLL*>(nll.get())) {
+      static_cast<cacheutils::CachingSimNLL*>(nll.get())->clearConstantZeroPoint();
+    }
+    double ret = nll->getVal();
+    return (fabs(ret) > 1e10 ? NAN : ret);
+}
+
 std::string ChannelCompatibilityCheck::nameForLabel(const char *label)
 {
     std::string ret(label);
@@ -54,6 +54,7 @@
 
 #include "HiggsAnalysis/CombinedLimit/interface/LimitAlgo.h"
 #include "HiggsAnalysis/CombinedLimit/interface/utils.h"
+#include "HiggsAnalysis/CombinedLimit/interface/SharedTemplateStore.h"
 #include "HiggsAnalysis/CombinedLimit/interface/CloseCoutSentry.h"
 #include "HiggsAnalysis/CombinedLimit/interface/RooSimultaneousOpt.h"
 #include "HiggsAnalysis/CombinedLimit/interface/ToyMCSamplerOpt.h"
@@ -128,6 +129,7 @@ Combine::Combine() :
       ;
     ioOptions_.add_options()
       ("saveWorkspace", "Save workspace to output root file")
+      ("sharedTemplates", "Keep the templates of the CMSHistFuncs of the input workspace in a shared memory segment, used by all the jobs on the node that read the same file (binary workspaces only)")
       ("workspaceName,w", po::value<std::string>(&workspaceName_)->default_value("w"), "Workspace name, when reading it from or writing it to a rootfile.")
       ("snapshotName", po::value<std::string>(&snapshotName_)->default_value(""), "Default snapshot name for pre-fit snapshot for reading or writing to workspace")
       ("modelConfigName",  po::value<std::string>(&modelConfigName_)->default_value("ModelConfig"), "ModelConfig name, when reading it from or writing it to a rootfile.")
@@ -155,6 +157,8 @@ Combine::Combine() :
       ("genUnbinnedChannels", po::value<std::string>(&genAsUnbinned_)->default_value(genAsUnbinned_), "Flag the given channels to be generated unbinned (irrespectively of how they were flagged at workspace creation)") 
       ("text2workspace",   boost::program_options::value<std::string>(&textToWorkspaceString_)->default_value(""), "Pass along options to text2workspace (default = none)")
       ("trackParameters",   boost::program_options::value<std::string>(&trackParametersNameString_)->default_value(""), "Keep track of parameters in workspace, also accepts regexp with syntax 'rgx{<my regexp>}' (default = none)")
+      ("memoryReport", "Print the memory used by the templates and caches of the binned shapes, per class and per channel, at the end of the run")
+      ("logLevel", po::value<std::string>()->default_value("DEBUG"), "Only write to combine_logger.out the messages of this level or above (DEBUG, INFO or ERROR)")
       ; 
 }
 
@@ -174,6 +178,10 @@ void Combine::applyOptions(const boost::program_options::variables_map &vm) {
   lowerLimit_     = vm.count("lowerLimit");
   hintUsesStatOnly_ = vm.count("hintStatOnly");
   saveWorkspace_ = vm.count("saveWorkspace");
+  sharedTemplates_ = vm.count("sharedTemplates");
+  memoryReport_ = vm.count("memoryReport");
+  Logger::setMinLevel(vm["logLevel"].as<std::string>());
+  if (sharedTemplates_ && saveWorkspace_) throw std::logic_error("You can't set sharedTemplates and saveWorkspace options at the same time");
   toysNoSystematics_ = vm.count("toysNoSystematics");
   //if (!withSystematics) toysNoSystematics_ = true;  // if no systematics, also don't expect them for the toys
   toysFrequentist_ = vm.count("toysFrequentist");
@@ -268,6 +276,8 @@ void Combine::run(TString hlfFile, const std::string &dataset, double &limit, do
   } else if (hlfFile.EndsWith(".root")) {
     isBinary = true;
   } else {
+    // the workspace converted from a text datacard is a temporary file, so a segment keyed on it could never be reused
+    if (sharedTemplates_) throw std::invalid_argument("The option sharedTemplates needs a binary workspace as input: convert the datacard with text2workspace.py first");
     TString txtFile = fileToLoad.Data();
     TString options = TString::Format(" -m %f -D %s", mass_, dataset.c_str());
     //if (!withSystematics) options += " --stat ";
@@ -319,6 +329,13 @@ void Combine::run(TString hlfFile, const std::string &dataset, double &limit, do
 
 
     if (verbose > 3) { std::cout << "Input workspace '" << workspaceName_ << "': \n"; w->Print("V"); }
+    if (sharedTemplates_) {
+      // identify the input by path, size and modification time, so that a new file gets a new segment
+      std::string key = TString::Format("%s:%s:%lu:%ld", fileToLoad.Data(), workspaceName_.c_str(),
+                                        (unsigned long) boost::filesystem::file_size(fileToLoad.Data()),
+                                        (long) boost::filesystem::last_write_time(fileToLoad.Data())).Data();
+      SharedTemplateStore::shareCMSHistFuncs(*w, key, verbose);
+    }
     RooRealVar *MH = w->var("MH");
     if (MH!=0) {
       if (verbose > 2) std::cerr << "Setting variable 'MH' in workspace to the higgs mass " << mass_ << std::endl;
@@ -1160,6 +1177,8 @@ void Combine::run(TString hlfFile, const std::string &dataset, double &limit, do
     }
   }
   
+  if (memoryReport_) utils::printMemoryReport(*w, mc->GetPdf());
+
   if (saveWorkspace_) {
     w->SetName(workspaceName_.c_str());
     w->loadSnapshot("clean");
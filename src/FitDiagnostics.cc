@@ -1,6 +1,7 @@
 #include "HiggsAnalysis/CombinedLimit/interface/FitDiagnostics.h"
 #include "RooMinimizer.h"
 #include "RooRealVar.h"
+#include "RooAbsBinning.h"
 #include "RooArgSet.h"
 #include "RooRandom.h"
 #include "RooDataSet.h"
@@ -20,6 +21,7 @@
 #include "TStyle.h"
 #include "TH2.h"
 #include "TFile.h"
+#include "TMatrixDSymEigen.h"
 #include <RooStats/ModelConfig.h>
 #include "HiggsAnalysis/CombinedLimit/interface/CMSHistErrorPropagator.h"
 #include "HiggsAnalysis/CombinedLimit/interface/Combine.h"
@@ -60,6 +62,8 @@ bool        FitDiagnostics::customStartingPoint_ = false;
 bool        FitDiagnostics::robustHesse_ = false;
 bool        FitDiagnostics::saveWithUncertsRequested_=false;
 bool        FitDiagnostics::ignoreCovWarning_=false;
+std::string FitDiagnostics::shapeUncertaintyMethod_ = "toys";
+int         FitDiagnostics::shapeUncertaintyWorkers_ = 0;
 
 
 FitDiagnostics::FitDiagnostics() :
@@ -87,6 +91,8 @@ FitDiagnostics::FitDiagnostics() :
         ("saveWithUncertainties",  "Save also pre/post-fit uncertainties on the shapes and normalizations (from resampling the covariance matrix)")
         ("saveOverallShapes",  "Save total shapes (and covariance if used with --saveWithUncertainties), ie will produce TH1 (TH2) merging bins across all channels")
         ("numToysForShapes", 	boost::program_options::value<int>(&numToysForShapes_)->default_value(numToysForShapes_),  "Choose number of toys for re-sampling of the covariance (for shapes with uncertainties)")
+        ("shapeUncertaintyMethod", boost::program_options::value<std::string>(&shapeUncertaintyMethod_)->default_value(shapeUncertaintyMethod_), "How to compute the uncertainties on the shapes and normalizations: 'toys' (re-sampling of the covariance) or 'linear' (linear propagation of the post-fit covariance, toys are still used for the pre-fit)")
+        ("shapeUncertaintyWorkers", boost::program_options::value<int>(&shapeUncertaintyWorkers_)->default_value(shapeUncertaintyWorkers_), "If N > 1, evaluate the predictions for the uncertainties on the shapes in N forked processes, splitting the channels among them")
         ("filterString",	boost::program_options::value<std::string>(&filterString_)->default_value(filterString_), "Filter to search for when making covariance and shapes")
         ("justFit",  		"Just do the S+B fit, don't do the B-only one, don't save output file")
         ("robustHesse",  boost::program_options::value<bool>(&robustHesse_)->default_value(robustHesse_),  "Use a more robust calculation of the hessian/covariance matrix")
@@ -741,12 +747,9 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
     datOverallHist->SetDirectory(0);
 
     int iBinOverall = 1;
-    //Map to hold info on bins across channels
-    std::map<TString,int> binMap;
     for (IH h = totByCh.begin(), eh = totByCh.end(); h != eh; ++h){
 	for (int iBin = 0; iBin < h->second->GetNbinsX(); iBin++,iBinOverall++){
 	    TString label = Form("%s_%d",h->first.c_str(),iBin);
-	    binMap[label] = iBinOverall;
 	    totOverall->GetXaxis()->SetBinLabel(iBinOverall,label);
 	    totOverall->SetBinContent(iBinOverall,h->second->GetBinContent(iBin+1));
 
@@ -777,101 +780,141 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
     if (saveWithUncertainties_) {
         int ntoys = numToysForShapes_;
 
-        if ( verbose > 0 ) Logger::instance().log(std::string(Form("FitDiagnostics.cc: %d -- Generating toy data for evaluating per-bin uncertainties and covariances with post-fit nuisance parameters with %d toys",__LINE__,ntoys)),Logger::kLogLevelInfo,__func__);
+        std::vector<const ShapeAndNorm *> procs;
+        std::vector<int> nbins(snm.size(), 0), offset(snm.size(), 0);
+        for (pair = bg, i = 0; pair != ed; ++pair, ++i) {
+            procs.push_back(&pair->second);
+            nbins[i] = shapes[i] ? bins[i] : 0;
+            if (i) offset[i] = offset[i-1] + 1 + nbins[i-1];
+        }
 
-        sampler.generate(ntoys);
+        // the parameters that are varied, in the order of the sampler
         std::auto_ptr<RooArgSet> params(pdf->getParameters(obs));
-        // prepare histograms for running sums
-        std::map<std::string,TH1*> totByCh1, sigByCh1, bkgByCh1;
-        for (IH h = totByCh.begin(), eh = totByCh.end(); h != eh; ++h) totByCh1[h->first] = (TH1*) h->second->Clone();
-        for (IH h = sigByCh.begin(), eh = sigByCh.end(); h != eh; ++h) sigByCh1[h->first] = (TH1*) h->second->Clone();
-        for (IH h = bkgByCh.begin(), eh = bkgByCh.end(); h != eh; ++h) bkgByCh1[h->first] = (TH1*) h->second->Clone();
-        for (int t = 0; t < ntoys; ++t) {
-            // zero out partial sums
-            for (IH h = totByCh1.begin(), eh = totByCh1.end(); h != eh; ++h) h->second->Reset();
-            for (IH h = sigByCh1.begin(), eh = sigByCh1.end(); h != eh; ++h) h->second->Reset();
-            for (IH h = bkgByCh1.begin(), eh = bkgByCh1.end(); h != eh; ++h) h->second->Reset();
-            // randomize numbers
-            params->assignValueOnly( sampler.get(t) );
-            for (pair = bg, i = 0; pair != ed; ++pair, ++i) { 
-                // add up deviations in numbers for each channel
-                sumx2[i] += std::pow(pair->second.norm->getVal() - vals[i], 2);  
-                if (saveShapes_ && pair->second.obs.getSize() == 1) {
-                    // and also deviations in the shapes
-                    RooRealVar *x = (RooRealVar*)pair->second.obs.at(0);
-                    std::auto_ptr<TH1> hist(pair->second.pdf->createHistogram(pair->second.pdf->GetName(), *x,
-                      pair->second.isfunc ? RooFit::Extended(false) : RooCmdArg::none()));
-                    hist->Scale(pair->second.norm->getVal() / hist->Integral("width"));
-                    for (int b = 1; b <= bins[i]; ++b) {
-                        shapes2[i]->AddBinContent(b, std::pow(hist->GetBinContent(b) - shapes[i]->GetBinContent(b), 2));
-                    }
-                    // and cumulate in the total for this toy as well
-                    totByCh1[pair->second.channel]->Add(&*hist);
-                    (sig[i] ? sigByCh1 : bkgByCh1)[pair->second.channel]->Add(&*hist);
+        const RooAbsCollection &central = sampler.centralValues();
+        std::vector<RooRealVar *> vars;
+        std::vector<int> covIdx;
+        RooFIter itc = central.fwdIterator();
+        int ic = 0;
+        for (RooAbsArg *a = itc.next(); a != 0; a = itc.next(), ++ic) {
+            RooRealVar *v = dynamic_cast<RooRealVar *>(params->find(a->GetName()));
+            if (v == 0) continue;
+            vars.push_back(v);
+            covIdx.push_back(ic);
+        }
+
+        // points in parameter space where the predictions are evaluated; the first one is the current (central) point
+        std::vector<std::vector<double> > points(1, std::vector<double>(vars.size()));
+        for (unsigned int j = 0; j < vars.size(); ++j) points[0][j] = vars[j]->getVal();
+
+        const TMatrixDSym *covar = (shapeUncertaintyMethod_ == "linear" ? sampler.covariance() : 0);
+        if (shapeUncertaintyMethod_ == "linear" && covar == 0 && verbose > 0) {
+            Logger::instance().log(std::string(Form("FitDiagnostics.cc: %d -- No covariance matrix available for %s, using toys for the per-bin uncertainties",__LINE__,postfix.c_str())),Logger::kLogLevelInfo,__func__);
+        }
+        bool linear = (covar != 0);
+        int nsamples; double weight;
+        if (linear) {
+            // Linear propagation of the covariance: C = sum_k u_k u_k^T with u_k = sqrt(lambda_k) v_k from the
+            // eigen-decomposition, so the covariance of the predictions is sum_k d_k d_k^T with d_k the
+            // (symmetric) change of the predictions along u_k
+            if ( verbose > 0 ) Logger::instance().log(std::string(Form("FitDiagnostics.cc: %d -- Propagating the covariance of %d parameters linearly to the per-bin uncertainties",__LINE__,covar->GetNrows())),Logger::kLogLevelInfo,__func__);
+            TMatrixDSymEigen eigen(*covar);
+            const TVectorD &lambda = eigen.GetEigenValues();
+            const TMatrixD &vecs = eigen.GetEigenVectors();
+            for (int k = 0; k < lambda.GetNrows(); ++k) {
+                if (lambda[k] <= 0) continue;
+                double s = std::sqrt(lambda[k]);
+                std::vector<double> plus(points[0]), minus(points[0]);
+                for (unsigned int j = 0; j < vars.size(); ++j) {
+                    plus[j]  += s * vecs(covIdx[j], k);
+                    minus[j] -= s * vecs(covIdx[j], k);
+                }
+                points.push_back(plus);
+                points.push_back(minus);
+            }
+            nsamples = (points.size() - 1) / 2;
+            weight = 1.0;
+        } else {
+            if ( verbose > 0 ) Logger::instance().log(std::string(Form("FitDiagnostics.cc: %d -- Generating toy data for evaluating per-bin uncertainties and covariances with post-fit nuisance parameters with %d toys",__LINE__,ntoys)),Logger::kLogLevelInfo,__func__);
+            sampler.generate(ntoys);
+            for (int t = 0; t < ntoys; ++t) {
+                params->assignValueOnly( sampler.get(t) );
+                points.push_back(std::vector<double>(vars.size()));
+                for (unsigned int j = 0; j < vars.size(); ++j) points.back()[j] = vars[j]->getVal();
+            }
+            params->assignValueOnly( sampler.centralValues() );
+            nsamples = ntoys;
+            weight = 1.0/ntoys;
+        }
+
+        std::vector<std::vector<double> > preds;
+        evalPredictions(procs, nbins, vars, points, preds);
+
+        // position of each channel in the overall histograms
+        std::map<std::string,int> chOffset;
+        int nOverall = 0;
+        for (IH h = totByCh.begin(), eh = totByCh.end(); h != eh; ++h) {
+            chOffset[h->first] = nOverall;
+            nOverall += h->second->GetNbinsX();
+        }
+        std::vector<double> overallCovar(saveOverallShapes_ ? nOverall*nOverall : 0, 0.);
+        std::vector<double> delta(preds[0].size()), dTot(nOverall), dSig(nOverall), dBkg(nOverall);
+        for (int s = 0; s < nsamples; ++s) {
+            const std::vector<double> &p1 = linear ? preds[1+2*s] : preds[1+s];
+            const std::vector<double> &p2 = linear ? preds[2+2*s] : preds[0];
+            for (unsigned int k = 0; k < delta.size(); ++k) delta[k] = linear ? 0.5*(p1[k] - p2[k]) : p1[k] - p2[k];
+            std::fill(dTot.begin(), dTot.end(), 0.);
+            std::fill(dSig.begin(), dSig.end(), 0.);
+            std::fill(dBkg.begin(), dBkg.end(), 0.);
+            // deviations in numbers and in the shapes of each process, and their sums in each channel
+            for (pair = bg, i = 0; pair != ed; ++pair, ++i) {
+                sumx2[i] += weight * std::pow(delta[offset[i]], 2);
+                if (nbins[i] == 0) continue;
+                int o = chOffset[pair->second.channel];
+                for (int b = 0; b < nbins[i]; ++b) {
+                    double d = delta[offset[i]+1+b];
+                    shapes2[i]->AddBinContent(b+1, weight * d * d);
+                    dTot[o+b] += d;
+                    (sig[i] ? dSig : dBkg)[o+b] += d;
                 }
             }
             // now add up the deviations within channels in this toy
-            for (IH h = totByCh1.begin(), eh = totByCh1.end(); h != eh; ++h) {
-                TH1 *target = totByCh2[h->first], *reference = totByCh[h->first];
+            for (IH h = totByCh.begin(), eh = totByCh.end(); h != eh; ++h) {
+                const double *d = &dTot[chOffset[h->first]];
+                TH1 *target = totByCh2[h->first];
                 TH2 *targetCovar = totByCh2Covar[h->first];
                 for (int b = 1, nb = target->GetNbinsX(); b <= nb; ++b) {
-		    double deltaBi = h->second->GetBinContent(b) - reference->GetBinContent(b);
-		    target->AddBinContent(b, std::pow(deltaBi, 2));
-		    int binX = b - 1;
-		    TString xLabel = Form("%s_%d",h->first.c_str(),binX);
-		    for (int bj = 1;bj <= b; bj++) {
-			int binY = bj - 1;
-			TString yLabel = Form("%s_%d",h->first.c_str(),binY);
-			double deltaBj = h->second->GetBinContent(bj) - reference->GetBinContent(bj);
-			targetCovar->AddBinContent(targetCovar->GetBin(b,bj),deltaBj*deltaBi);  // covariance
-			totOverall2Covar->Fill(xLabel,yLabel,deltaBj*deltaBi);
-			if (b != bj) {
-			    targetCovar->AddBinContent(targetCovar->GetBin(bj,b),deltaBj*deltaBi);  // covariance
-			    totOverall2Covar->Fill(yLabel,xLabel,deltaBj*deltaBi);
-			}
-		    }
-		}
-	    }
-            // deviations across channels in this toy
-	    if (saveOverallShapes_){
-		for (IH h = totByCh1.begin(), eh = totByCh1.end(); h != eh; ++h) {
-		    TH1 *reference = totByCh[h->first];
-		    for (IH h2 = totByCh1.begin();h2 != h; ++h2) {
-			TH1 *reference2 = totByCh[h2->first];
-			for (int b = 1, nb = reference->GetNbinsX(); b <= nb; ++b) {
-			    double deltaBi = h->second->GetBinContent(b) - reference->GetBinContent(b);
-			    int binX = b - 1;
-			    TString xLabel = Form("%s_%d",h->first.c_str(),binX);
-			    for (int bj = 1, nb2 = reference2->GetNbinsX(); bj <= nb2; ++bj) {
-				int binY = bj - 1;
-				double deltaBj = h2->second->GetBinContent(bj) - reference2->GetBinContent(bj);
-				TString yLabel = Form("%s_%d",h2->first.c_str(),binY);
-				totOverall2Covar->Fill(xLabel,yLabel,deltaBj*deltaBi);
-				totOverall2Covar->Fill(yLabel,xLabel,deltaBj*deltaBi);
-			    }
-			}
-		    }
-		}
-	    }
-            for (IH h = sigByCh1.begin(), eh = sigByCh1.end(); h != eh; ++h) {
-                TH1 *target = sigByCh2[h->first], *reference = sigByCh[h->first];
-                for (int b = 1, nb = target->GetNbinsX(); b <= nb; ++b) {
-                    target->AddBinContent(b, std::pow(h->second->GetBinContent(b) - reference->GetBinContent(b), 2));
+                    target->AddBinContent(b, weight * d[b-1] * d[b-1]);
+                    for (int bj = 1; bj <= b; ++bj) {
+                        double c = weight * d[b-1] * d[bj-1];
+                        targetCovar->AddBinContent(targetCovar->GetBin(b,bj), c);  // covariance
+                        if (b != bj) targetCovar->AddBinContent(targetCovar->GetBin(bj,b), c);
+                    }
                 }
-            }           
-            for (IH h = bkgByCh1.begin(), eh = bkgByCh1.end(); h != eh; ++h) {
-                TH1 *target = bkgByCh2[h->first], *reference = bkgByCh[h->first];
-                for (int b = 1, nb = target->GetNbinsX(); b <= nb; ++b) {
-                    target->AddBinContent(b, std::pow(h->second->GetBinContent(b) - reference->GetBinContent(b), 2));
+                if (sigByCh2.count(h->first)) {
+                    TH1 *target = sigByCh2[h->first];
+                    const double *d = &dSig[chOffset[h->first]];
+                    for (int b = 1, nb = target->GetNbinsX(); b <= nb; ++b) target->AddBinContent(b, weight * d[b-1] * d[b-1]);
+                }
+                if (bkgByCh2.count(h->first)) {
+                    TH1 *target = bkgByCh2[h->first];
+                    const double *d = &dBkg[chOffset[h->first]];
+                    for (int b = 1, nb = target->GetNbinsX(); b <= nb; ++b) target->AddBinContent(b, weight * d[b-1] * d[b-1]);
                 }
-            }           
+            }
+            // deviations within and across channels in this toy
+            if (saveOverallShapes_) {
+                for (int a = 0; a < nOverall; ++a) {
+                    double *row = &overallCovar[a*nOverall];
+                    for (int b = 0; b < nOverall; ++b) row[b] += weight * dTot[a] * dTot[b];
+                }
+            }
         } // end of the toy loop
         // now take square roots and such
         for (pair = bg, i = 0; pair != ed; ++pair, ++i) {
-            sumx2[i] = sqrt(sumx2[i]/ntoys);
+            sumx2[i] = sqrt(sumx2[i]);
             if (shapes2[i]) {
                 for (int b = 1; b <= bins[i]; ++b) {
-                    shapes[i]->SetBinError(b, std::sqrt(shapes2[i]->GetBinContent(b)/ntoys));
+                    shapes[i]->SetBinError(b, std::sqrt(shapes2[i]->GetBinContent(b)));
                 }
                 delete shapes2[i]; shapes2[i] = 0;
             }
@@ -881,47 +924,37 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
         for (IH h = totByCh.begin(), eh = totByCh.end(); h != eh; ++h) {
             TH1 *sum2   = totByCh2[h->first];
             for (int b = 1, nb = sum2->GetNbinsX(); b <= nb; ++b) {
-		TString xLabel = Form("%s_%d",h->first.c_str(),b-1);
-		totOverall->SetBinError(binMap[xLabel],std::sqrt(sum2->GetBinContent(b)/ntoys));
-                h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b)/ntoys));
+		totOverall->SetBinError(chOffset[h->first]+b,std::sqrt(sum2->GetBinContent(b)));
+                h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b)));
             }
-            delete sum2; delete totByCh1[h->first];
+            delete sum2;
 	}
 	// same for covariance matrix 
-	for (int b = 1, nb = totOverall2Covar->GetNbinsX(); b <= nb; ++b) {
-	    for (int bj = 1, nbj = totOverall2Covar->GetNbinsY(); bj <= nbj; ++bj) {    
-		totOverall2Covar->SetBinContent(b,bj, (totOverall2Covar->GetBinContent(b,bj)/ntoys));
-	    }
-	}
-        for (IH2 h = totByCh2Covar.begin(), eh = totByCh2Covar.end(); h != eh; ++h) {
-            TH2 *covar2 = h->second;
-            for (int b = 1, nb = covar2->GetNbinsX(); b <= nb; ++b) {
-              for (int bj = 1, nbj = covar2->GetNbinsY(); bj <= nbj; ++bj) {    
-		  h->second->SetBinContent(b,bj, (covar2->GetBinContent(b,bj)/ntoys));
-	      }
+	if (saveOverallShapes_) {
+	    for (int a = 0; a < nOverall; ++a) {
+	        for (int b = 0; b < nOverall; ++b) {
+	    	    totOverall2Covar->SetBinContent(a+1,b+1, overallCovar[a*nOverall+b]);
+	        }
 	    }
 	}
 
         for (IH h = sigByCh.begin(), eh = sigByCh.end(); h != eh; ++h) {
             TH1 *sum2 = sigByCh2[h->first];
             for (int b = 1, nb = sum2->GetNbinsX(); b <= nb; ++b) {
-                h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b)/ntoys));
-		TString xLabel = Form("%s_%d",h->first.c_str(),b-1);
-		sigOverall->SetBinError(binMap[xLabel],std::sqrt(sum2->GetBinContent(b)/ntoys));
+                h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b)));
+		sigOverall->SetBinError(chOffset[h->first]+b,std::sqrt(sum2->GetBinContent(b)));
             }
-            delete sum2; delete sigByCh1[h->first];
+            delete sum2;
         }
         for (IH h = bkgByCh.begin(), eh = bkgByCh.end(); h != eh; ++h) {
             TH1 *sum2 = bkgByCh2[h->first];
             for (int b = 1, nb = sum2->GetNbinsX(); b <= nb; ++b) {
-                h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b)/ntoys));
-		TString xLabel = Form("%s_%d",h->first.c_str(),b-1);
-		bkgOverall->SetBinError(binMap[xLabel],std::sqrt(sum2->GetBinContent(b)/ntoys));
+                h->second->SetBinError(b, std::sqrt(sum2->GetBinContent(b)));
+		bkgOverall->SetBinError(chOffset[h->first]+b,std::sqrt(sum2->GetBinContent(b)));
             }
-            delete sum2; delete bkgByCh1[h->first];
+            delete sum2;
         }
-        totByCh1.clear(); totByCh2.clear(); sigByCh1.clear(); sigByCh2.clear(); bkgByCh1.clear(); bkgByCh2.clear();
-	totByCh2.clear();
+        totByCh2.clear(); sigByCh2.clear(); bkgByCh2.clear();
         // finally reset parameters
         params->assignValueOnly( sampler.centralValues() );
     }
@@ -966,6 +999,77 @@ void FitDiagnostics::getNormalizations(RooAbsPdf *pdf, const RooArgSet &obs, Roo
 }
 
 
+void FitDiagnostics::evalPrediction(const ShapeAndNorm &sn, int nbins, double *out) {
+    out[0] = sn.norm->getVal();
+    if (nbins == 0) return;
+    evalBinnedShape(*sn.pdf, *(RooRealVar*)sn.obs.at(0), out[0], nbins, out+1);
+}
+
+void FitDiagnostics::evalBinnedShape(const RooAbsReal &pdf, RooRealVar &x, double norm, int nbins, double *out) {
+    // createHistogram fills each bin with the value at the bin center times the bin
+    // width, and Integral("width") weights the contents by the bin width once more
+    // (checked against createHistogram with variable bins in test/unit/testFitDiagnosticsShapes.cxx)
+    RooArgSet obsSet(x);
+    const RooAbsBinning &binning = x.getBinning();
+    double x0 = x.getVal(), sum = 0;
+    for (int b = 0; b < nbins; ++b) {
+        double w = binning.binWidth(b);
+        x.setVal(binning.binCenter(b));
+        out[b] = pdf.getVal(&obsSet) * w;
+        sum += out[b] * w;
+    }
+    x.setVal(x0);
+    double scale = sum != 0 ? norm/sum : 0;
+    for (int b = 0; b < nbins; ++b) out[b] *= scale;
+}
+
+void FitDiagnostics::evalPredictions(const std::vector<const ShapeAndNorm *> &procs, const std::vector<int> &nbins, const std::vector<RooRealVar *> &vars, const std::vector<std::vector<double> > &points, std::vector<std::vector<double> > &out) {
+    std::vector<int> offset(procs.size()+1, 0);
+    std::map<std::string, std::vector<int> > byChannel;
+    for (unsigned int i = 0; i < procs.size(); ++i) {
+        offset[i+1] = offset[i] + 1 + nbins[i];
+        byChannel[procs[i]->channel].push_back(i);
+    }
+    std::vector<const std::vector<int> *> channels;
+    std::vector<int> sizes;
+    for (std::map<std::string, std::vector<int> >::const_iterator it = byChannel.begin(); it != byChannel.end(); ++it) {
+        channels.push_back(&it->second);
+        sizes.push_back(0);
+        for (int i : it->second) sizes.back() += 1 + nbins[i];
+    }
+    // all the points for one channel at a time, so that the channels can be split across processes
+    auto job = [&](unsigned int ich) {
+        const std::vector<int> &idx = *channels[ich];
+        std::vector<double> ret(points.size() * sizes[ich]);
+        for (unsigned int s = 0; s < points.size(); ++s) {
+            for (unsigned int j = 0; j < vars.size(); ++j) vars[j]->setVal(points[s][j]);
+            double *dest = &ret[s * sizes[ich]];
+            for (int i : idx) {
+                evalPrediction(*procs[i], nbins[i], dest);
+                dest += 1 + nbins[i];
+            }
+        }
+        return ret;
+    };
+    std::vector<std::vector<double> > res;
+    if (shapeUncertaintyWorkers_ > 1) {
+        res = utils::forkJobs(channels.size(), shapeUncertaintyWorkers_, job, /*reseed=*/false);
+    } else {
+        for (unsigned int ich = 0; ich < channels.size(); ++ich) res.push_back(job(ich));
+    }
+    out.assign(points.size(), std::vector<double>(offset.back()));
+    for (unsigned int ich = 0; ich < channels.size(); ++ich) {
+        if (res[ich].size() != points.size() * sizes[ich]) throw std::runtime_error("FitDiagnostics: failed to evaluate the predictions for the uncertainties on the shapes");
+        for (unsigned int s = 0; s < points.size(); ++s) {
+            const double *src = &res[ich][s * sizes[ich]];
+            for (int i : *channels[ich]) {
+                std::copy(src, src + 1 + nbins[i], &out[s][offset[i]]);
+                src += 1 + nbins[i];
+            }
+        }
+    }
+}
+
 //void FitDiagnostics::setFitResultTrees(const RooArgSet *args, std::vector<double> *vals){
 void FitDiagnostics::setFitResultTrees(const RooArgSet *args, double * vals){
 	
@@ -293,6 +293,18 @@ RooFitResult *FitterAlgoBase::doFit(RooAbsPdf &pdf, RooAbsData &data, const RooA
         return ret;
     }
     
+    // With several minos workers, run minos for all the parameters at once: the scans are
+    // then spread over the workers, each starting from the best fit as in the loop below
+    bool minosAll = (!robustFit_ && !do95_ && CascadeMinimizer::minosWorkers() > 1 && rs.getSize() > 1);
+    bool minosAllOk = false;
+    if (minosAll) {
+        if (verbose) Logger::instance().log(std::string(Form("FitterAlgoBase.cc: %d -- Running Minos for %d POIs in parallel",__LINE__,rs.getSize())),Logger::kLogLevelInfo,__func__);
+        minim.minimizer().setPrintLevel(2);
+        if (verbose>1) {tw.Reset(); tw.Start();}
+        minosAllOk = minim.minos(RooArgSet(rs));
+        if (verbose>1) { std::cout << "Run Minos in  "; tw.Print(); std::cout << std::endl; }
+    }
+
     for (int i = 0, n = rs.getSize(); i < n; ++i) {
         // if this is not the first fit, reset parameters  
         if (i) {
@@ -325,7 +337,13 @@ RooFitResult *FitterAlgoBase::doFit(RooAbsPdf &pdf, RooAbsData &data, const RooA
 	
         double r0 = r.getVal(), rMin = r.getMin(), rMax = r.getMax();
 
-       if (!robustFit_) {
+       if (minosAll) {
+            // a parameter whose scan failed has no asymmetric error
+            if (minosAllOk || r.hasAsymError(false)) {
+               rf.setRange("err68", r.getVal() + r.getAsymErrorLo(), r.getVal() + r.getAsymErrorHi());
+               rf.setAsymError(r.getAsymErrorLo(), r.getAsymErrorHi());
+            }
+       } else if (!robustFit_) {
             if (do95_) {
 	    	int badFitResult = -1;
                 throw std::runtime_error("95% CL errors with Minos are not working at the moment.");
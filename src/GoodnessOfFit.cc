@@ -25,6 +25,7 @@
 #include "HiggsAnalysis/CombinedLimit/interface/utils.h"
 #include "HiggsAnalysis/CombinedLimit/interface/CachingNLL.h"
 
+#include <cmath>
 #include <numeric>
 #include <memory>
 
@@ -45,6 +46,7 @@ std::vector<std::string>  GoodnessOfFit::binNames_;
 std::vector<float>        GoodnessOfFit::qVals_;
 std::string GoodnessOfFit::setParametersForFit_ = "";
 std::string GoodnessOfFit::setParametersForEval_ = "";
+bool        GoodnessOfFit::analyticSaturated_ = false;
 
 GoodnessOfFit::GoodnessOfFit() :
     LimitAlgo("GoodnessOfFit specific options")
@@ -58,6 +60,7 @@ GoodnessOfFit::GoodnessOfFit() :
   //      ("minimizerStrategy",  boost::program_options::value<int>(&minimizerStrategy_)->default_value(minimizerStrategy_),      "Stragegy for minimizer")
         ("fixedSignalStrength", boost::program_options::value<float>(&mu_)->default_value(mu_),  "Compute the goodness of fit for a fixed signal strength. If not specified, it's left floating")
         ("plots",  "Make plots containing information of the computation of the Anderson-Darling or Kolmogorov-Smirnov test statistic")
+        ("analyticSaturated", "For the saturated algorithm, compute the likelihood of the saturated model directly from the data, reusing the likelihood of the nominal model across toys")
     ;
 }
 
@@ -74,6 +77,7 @@ void GoodnessOfFit::applyOptions(const boost::program_options::variables_map &vm
       throw std::invalid_argument("GoodnessOfFit: algorithm "+algo_+" not supported");
     }
     makePlots_ = vm.count("plots");
+    analyticSaturated_ = vm.count("analyticSaturated");
 }
 
 bool GoodnessOfFit::run(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint) { 
@@ -83,7 +87,10 @@ bool GoodnessOfFit::run(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::
 
   RooRealVar *r = dynamic_cast<RooRealVar *>(mc_s->GetParametersOfInterest()->first());
   if (fixedMu_) { r->setVal(mu_); r->setConstant(true); }
-  if (algo_ == "saturated") return runSaturatedModel(w, mc_s, mc_b, data, limit, limitErr, hint);
+  if (algo_ == "saturated") {
+    if (analyticSaturated_) return runSaturatedModelAnalytic(w, mc_s, mc_b, data, limit, limitErr, hint);
+    return runSaturatedModel(w, mc_s, mc_b, data, limit, limitErr, hint);
+  }
   static bool is_init = false;
   if (algo_ == "AD" || algo_ == "KS") {
     if (!is_init) {
@@ -223,13 +230,88 @@ bool GoodnessOfFit::runSaturatedModel(RooWorkspace *w, RooStats::ModelConfig *mc
   return true;
 }
 
+bool GoodnessOfFit::runSaturatedModelAnalytic(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint) { 
+  RooAbsPdf *pdf_nominal = mc_s->GetPdf();
+
+  CloseCoutSentry sentry(verbose < 2);
+
+  // The NLL of the nominal model is made only once, and then given the new data
+  cacheutils::CachingSimNLL *simnll = dynamic_cast<cacheutils::CachingSimNLL*>(saturatedNominalNLL_.get());
+  if (saturatedSource_ != pdf_nominal || simnll == 0) {
+    const RooCmdArg &constrainCmdArg = withSystematics  ? RooFit::Constrain(*mc_s->GetNuisanceParameters()) : RooCmdArg();
+    saturatedNominalNLL_.reset(pdf_nominal->createNLL(data, constrainCmdArg));
+    saturatedSource_ = pdf_nominal;
+    simnll = dynamic_cast<cacheutils::CachingSimNLL*>(saturatedNominalNLL_.get());
+  } else {
+    simnll->setData(data);
+  }
+  // The constraints are minimized with all the channels masked, which does not
+  // work together with the masking done for the discrete profiling
+  if (simnll == 0 || CascadeMinimizerGlobalConfigs::O().pdfCategories.getSize() > 0) {
+    sentry.clear();
+    std::cout << "The analytic saturated model needs a CachingSimNLL and no discrete profiling, will use a saturated pdf instead" << std::endl;
+    saturatedNominalNLL_.reset(); saturatedSource_ = nullptr;
+    analyticSaturated_ = false;
+    return runSaturatedModel(w, mc_s, mc_b, data, limit, limitErr, hint);
+  }
+
+  if (setParametersForFit_ != "") {
+    utils::setModelParameters(setParametersForFit_, w->allVars());
+  }
+  {
+    CascadeMinimizer minimn(*simnll, CascadeMinimizer::Unconstrained);
+    minimn.minimize(verbose-2);
+  }
+  // As for runSaturatedModel, the NLLs of two different models are compared, so
+  // the NLL can't be re-zeroed with respect to the initial parameters.
+  simnll->clearConstantZeroPoint();
+
+  if (setParametersForEval_ != "") {
+    utils::setModelParameters(setParametersForEval_, w->allVars());
+  }
+  double nll_nominal = simnll->getVal();
+
+  // The saturated model: in each channel a pdf equal to the data, for which the
+  // NLL depends only on the data, times the constraints, which are minimized alone
+  double nll_saturated = simnll->saturatedChannelsNLL();
+  if (setParametersForFit_ != "") {
+    utils::setModelParameters(setParametersForFit_, w->allVars());
+  }
+  simnll->setMaskAllChannels(true);
+  std::auto_ptr<RooArgSet> constrainedParams(simnll->getParameters((const RooArgSet *)0));
+  if (utils::countFloating(*constrainedParams) > 0) {
+    CascadeMinimizer minims(*simnll, CascadeMinimizer::Unconstrained);
+    minims.minimize(verbose-2);
+  }
+  if (setParametersForEval_ != "") {
+    utils::setModelParameters(setParametersForEval_, w->allVars());
+  }
+  nll_saturated += simnll->getVal();
+  simnll->setMaskAllChannels(false);
+
+  sentry.clear();
+
+  if (fabs(nll_nominal) > 1e10 || fabs(nll_saturated) > 1e10) return false;
+  limit = 2*(nll_nominal-nll_saturated);
+
+  std::cout << "\n --- GoodnessOfFit --- " << std::endl;
+  std::cout << "Best fit test statistic: " << limit << std::endl;
+  return true;
+}
+
 // Code for the Anderson-Darling test originates from https://gist.github.com/neggert/4586791
 bool GoodnessOfFit::runKSandAD(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint, bool kolmo) { 
   RooAbsPdf *pdf = mc_s->GetPdf();
 
-  // Don't want the constraints here
-  RooArgList constraints;
-  RooAbsPdf *obsOnlyPdf = utils::factorizePdf(*mc_s->GetObservables(), *pdf, constraints);
+  // Don't want the constraints here. This makes new objects, so it's done only
+  // once, and then also the cdfs made from them are kept across toys.
+  if (ksadSource_ != pdf) {
+    RooArgList constraints;
+    ksadPdf_ = utils::factorizePdf(*mc_s->GetObservables(), *pdf, constraints);
+    ksadSource_ = pdf;
+    expectedCdfs_.clear();
+  }
+  RooAbsPdf *obsOnlyPdf = ksadPdf_;
 
   //First, find the best fit values
   CloseCoutSentry sentry(verbose < 2);
@@ -298,17 +380,42 @@ bool GoodnessOfFit::runKSandAD(RooWorkspace *w, RooStats::ModelConfig *mc_s, Roo
   return true;
 }
 
+GoodnessOfFit::ExpectedCdf & GoodnessOfFit::expectedCdf(RooAbsPdf &pdf, RooRealVar &observable) {
+    ExpectedCdf &ret = expectedCdfs_[&pdf];
+    if (ret.observable != &observable || !ret.cdf) {
+        // If RooFit needs to use the scanning technique then increase the number
+        // of sampled bins from 1000 to 10000
+        ret.cdf.reset(pdf.createCdf(observable, RooFit::ScanAllCdf(), RooFit::ScanParameters(10000, 2)));
+        ret.params.reset(ret.cdf->getParameters(RooArgSet(observable)));
+        ret.paramVals.clear();
+        ret.observable = &observable;
+    }
+    std::vector<double> paramVals;
+    RooFIter iter = ret.params->fwdIterator();
+    for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+        RooAbsReal *rar = dynamic_cast<RooAbsReal *>(a);
+        RooAbsCategory *cat = dynamic_cast<RooAbsCategory *>(a);
+        paramVals.push_back(rar ? rar->getVal() : (cat ? cat->getIndex() : 0));
+    }
+    int nbins = observable.getBinning().numBins();
+    if (paramVals != ret.paramVals || int(ret.values.size()) != nbins) {
+        ret.paramVals.swap(paramVals);
+        ret.values.assign(nbins, NAN);
+    }
+    return ret;
+}
+
 Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, RooRealVar& observable, bool kolmo) {
     typedef std::pair<double, double> double_pair;
     std::vector<double_pair> data_points;
     Int_t n_data = data.numEntries();
     Double_t s_data = data.sumEntries();
 
-    const RooArgSet* datavals;
-    RooRealVar* observable_val;
+    // the entries are always loaded in the same RooArgSet
+    RooRealVar* observable_val = (RooRealVar*)(data.get()->find(observable.GetName()));
+    data_points.reserve(n_data);
     for (int i = 0; i < n_data; i++) {
-        datavals = data.get(i);
-        observable_val = (RooRealVar*)(datavals->find(observable.GetName()));
+        data.get(i);
         data_points.push_back(std::make_pair(observable_val->getVal(), data.weight()));
     }
 
@@ -325,10 +432,9 @@ Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, Roo
     double bin_prob = 0.;
     double distance = 0.;
 
-    // CDF of the PDF
-    // If RooFit needs to use the scanning technique then increase the number
-    // of sampled bins from 1000 to 10000
-    std::auto_ptr<RooAbsReal> cdf(pdf.createCdf(observable, RooFit::ScanAllCdf(), RooFit::ScanParameters(10000, 2)));
+    // CDF of the PDF, evaluated only once per bin
+    ExpectedCdf &cdf = expectedCdf(pdf, observable);
+    const RooAbsBinning &binning = observable.getBinning();
     TH1 * hCdf = nullptr;
     TH1 * hEdf = nullptr;
     TH1 * hDiff = nullptr;
@@ -348,11 +454,13 @@ Double_t GoodnessOfFit::EvaluateADDistance(RooAbsPdf& pdf, RooAbsData& data, Roo
       
         // This is a better way to get the upper bin edge in the case where we
         // have variable bin widths (I hope)
-        observableval = observable.getBinning().binHigh(
-            observable.getBinning().binNumber(d->first));
-        observable.setVal(observableval);
-        // observable.bin
-        current_cdf_val = cdf->getVal();
+        int ibin = binning.binNumber(d->first);
+        observableval = binning.binHigh(ibin);
+        if (std::isnan(cdf.values[ibin])) {
+            observable.setVal(observableval);
+            cdf.values[ibin] = cdf.cdf->getVal();
+        }
+        current_cdf_val = cdf.values[ibin];
         empirical_df += d->second/s_data;
 
         if (plotDir_ && makePlots_) {
@@ -74,18 +74,17 @@ HZZ4L_RooSpinZeroPdf_2D_fast::HZZ4L_RooSpinZeroPdf_2D_fast(
 {}
 
 
-Float_t HZZ4L_RooSpinZeroPdf_2D_fast::interpolateFcn(Int_t code, const char* rangeName) const{
+bool HZZ4L_RooSpinZeroPdf_2D_fast::getCoefficients(vector<Float_t>& coefs) const{
   Float_t absfai1 = fabs(fai1);
   Float_t absfai2 = fabs(fai2);
   Float_t fa1 = (1.-absfai1 - absfai2);
   
-  if (fa1<0.) return 0;
+  if (fa1<0.) return false;
 
-  DefaultAccumulator<Float_t> value = 0;
   Float_t sgn_fai1 = (fai1>=0. ? 1. : -1.);
   Float_t sgn_fai2 = (fai2>=0. ? 1. : -1.);
 
-  vector<Float_t> coefs; coefs.reserve(9);
+  coefs.clear(); coefs.reserve(9);
   coefs.push_back((Float_t)fa1);
   coefs.push_back((Float_t)absfai1);
   coefs.push_back((Float_t)absfai2);
@@ -96,10 +95,16 @@ Float_t HZZ4L_RooSpinZeroPdf_2D_fast::interpolateFcn(Int_t code, const char* ran
   coefs.push_back((Float_t)sgn_fai2*sqrt(fa1*absfai2)*sin(phi2));
   coefs.push_back((Float_t)sgn_fai1*sgn_fai2*sqrt(absfai1*absfai2)*sin(phi2-phi1));
   if (coefList.getSize() != (Int_t)coefs.size()){
-    cerr << "HZZ4L_RooSpinZeroPdf_2D_fast::interpolateFcn: coefList.getSize()=" << coefList.getSize() << " != coefs.size()=" << coefs.size() << endl;
+    cerr << "HZZ4L_RooSpinZeroPdf_2D_fast::getCoefficients: coefList.getSize()=" << coefList.getSize() << " != coefs.size()=" << coefs.size() << endl;
     assert(0);
   }
+  return true;
+}
+Float_t HZZ4L_RooSpinZeroPdf_2D_fast::interpolateFcn(Int_t code, const char* rangeName) const{
+  vector<Float_t> coefs;
+  if (!getCoefficients(coefs)) return 0;
 
+  DefaultAccumulator<Float_t> value = 0;
   if (code==0){
     for (int ic=0; ic<coefList.getSize(); ic++) value += (Float_t)((dynamic_cast<const RooAbsReal*>(coefList.at(ic))->getVal())*coefs.at(ic));
   }
@@ -39,6 +39,7 @@
 #include "HiggsAnalysis/CombinedLimit/interface/SimplerLikelihoodRatioTestStatExt.h"
 #include "HiggsAnalysis/CombinedLimit/interface/ProfiledLikelihoodRatioTestStatExt.h"
 #include "HiggsAnalysis/CombinedLimit/interface/BestFitSigmaTestStat.h"
+#include "HiggsAnalysis/CombinedLimit/interface/JacknifeQuantile.h"
 #include "HiggsAnalysis/CombinedLimit/interface/ToyMCSamplerOpt.h"
 #include "HiggsAnalysis/CombinedLimit/interface/utils.h"
 #include "HiggsAnalysis/CombinedLimit/interface/Significance.h"
@@ -1226,8 +1227,9 @@ void HybridNew::applyExpectedQuantile(RooStats::HypoTestResult &hcres) {
           applyClsQuantile(hcres);
       } else {
           std::vector<Double_t> btoys = hcres.GetNullDistribution()->GetSamplingDistribution();
-          std::sort(btoys.begin(), btoys.end());
-          Double_t testStat = btoys[std::min<int>(floor((1.-quantileForExpectedFromGrid_) * btoys.size()+0.5), btoys.size())];
+          int index = std::min<int>(floor((1.-quantileForExpectedFromGrid_) * btoys.size()+0.5), btoys.size()-1);
+          std::nth_element(btoys.begin(), btoys.begin() + index, btoys.end());
+          Double_t testStat = btoys[index];
           if (verbose > 0) std::cout << "Text statistics for " << quantileForExpectedFromGrid_ << " quantile: " << testStat << std::endl;
           hcres.SetTestStatisticData(testStat);
           //std::cout << "CLs quantile = " << (CLs_ ? hcres.CLs() : hcres.CLsplusb()) << " for test stat = " << testStat << std::endl;
@@ -1281,17 +1283,13 @@ void HybridNew::applyClsQuantile(RooStats::HypoTestResult &hcres) {
             xcumul.push_back(std::make_pair(CLs_ ? cls : clsb, *it));
         }
     }
-    // sort 
-    std::sort(xcumul.begin(), xcumul.end()); 
-    // get quantile
-    runningSum = 0; double cut = quantileForExpectedFromGrid_ * btot;
-    for (std::vector<std::pair<double,std::pair<double,double> > >::const_iterator it = xcumul.begin(), ed = xcumul.end(); it != ed; ++it) {
-        runningSum += it->second.second; 
-        if (runningSum >= cut) {
-            hcres.SetTestStatisticData(it->second.first);
-            //std::cout << "CLs quantile = " << it->first << " for test stat = " << it->second.first << std::endl;
-            break;
-        }
+    // get quantile: first entry in increasing CLs at which the cumulative weight reaches the cut (no need to sort them all)
+    double cut = quantileForExpectedFromGrid_ * btot;
+    std::vector<std::pair<double,std::pair<double,double> > >::iterator match = QuantileCalculator::weightedSelect(xcumul.begin(), xcumul.end(), cut, true, 
+            [](const std::pair<double,std::pair<double,double> > &x) { return x.second.second; }, runningSum);
+    if (match != xcumul.end()) {
+        hcres.SetTestStatisticData(match->second.first);
+        //std::cout << "CLs quantile = " << match->first << " for test stat = " << match->second.first << std::endl;
     }
     //std::cout << "CLs quantile = " << (CLs_ ? hcres.CLs() : hcres.CLsplusb()) << std::endl;
     //std::cout << "Computed quantiles in " << timer.RealTime() << " s" << std::endl; 
@@ -1314,8 +1312,9 @@ void HybridNew::applyClsQuantile(RooStats::HypoTestResult &hcres) {
 
 void HybridNew::applySignalQuantile(RooStats::HypoTestResult &hcres) {
     std::vector<Double_t> stoys = hcres.GetAltDistribution()->GetSamplingDistribution();
-    std::sort(stoys.begin(), stoys.end());
-    Double_t testStat = stoys[std::min<int>(floor(quantileForExpectedFromGrid_ * stoys.size()+0.5), stoys.size())];
+    int index = std::min<int>(floor(quantileForExpectedFromGrid_ * stoys.size()+0.5), stoys.size()-1);
+    std::nth_element(stoys.begin(), stoys.begin() + index, stoys.end());
+    Double_t testStat = stoys[index];
     if (verbose > 0) std::cout << "Text statistics for " << quantileForExpectedFromGrid_ << " quantile: " << testStat << std::endl;
     hcres.SetTestStatisticData(testStat);
 }
@@ -1340,6 +1339,9 @@ RooStats::HypoTestResult * HybridNew::evalWithFork(RooStats::HybridCalculator &h
     garbageCollect.file = tmpfile;
     std::cout << tmpfile << std::endl;
 
+    // write out the buffered log messages, or each child would write them again
+    fflush(stdout); fflush(stderr);
+    Logger::instance().flush();
     unsigned int ich = 0;
     std::vector<UInt_t> newSeeds(fork_);
     for (ich = 0; ich < fork_; ++ich) {
@@ -1466,13 +1468,15 @@ RooStats::HypoTestResult * HybridNew::readToysFromFile(const RooAbsCollection &
     TIter next(toyDir->GetListOfKeys()); TKey *k;
     while ((k = (TKey *) next()) != 0) {
         if (TString(k->GetName()).Index(prefix1) != 0 && TString(k->GetName()).Index(prefix2) != 0) continue;
-        RooStats::HypoTestResult *toy = dynamic_cast<RooStats::HypoTestResult *>(toyDir->Get(k->GetName()));
+        if (toyDir->GetKey(k->GetName()) != k) continue; // an older cycle of an object that was written again
+        RooStats::HypoTestResult *toy = dynamic_cast<RooStats::HypoTestResult *>(k->ReadObj());
         if (toy == 0) continue;
         if (verbose > 1) std::cout << " - " << k->GetName() << std::endl;
         if (ret.get() == 0) {
-            ret.reset(new RooStats::HypoTestResult(*toy));
+            ret.reset(toy);
         } else {
             ret->Append(toy);
+            delete toy;
         }
     }
 
@@ -1511,9 +1515,12 @@ void HybridNew::readGrid(TDirectory *toyDir, double rMin, double rMax) {
     if (rValues_.getSize() != 1) throw std::runtime_error("Running limits with grid only works in one dimension for the moment");
     clearGrid();
 
+    // first find the keys of each point from their names only, then read and merge the results one point at a time
+    std::map<double, std::vector<TKey *> > pointKeys;
     TIter next(toyDir->GetListOfKeys()); TKey *k; const char *poiName = rValues_.first()->GetName();
     while ((k = (TKey *) next()) != 0) {
         TString name(k->GetName());
+        if (toyDir->GetKey(k->GetName()) != k) continue; // an older cycle of an object that was written again
         if (name.Index("HypoTestResult_mh") == 0) {
             if (name.Index(TString::Format("HypoTestResult_mh%g_%s",mass_,poiName)) != 0 || name.Index("_", name.Index("_")+1) == -1) continue;
             name.ReplaceAll(TString::Format("HypoTestResult_mh%g_%s",mass_,poiName),"");  // remove the prefix
@@ -1528,11 +1535,20 @@ void HybridNew::readGrid(TDirectory *toyDir, double rMin, double rMax) {
         double rVal = atof(name.Data());
         if (rVal < rMin || rVal > rMax) continue;
         if (verbose > 2) std::cout << "  Do " << k->GetName() << " -> " << name << " --> " << rVal << std::endl;
-        RooStats::HypoTestResult *toy = dynamic_cast<RooStats::HypoTestResult *>(toyDir->Get(k->GetName()));
-        RooStats::HypoTestResult *&merge = grid_[rVal];
-        if (merge == 0) merge = new RooStats::HypoTestResult(*toy);
-        else merge->Append(toy);
+        pointKeys[rVal].push_back(k);
+    }
+    // keep the first result of each point and delete the others once appended, so that at most one copy of each is in memory
+    for (std::map<double, std::vector<TKey *> >::const_iterator itp = pointKeys.begin(), edp = pointKeys.end(); itp != edp; ++itp) {
+        RooStats::HypoTestResult *merge = 0;
+        for (std::vector<TKey *>::const_iterator itk = itp->second.begin(), edk = itp->second.end(); itk != edk; ++itk) {
+            RooStats::HypoTestResult *toy = dynamic_cast<RooStats::HypoTestResult *>((*itk)->ReadObj());
+            if (toy == 0) throw std::runtime_error(std::string("HybridNew::readGrid: can't read a HypoTestResult from ")+(*itk)->GetName());
+            if (merge == 0) { merge = toy; continue; }
+            merge->Append(toy);
+            delete toy;
+        }
         merge->ResetBit(1);
+        grid_[itp->first] = merge;
     }
     if (verbose > 1) {
         std::cout << "GRID, as is." << std::endl;
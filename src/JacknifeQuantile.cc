@@ -54,9 +54,7 @@ void QuantileCalculator::randomizePoints()
 std::pair<double,double> QuantileCalculator::quantileAndError(double quantile, Method method) 
 {
     if (method == Simple) {
-        std::sort(points_.begin(), points_.end());
-        quantiles(quantile, false);
-        return std::pair<double,double>(quantiles_[0], 0);
+        return std::pair<double,double>(simpleQuantile(quantile), 0);
     } else if (method == Sectioning || method == Jacknife) {
         int m = guessPartitions(points_.size(), quantile);
         partition(m, (method == Jacknife));
@@ -89,6 +87,22 @@ int QuantileCalculator::guessPartitions(int size, double quantile)
     return n;
 }
 
+double QuantileCalculator::simpleQuantile(double quantile) const
+{
+    // same as quantiles(quantile, false) on the sorted points, but selecting instead of sorting
+    // (on a copy, so that the order of the points used for the sectioning is not changed)
+    if (points_.empty()) return 0;
+    std::vector<point> points(points_);
+    double threshold = quantile * sumw_[0], runningSum = 0;
+    std::vector<point>::iterator ihigh = weightedSelect(points.begin(), points.end(), threshold, false, [](const point &p) { return p.w; }, runningSum);
+    if (ihigh == points.end()) { // all points below threshold
+        return std::max_element(points.begin(), points.end())->x;
+    }
+    std::vector<point>::iterator ilow = (ihigh == points.begin() ? ihigh : std::max_element(points.begin(), ihigh));
+    float ret = (runningSum == threshold ? ilow->x : 0.5*(ilow->x + ihigh->x));
+    return ret;
+}
+
 template<typename T>
 void QuantileCalculator::import(const std::vector<T> &values, const std::vector<T> &weights) 
 {
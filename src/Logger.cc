@@ -19,9 +19,13 @@ int Logger::nLogLevelInfo=0;
 int Logger::nLogLevelDebug=0;
 int Logger::nLogLevelError=0;
 
+int Logger::sMinLevel=0;
+
 const char* const Logger::kLogFileName = "combine_logger.out";
 
-Logger* Logger::pInstance = nullptr;
+const size_t Logger::kBufferSize = 1 << 16;
+
+atomic<Logger*> Logger::pInstance(nullptr);
 
 mutex Logger::sMutex;
 
@@ -29,18 +33,36 @@ Logger& Logger::instance()
 {
 	static Cleanup cleanup;
 
+	Logger *ret = pInstance.load(memory_order_acquire);
+	if (ret != nullptr) return *ret;
+
 	lock_guard<mutex> guard(sMutex);
-	if (pInstance == nullptr)
-		pInstance = new Logger();
+	if (pInstance.load(memory_order_relaxed) == nullptr)
+		pInstance.store(new Logger(), memory_order_release);
 
-	return *pInstance;
+	return *pInstance.load(memory_order_relaxed);
 }
 
 Logger::Cleanup::~Cleanup()
 {
 	lock_guard<mutex> guard(Logger::sMutex);
-	delete Logger::pInstance;
-	Logger::pInstance = nullptr;
+	delete Logger::pInstance.load();
+	Logger::pInstance.store(nullptr);
+}
+
+Logger::Buffer& Logger::threadBuffer()
+{
+	thread_local Buffer buffer;
+	return buffer;
+}
+
+Logger::Buffer::~Buffer()
+{
+	// thread-local objects are destroyed before the static Cleanup, so the
+	// instance is still there unless nothing was ever logged
+	if (text.empty() || Logger::pInstance.load() == nullptr) return;
+	lock_guard<mutex> guard(Logger::sMutex);
+	Logger::pInstance.load()->writeBuffer(*this);
 }
 
 Logger::~Logger()
@@ -56,15 +78,23 @@ Logger::Logger()
 	} 
 }
 
+void Logger::setMinLevel(const string& inLogLevel)
+{
+	if (inLogLevel != kLogLevelDebug && inLogLevel != kLogLevelInfo && inLogLevel != kLogLevelError) {
+		throw invalid_argument("Logger: unknown log level " + inLogLevel);
+	}
+	sMinLevel = levelNumber(inLogLevel);
+}
+
 void Logger::log(const string& inMessage, const string& inLogLevel, const string& inFunction)
 {
-	lock_guard<mutex> guard(sMutex);
+	if (!enabled(inLogLevel)) return;
 	logHelper(inMessage, inLogLevel, inFunction);
 }
 
 void Logger::log(const vector<string>& inMessages, const string& inLogLevel, const string& inFunction)
 {
-	lock_guard<mutex> guard(sMutex);
+	if (!enabled(inLogLevel)) return;
 	for (size_t i = 0; i < inMessages.size(); i++) {
 		logHelper(inMessages[i], inLogLevel, inFunction);
 	}
@@ -72,14 +102,45 @@ void Logger::log(const vector<string>& inMessages, const string& inLogLevel, con
 
 void Logger::logHelper(const std::string& inMessage, const std::string& inLogLevel, const std::string& inFunction)
 {
-	mOutputStream << inLogLevel << ": (function: " << inFunction << ") "  << inMessage << endl;
-	if (inLogLevel == kLogLevelInfo)  nLogLevelInfo++;
-	if (inLogLevel == kLogLevelDebug) nLogLevelDebug++;
-	if (inLogLevel == kLogLevelError) nLogLevelError++;
+	Buffer &buffer = threadBuffer();
+	buffer.text += inLogLevel;
+	buffer.text += ": (function: ";
+	buffer.text += inFunction;
+	buffer.text += ") ";
+	buffer.text += inMessage;
+	buffer.text += '\n';
+	if (inLogLevel == kLogLevelInfo)  buffer.nInfo++;
+	if (inLogLevel == kLogLevelDebug) buffer.nDebug++;
+	if (inLogLevel == kLogLevelError) buffer.nError++;
+	// errors are written out immediately, in case the job dies afterwards
+	if (buffer.text.size() >= kBufferSize || inLogLevel == kLogLevelError) {
+		lock_guard<mutex> guard(sMutex);
+		writeBuffer(buffer);
+	}
+}
+
+void Logger::writeBuffer(Buffer& buffer)
+{
+	mOutputStream.write(buffer.text.data(), buffer.text.size());
+	mOutputStream.flush();
+	buffer.text.clear();
+	nLogLevelInfo  += buffer.nInfo;
+	nLogLevelDebug += buffer.nDebug;
+	nLogLevelError += buffer.nError;
+	buffer.nInfo = buffer.nDebug = buffer.nError = 0;
+}
+
+void Logger::flush()
+{
+	Buffer &buffer = threadBuffer();
+	if (buffer.text.empty()) return;
+	lock_guard<mutex> guard(sMutex);
+	writeBuffer(buffer);
 }
 
 void Logger::printLog()
 {
+	flush();
 	std::cout << "Printing Message Summary From ... " << kLogFileName << std::endl;
 	std::cout << "----------------------------------------------" << std::endl;
 	std::cout << "Messages of type " << kLogLevelInfo  << " : " << nLogLevelInfo  << std::endl;
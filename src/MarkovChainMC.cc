@@ -20,6 +20,7 @@ class THnSparse;
 #include "RooStats/RooStatsUtils.h"
 #include "HiggsAnalysis/CombinedLimit/interface/Combine.h"
 #include "HiggsAnalysis/CombinedLimit/interface/TestProposal.h"
+#include "HiggsAnalysis/CombinedLimit/interface/AdaptiveProposal.h"
 #include "HiggsAnalysis/CombinedLimit/interface/DebugProposal.h"
 #include "HiggsAnalysis/CombinedLimit/interface/CloseCoutSentry.h"
 #include "HiggsAnalysis/CombinedLimit/interface/RooFitGlobalKillSentry.h"
@@ -42,6 +43,9 @@ unsigned int MarkovChainMC::burnInSteps_ = 200;
 float MarkovChainMC::burnInFraction_ = 0.25;
 bool  MarkovChainMC::adaptiveBurnIn_ = false;
 unsigned int MarkovChainMC::tries_ = 10;
+unsigned int MarkovChainMC::parallelChains_ = 0;
+unsigned int MarkovChainMC::adaptAfter_ = 500;
+unsigned int MarkovChainMC::adaptEvery_ = 200;
 float MarkovChainMC::truncatedMeanFraction_ = 0.0;
 bool MarkovChainMC::adaptiveTruncation_ = true;
 float MarkovChainMC::hintSafetyFactor_ = 5.;
@@ -62,11 +66,17 @@ MarkovChainMC::MarkovChainMC() :
     options_.add_options()
         ("iteration,i", boost::program_options::value<unsigned int>(&iterations_)->default_value(iterations_), "Number of iterations")
         ("tries", boost::program_options::value<unsigned int>(&tries_)->default_value(tries_), "Number of times to run the MCMC on the same data")
+        ("parallelChains", boost::program_options::value<unsigned int>(&parallelChains_)->default_value(parallelChains_), 
+                              "Run the tries in N forked processes, each chain with its own random seed (0 or 1 == no forking; --updateHint is ignored)")
         ("burnInSteps,b", boost::program_options::value<unsigned int>(&burnInSteps_)->default_value(burnInSteps_), "Burn in steps (absolute number)")
         ("burnInFraction", boost::program_options::value<float>(&burnInFraction_)->default_value(burnInFraction_), "Burn in steps (fraction of total accepted steps)")
         ("adaptiveBurnIn", boost::program_options::value<bool>(&adaptiveBurnIn_)->default_value(adaptiveBurnIn_), "Adaptively determine burn in steps (experimental!).")
         ("proposal", boost::program_options::value<std::string>(&proposalTypeName_)->default_value(proposalTypeName_), 
-                              "Proposal function to use: 'fit', 'uniform', 'gaus', 'ortho' (also known as 'test')")
+                              "Proposal function to use: 'fit', 'uniform', 'gaus', 'ortho' (also known as 'test'), 'adaptive'")
+        ("adaptAfter", boost::program_options::value<unsigned int>(&adaptAfter_)->default_value(adaptAfter_), 
+                              "With the 'adaptive' proposal, start using the covariance of the chain after N steps")
+        ("adaptEvery", boost::program_options::value<unsigned int>(&adaptEvery_)->default_value(adaptEvery_), 
+                              "With the 'adaptive' proposal, update the covariance every N steps")
         ("runMinos",          "Run MINOS when fitting the data")
         ("noReset",           "Don't reset variable state after fit")
         ("updateHint",        "Update hint with the results")
@@ -109,6 +119,7 @@ void MarkovChainMC::applyOptions(const boost::program_options::variables_map &vm
     else if (proposalTypeName_ == "gaus")    proposalType_ = MultiGaussianP;
     else if (proposalTypeName_ == "ortho")   proposalType_ = TestP;
     else if (proposalTypeName_ == "test")    proposalType_ = TestP;
+    else if (proposalTypeName_ == "adaptive") proposalType_ = AdaptiveP;
     else {
         std::cerr << "MarkovChainMC: proposal type " << proposalTypeName_ << " not known." << "\n" << options_ << std::endl;
         throw std::invalid_argument("MarkovChainMC: unsupported proposal");
@@ -125,6 +136,9 @@ void MarkovChainMC::applyOptions(const boost::program_options::variables_map &vm
     readChains_  = vm.count("readChains");
 
     if (mergeChains_ && !saveChain_ && !readChains_) chains_.SetOwner(true);
+    if (parallelChains_ > 1 && noSlimChain_) {
+        std::cerr << "MarkovChainMC: --noSlimChain is not supported with --parallelChains, only the POIs will be kept in the chains." << std::endl;
+    }
 }
 
 bool MarkovChainMC::run(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint) {
@@ -147,6 +161,8 @@ bool MarkovChainMC::run(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::
   std::vector<double> limits;
   if (readChains_)  {
       readChains(*mc_s->GetParametersOfInterest(), limits);
+  } else if (parallelChains_ > 1 && tries_ > 1) {
+      suma = runParallel(w,mc_s,mc_b,data,thehint,limits);
   } else {
       for (unsigned int i = 0; i < tries_; ++i) {
           if (int nacc = runOnce(w,mc_s,mc_b,data,limit,limitErr,thehint)) {
@@ -187,7 +203,32 @@ bool MarkovChainMC::run(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::
   }
   return true;
 }
-int MarkovChainMC::runOnce(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint) const {
+int MarkovChainMC::runParallel(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, const double *hint, std::vector<double> &limits) const {
+  // each child returns (limit, number of items in chain, packed chain if needed)
+  bool keepChains = (saveChain_ || mergeChains_);
+  std::vector<std::vector<double> > results = utils::forkJobs(tries_, parallelChains_, [&](unsigned int itry) {
+          std::vector<double> ret(2, 0.);
+          double mylimit = 0, mylimitErr = 0;
+          int nacc = runOnce(w,mc_s,mc_b,data,mylimit,mylimitErr,hint, keepChains ? &ret : 0);
+          ret[0] = mylimit; ret[1] = nacc;
+          return ret;
+      });
+  int nacc = 0;
+  for (unsigned int i = 0; i < tries_; ++i) {
+      const std::vector<double> &res = results[i];
+      if (res.size() < 2 || res[1] == 0) { 
+          if (verbose > 1) std::cout << "Run " << i << " failed." << std::endl;
+          continue; 
+      }
+      nacc += res[1];
+      if (verbose > 1) std::cout << "Limit from run " << i << ": " << res[0] << std::endl;
+      limits.push_back(res[0]);
+      if (keepChains) storeChain(unpackChain(*mc_s->GetParametersOfInterest(), res, 2));
+  }
+  return nacc;
+}
+
+int MarkovChainMC::runOnce(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint, std::vector<double> *packedChain) const {
   RooArgList poi(*mc_s->GetParametersOfInterest());
   RooRealVar *r = dynamic_cast<RooRealVar *>(poi.first());
 
@@ -272,8 +313,13 @@ int MarkovChainMC::runOnce(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStat
         }
         pdfProp = ownedPdfProp.get();
         break;
+    case AdaptiveP:
+        if (verbose) std::cout << "Using adaptive proposal" << std::endl;
+        ownedPdfProp.reset(new AdaptiveProposal(proposalHelperWidthRangeDivisor_, adaptAfter_, adaptEvery_));
+        pdfProp = ownedPdfProp.get();
+        break;
   }
-  if (proposalType_ != UniformP) {
+  if (proposalType_ != UniformP && proposalType_ != AdaptiveP) {
       ph.SetUpdateProposalParameters(updateProposalParams_);
       if (proposalHelperUniformFraction_ > 0) ph.SetUniformFraction(proposalHelperUniformFraction_);
   }
@@ -326,18 +372,50 @@ int MarkovChainMC::runOnce(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStat
 
   limit = mcInt->UpperLimit(*r);
 
-  if (saveChain_ || mergeChains_) {
+  if (packedChain) {
+      packChain(*mc_s->GetParametersOfInterest(), *mcInt->GetChain(), *packedChain);
+      return mcInt->GetChain()->Size();
+  } else if (saveChain_ || mergeChains_) {
       // Copy-constructors don't work properly, so we just have to leak memory.
       //RooStats::MarkovChain *chain = new RooStats::MarkovChain(*mcInt->GetChain());
       RooStats::MarkovChain *chain = slimChain(*mc_s->GetParametersOfInterest(), *mcInt->GetChain());
-      if (mergeChains_) chains_.Add(chain);
-      if (saveChain_)  writeToysHere->WriteTObject(chain,  TString::Format("MarkovChain_mh%g_%u",mass_, RooRandom::integer(std::numeric_limits<UInt_t>::max() - 1)));
+      storeChain(chain);
       return chain->Size();
   } else {
       return mcInt->GetChain()->Size();
   }
 }
 
+void MarkovChainMC::storeChain(RooStats::MarkovChain *chain) const {
+  if (mergeChains_) chains_.Add(chain);
+  if (saveChain_)  writeToysHere->WriteTObject(chain,  TString::Format("MarkovChain_mh%g_%u",mass_, RooRandom::integer(std::numeric_limits<UInt_t>::max() - 1)));
+}
+
+void MarkovChainMC::packChain(const RooArgSet &poi, const RooStats::MarkovChain &chain, std::vector<double> &out) const {
+  RooArgList poilist(poi);
+  int npoi = poilist.getSize();
+  out.reserve(out.size() + chain.Size() * (npoi + 2));
+  for (int i = 0, n = chain.Size(); i < n; ++i) {
+      const RooArgSet *entry = chain.Get(i);
+      for (int j = 0; j < npoi; ++j) out.push_back(entry->getRealValue(poilist.at(j)->GetName()));
+      out.push_back(chain.NLL());
+      out.push_back(chain.Weight());
+  }
+}
+
+RooStats::MarkovChain *MarkovChainMC::unpackChain(const RooArgSet &poi, const std::vector<double> &in, unsigned int start) const {
+  RooArgSet poiclone; poiclone.addClone(poi);
+  RooArgList poilist(poiclone);
+  unsigned int npoi = poilist.getSize();
+  RooStats::MarkovChain * ret = new RooStats::MarkovChain("","",poiclone);
+  for (unsigned int i = start, n = in.size(); i + npoi + 2 <= n; i += npoi + 2) {
+      for (unsigned int j = 0; j < npoi; ++j) ((RooRealVar *)poilist.at(j))->setVal(in[i+j]);
+      if (i > start) ret->AddFast(poiclone, in[i+npoi], in[i+npoi+1]);
+      else           ret->Add(poiclone, in[i+npoi], in[i+npoi+1]);
+  }
+  return ret;
+}
+
 void MarkovChainMC::limitAndError(double &limit, double &limitErr, const std::vector<double> &limitsIn) const {
   std::vector<double> limits(limitsIn);
   int num = limits.size();
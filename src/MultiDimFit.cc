@@ -10,6 +10,7 @@
 #include "RooAbsData.h"
 #include "RooCategory.h"
 #include "RooFitResult.h"
+#include "TMatrixDSym.h"
 //#include "HiggsAnalysis/CombinedLimit/interface/RooMinimizerOpt.h"
 #include "RooMinimizer.h"
 #include <RooStats/ModelConfig.h>
@@ -55,6 +56,9 @@ float MultiDimFit::centeredRange_ = -1.0;
 bool        MultiDimFit::robustHesse_ = false;
 std::string MultiDimFit::robustHesseLoad_ = "";
 std::string MultiDimFit::robustHesseSave_ = "";
+int  MultiDimFit::impactWorkers_ = 0;
+bool MultiDimFit::impactWarmStart_ = false;
+bool MultiDimFit::impactHesse_ = false;
 
 
 std::string MultiDimFit::saveSpecifiedFuncs_;
@@ -103,6 +107,9 @@ MultiDimFit::MultiDimFit() :
     ("robustHesse",  boost::program_options::value<bool>(&robustHesse_)->default_value(robustHesse_),  "Use a more robust calculation of the hessian/covariance matrix")
     ("robustHesseLoad",  boost::program_options::value<std::string>(&robustHesseLoad_)->default_value(robustHesseLoad_),  "Load the pre-calculated Hessian")
     ("robustHesseSave",  boost::program_options::value<std::string>(&robustHesseSave_)->default_value(robustHesseSave_),  "Save the calculated Hessian")
+    ("impactWorkers",  boost::program_options::value<int>(&impactWorkers_)->default_value(impactWorkers_),  "For --algo impact: if N > 1, run the fits for the impacts in N forked processes")
+    ("impactWarmStart",  boost::program_options::value<bool>(&impactWarmStart_)->default_value(impactWarmStart_),  "For --algo impact: start each fit from the best fit shifted along the covariance of the fixed parameter")
+    ("impactHesse",  "For --algo impact: only compute the first-order estimate of the impacts from the covariance matrix of the initial fit, without MINOS or further fits")
       ;
 }
 
@@ -140,6 +147,7 @@ void MultiDimFit::applyOptions(const boost::program_options::variables_map &vm)
     savingSnapshot_ = vm.count("saveWorkspace");
     name_ = vm["name"].defaulted() ?  std::string() : vm["name"].as<std::string>();
     saveFitResult_ = (vm.count("saveFitResult") > 0);
+    impactHesse_ = (vm.count("impactHesse") > 0);
 }
 
 bool MultiDimFit::runSpecific(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooStats::ModelConfig *mc_b, RooAbsData &data, double &limit, double &limitErr, const double *hint) { 
@@ -177,7 +185,9 @@ bool MultiDimFit::runSpecific(RooWorkspace *w, RooStats::ModelConfig *mc_s, RooS
     if (verbose <= 3) RooAbsReal::setEvalErrorLoggingMode(RooAbsReal::CountErrors);
     bool doHesse = (algo_ == Singles || algo_ == Impact) || (saveFitResult_) ;
     if ( !skipInitialFit_){
-        res.reset(doFit(pdf, data, (doHesse ? poiList_ : RooArgList()), constrainCmdArg, (saveFitResult_ && !robustHesse_), 1, true, false));
+        // for the first-order impacts we need the covariance matrix but no MINOS
+        bool impactHesseOnly = (algo_ == Impact && impactHesse_);
+        res.reset(doFit(pdf, data, (doHesse && !impactHesseOnly ? poiList_ : RooArgList()), constrainCmdArg, (saveFitResult_ && !robustHesse_) || impactHesseOnly, 1, true, impactHesseOnly));
         if (!res.get()) {
             std::cout << "\n " <<std::endl;
             std::cout << "\n ---------------------------" <<std::endl;
@@ -483,7 +493,7 @@ void MultiDimFit::doSingles(RooFitResult &res)
 
 void MultiDimFit::doImpact(RooFitResult &res, RooAbsReal &nll) {
   std::cout << "\n --- MultiDimFit ---" << std::endl;
-  std::cout << "Parameter impacts: " << std::endl;
+  std::cout << "Parameter impacts" << (impactHesse_ ? " (first-order estimate from the covariance matrix)" : "") << ": " << std::endl;
 
   // Save the initial parameters here to reset between NPs
   std::auto_ptr<RooArgSet> params(nll.getParameters((const RooArgSet *)0));
@@ -500,14 +510,12 @@ void MultiDimFit::doImpact(RooFitResult &res, RooAbsReal &nll) {
   for (int i = 0, n = poi_.size(); i < n; ++i) {
     len = std::max<int>(len, poi_[i].length());
   }
-  printf("  %-*s :   %-21s", len, "Parameter", "Best-fit");
-  for (int i = 0, n = specifiedNuis_.size(); i < n; ++i) {
-    printf("  %-13s", specifiedNuis_[i].c_str());
-  }
-  printf("\n");
-
 
-  for (int i = 0, n = poi_.size(); i < n; ++i) {
+  // Best-fit values and the two points at which each parameter is fixed
+  unsigned int npoi = poi_.size();
+  std::vector<double> bestFitVals(npoi);
+  std::vector<std::vector<double> > doVals(npoi);
+  for (unsigned int i = 0; i < npoi; ++i) {
     RooAbsArg *rfloat = res.floatParsFinal().find(poi_[i].c_str());
     if (!rfloat) {
       rfloat = res.constPars().find(poi_[i].c_str());
@@ -519,44 +527,96 @@ void MultiDimFit::doImpact(RooFitResult &res, RooAbsReal &nll) {
                                            : rf->getAsymErrorHi());
     double loErr = -(rf->hasRange("err68") ? rf->getMin("err68") - bestFitVal
                                            : rf->getAsymErrorLo());
-      printf("  %-*s : %+8.3f  %+6.3f/%+6.3f", len, poi_[i].c_str(),
-                    bestFitVal, -loErr, hiErr);
+    if (impactHesse_) hiErr = loErr = rf->getError();
+    bestFitVals[i] = bestFitVal;
+    doVals[i] = {bestFitVal - loErr, bestFitVal + hiErr};
+  }
+
+  // Shift of the floating parameters expected when parameter i moves to val,
+  // at first order: delta theta_m = C_mi / C_ii * (val - theta_i)
+  const TMatrixDSym &covar = res.covarianceMatrix();
+  const RooArgList &floats = res.floatParsFinal();
+  if (impactHesse_ && covar.GetNrows() != floats.getSize()) {
+    std::cerr << "MultiDimFit: no valid covariance matrix from the initial fit, the first-order impacts will be zero" << std::endl;
+  }
+  auto linearShift = [&](unsigned int i, double val, std::vector<double> &shift) -> bool {
+    shift.assign(floats.getSize(), 0.);
+    RooAbsArg *a = floats.find(poi_[i].c_str());
+    int k = a ? floats.index(a) : -1;
+    if (k < 0 || covar.GetNrows() != floats.getSize() || covar(k,k) <= 0) return false;
+    double x = (val - bestFitVals[i]) / covar(k,k);
+    for (int m = 0, nm = floats.getSize(); m < nm; ++m) shift[m] = covar(m,k) * x;
+    return true;
+  };
+
+  // Each fit reports: status, the POIs, the specified parameters, functions and categories
+  unsigned int nvals = 1 + poiVars_.size() + specifiedVars_.size() + specifiedFunc_.size() + specifiedCat_.size();
+  auto packState = [&](bool ok) {
+    std::vector<double> ret; ret.reserve(nvals);
+    ret.push_back(ok);
+    for (unsigned int j = 0; j < poiVars_.size(); j++) ret.push_back(poiVars_[j]->getVal());
+    for (unsigned int j = 0; j < specifiedVars_.size(); j++) ret.push_back(specifiedVars_[j]->getVal());
+    for (unsigned int j = 0; j < specifiedFunc_.size(); j++) ret.push_back(specifiedFunc_[j]->getVal());
+    for (unsigned int j = 0; j < specifiedCat_.size(); j++) ret.push_back(specifiedCat_[j]->getIndex());
+    return ret;
+  };
+
+  // One job per fit: parameter i = job/2 fixed at the low (even) or high (odd) point
+  auto job = [&](unsigned int ijob) {
+    unsigned int i = ijob / 2, x = ijob % 2;
     // Reset all parameters to initial state
     *params = init_snap;
+    std::vector<double> shift;
+    if ((impactHesse_ || impactWarmStart_) && linearShift(i, doVals[i][x], shift)) {
+      for (int m = 0, nm = floats.getSize(); m < nm; ++m) {
+        RooRealVar *v = dynamic_cast<RooRealVar *>(params->find(floats.at(m)->GetName()));
+        if (v) v->setVal(((RooRealVar *)floats.at(m))->getVal() + shift[m]);
+      }
+    }
+    poiVars_[i]->setVal(doVals[i][x]);
+    if (impactHesse_) return packState(true);
     // Then set this NP constant
     poiVars_[i]->setConstant(true);
     CascadeMinimizer minim(nll, CascadeMinimizer::Constrained);
     //minim.setStrategy(minimizerStrategy_);
-    // Another snapshot to reset between high and low fits
-    RooArgSet snap;
-    params->snapshot(snap);
-    std::vector<double> doVals = {bestFitVal - loErr, bestFitVal + hiErr};
-    for (unsigned x = 0; x < doVals.size(); ++x) {
-      *params = snap;
-      poiVals_[i] = doVals[x];
-      poiVars_[i]->setVal(doVals[x]);
-      bool ok = minim.minimize(verbose - 1);
-      if (ok) {
-        for (unsigned int j = 0; j < poiVars_.size(); j++) {
-          poiVals_[j] = poiVars_[j]->getVal();
-        }
-        for (unsigned int j = 0; j < specifiedNuis_.size(); j++) {
-          specifiedVals_[j] = specifiedVars_[j]->getVal();
-        }
-        for (unsigned int j = 0; j < specifiedFuncNames_.size(); j++) {
-          specifiedFuncVals_[j] = specifiedFunc_[j]->getVal();
-        }
-        for (unsigned int j = 0; j < specifiedCatNames_.size(); j++) {
-          specifiedCatVals_[j] = specifiedCat_[j]->getIndex();
-        }
-        Combine::commitPoint(true, /*quantile=*/0.32);
+    bool ok = minim.minimize(verbose - 1);
+    std::vector<double> ret = packState(ok);
+    poiVars_[i]->setConstant(false);
+    return ret;
+  };
+
+  std::vector<std::vector<double> > results;
+  if (impactWorkers_ > 1 && !impactHesse_) {
+    results = utils::forkJobs(2*npoi, impactWorkers_, job, /*reseed=*/false);
+  } else {
+    for (unsigned int ijob = 0; ijob < 2*npoi; ++ijob) results.push_back(job(ijob));
+  }
+  *params = init_snap;
+
+  printf("  %-*s :   %-21s", len, "Parameter", "Best-fit");
+  for (int i = 0, n = specifiedNuis_.size(); i < n; ++i) {
+    printf("  %-13s", specifiedNuis_[i].c_str());
+  }
+  printf("\n");
+
+  for (unsigned int i = 0; i < npoi; ++i) {
+    printf("  %-*s : %+8.3f  %+6.3f/%+6.3f", len, poi_[i].c_str(),
+                  bestFitVals[i], doVals[i][0] - bestFitVals[i], doVals[i][1] - bestFitVals[i]);
+    for (unsigned x = 0; x < 2; ++x) {
+      poiVals_[i] = doVals[i][x];
+      const std::vector<double> &r = results[2*i+x];
+      if (r.size() != nvals) {
+        std::cerr << "MultiDimFit: the fit of " << poi_[i] << " at " << doVals[i][x] << " did not report back" << std::endl;
+        continue;
       }
+      unsigned int k = 1;
+      for (unsigned int j = 0; j < poiVars_.size(); j++) poiVals_[j] = r[k++];
+      for (unsigned int j = 0; j < specifiedNuis_.size(); j++) specifiedVals_[j] = r[k++];
+      for (unsigned int j = 0; j < specifiedFuncNames_.size(); j++) specifiedFuncVals_[j] = r[k++];
+      for (unsigned int j = 0; j < specifiedCatNames_.size(); j++) specifiedCatVals_[j] = int(r[k++]);
+      if (r[0]) Combine::commitPoint(true, /*quantile=*/0.32);
       for (unsigned int j = 0; j < specifiedNuis_.size(); j++) {
-        if (x == 0) {
-          impactLo[j] = specifiedVars_[j]->getVal() - specifiedVals[j];
-        } else if (x == 1) {
-          impactHi[j] = specifiedVars_[j]->getVal() - specifiedVals[j];
-        }
+        (x == 0 ? impactLo : impactHi)[j] = specifiedVals_[j] - specifiedVals[j];
       }
     }
     for (unsigned j = 0; j < specifiedVals.size(); ++j) {
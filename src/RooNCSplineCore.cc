@@ -1,5 +1,6 @@
 #include "HiggsAnalysis/CombinedLimit/interface/RooNCSplineCore.h" 
 #include <cmath>
+#include <algorithm>
 #include "TMath.h"
 #include "TIterator.h"
 #include "Riostream.h"
@@ -271,6 +272,23 @@ RooNCSplineCore::T RooNCSplineCore::evalSplineSegment(const std::vector<RooNCSpl
   return res;
 }
 
+void RooNCSplineCore::getBinsAndTVars(unsigned int n, const Double_t* vals, const std::vector<RooNCSplineCore::T>& coord, const std::vector<RooNCSplineCore::T>& kappas, const Int_t whichDirection, std::vector<Int_t>& bins, std::vector<RooNCSplineCore::T>& tvars, std::vector<char>& inRange)const{
+  bins.resize(n);
+  tvars.resize(n);
+  inRange.resize(n, 1);
+  const Int_t lastbin = std::max(0, (Int_t)coord.size()-2);
+  for (unsigned int i=0; i<n; i++){
+    const RooNCSplineCore::T val = vals[i];
+    if (!testRangeValidity(val, whichDirection)) inRange[i] = 0;
+    // Same bin as getWhichBin: coord[bin]<=val<coord[bin+1], values outside the grid going to the first or last bin
+    Int_t bin = Int_t(std::upper_bound(coord.begin(), coord.end(), val) - coord.begin()) - 1;
+    if (bin<0) bin = 0;
+    else if (bin>lastbin) bin = lastbin;
+    bins[i] = bin;
+    tvars[i] = (val-coord[bin])*kappas[bin];
+  }
+}
+
 void RooNCSplineCore::getLeafDependents(RooRealProxy& proxy, RooArgSet& set){
   RooArgSet deps;
   proxy.absArg()->leafNodeServerList(&deps, 0, true);
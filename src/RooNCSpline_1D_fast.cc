@@ -203,6 +203,37 @@ Double_t RooNCSpline_1D_fast::analyticalIntegral(Int_t code, const char* rangeNa
   return value;
 }
 
+RooArgList RooNCSpline_1D_fast::getCoordinates()const{ return RooArgList(theXVar.arg()); }
+
+void RooNCSpline_1D_fast::evaluateBatch(unsigned int n, const std::vector<const Double_t*>& coords, Double_t* out)const{
+  const unsigned int nxbins = coefficients.size();
+  const unsigned int ncx = coefficients.at(0).size();
+  if (flatCoefficients.empty()){
+    flatCoefficients.reserve(nxbins*ncx);
+    for (unsigned int ix=0; ix<nxbins; ix++) flatCoefficients.insert(flatCoefficients.end(), coefficients.at(ix).begin(), coefficients.at(ix).end());
+  }
+
+  const Double_t* x = coords.at(0);
+  vector<Int_t> xbin; vector<RooNCSplineCore::T> tx; vector<char> inRange(n, 1);
+  getBinsAndTVars(n, x, XList, kappaX, 0, xbin, tx, inRange);
+
+  const RooNCSplineCore::T* coefs = &flatCoefficients[0];
+  for (unsigned int i=0; i<n; i++){
+    const RooNCSplineCore::T* c = coefs + xbin[i]*ncx;
+    Double_t value = 0;
+    for (unsigned int icx=ncx; icx-->0;) value = value*tx[i] + c[icx];
+    out[i] = (inRange[i] ? value : 0.);
+  }
+  if (useFloor){
+    for (unsigned int i=0; i<n; i++){
+      if (out[i]<floorEval){
+        if (verbosity>=RooNCSplineCore::kError) coutE(Eval) << "RooNCSpline_1D_fast ERROR::RooNCSpline_1D_fast(" << GetName() << ") evaluation returned " << out[i] << " at x = " << x[i] << endl;
+        out[i] = floorEval;
+      }
+    }
+  }
+}
+
 Bool_t RooNCSpline_1D_fast::testRangeValidity(const T& val, const Int_t /*whichDirection*/) const{
   const T* range[2];
   range[0] = &rangeXmin;
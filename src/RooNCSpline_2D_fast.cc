@@ -353,6 +353,54 @@ Double_t RooNCSpline_2D_fast::analyticalIntegral(Int_t code, const char* rangeNa
   return value;
 }
 
+RooArgList RooNCSpline_2D_fast::getCoordinates()const{ return RooArgList(theXVar.arg(), theYVar.arg()); }
+
+void RooNCSpline_2D_fast::evaluateBatch(unsigned int n, const std::vector<const Double_t*>& coords, Double_t* out)const{
+  const unsigned int nxbins = coefficients.size();
+  const unsigned int ncx = coefficients.at(0).size();
+  const unsigned int nybins = coefficients.at(0).at(0).size();
+  const unsigned int ncy = coefficients.at(0).at(0).at(0).size();
+  const unsigned int ncell = ncx*ncy;
+  if (flatCoefficients.empty()){
+    flatCoefficients.reserve(nxbins*nybins*ncell);
+    for (unsigned int ix=0; ix<nxbins; ix++){
+      for (unsigned int iy=0; iy<nybins; iy++){
+        for (unsigned int icx=0; icx<ncx; icx++){
+          const vector<RooNCSplineCore::T>& cy = coefficients.at(ix).at(icx).at(iy);
+          flatCoefficients.insert(flatCoefficients.end(), cy.begin(), cy.end());
+        }
+      }
+    }
+  }
+
+  const Double_t* x = coords.at(0);
+  const Double_t* y = coords.at(1);
+  vector<Int_t> xbin, ybin; vector<RooNCSplineCore::T> tx, ty; vector<char> inRange(n, 1);
+  getBinsAndTVars(n, x, XList, kappaX, 0, xbin, tx, inRange);
+  getBinsAndTVars(n, y, YList, kappaY, 1, ybin, ty, inRange);
+
+  const RooNCSplineCore::T* coefs = &flatCoefficients[0];
+  for (unsigned int i=0; i<n; i++){
+    const RooNCSplineCore::T* c = coefs + (xbin[i]*nybins + ybin[i])*ncell;
+    Double_t value = 0;
+    for (unsigned int icx=ncx; icx-->0;){
+      const RooNCSplineCore::T* cy = c + icx*ncy;
+      Double_t xcoef = 0;
+      for (unsigned int icy=ncy; icy-->0;) xcoef = xcoef*ty[i] + cy[icy];
+      value = value*tx[i] + xcoef;
+    }
+    out[i] = (inRange[i] ? value : 0.);
+  }
+  if (useFloor){
+    for (unsigned int i=0; i<n; i++){
+      if (out[i]<floorEval){
+        if (verbosity>=RooNCSplineCore::kError) coutE(Eval) << "RooNCSpline_2D_fast ERROR::RooNCSpline_2D_fast(" << GetName() << ") evaluation returned " << out[i] << " at (x, y) = (" << x[i] << ", " << y[i] << ")" << endl;
+        out[i] = floorEval;
+      }
+    }
+  }
+}
+
 Bool_t RooNCSpline_2D_fast::testRangeValidity(const T& val, const Int_t whichDirection) const{
   const T* range[2];
   if (whichDirection==0){
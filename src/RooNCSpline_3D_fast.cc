@@ -497,6 +497,66 @@ Double_t RooNCSpline_3D_fast::analyticalIntegral(Int_t code, const char* rangeNa
   return value;
 }
 
+RooArgList RooNCSpline_3D_fast::getCoordinates()const{ return RooArgList(theXVar.arg(), theYVar.arg(), theZVar.arg()); }
+
+void RooNCSpline_3D_fast::evaluateBatch(unsigned int n, const std::vector<const Double_t*>& coords, Double_t* out)const{
+  const unsigned int nxbins = coefficients.size();
+  const unsigned int ncx = coefficients.at(0).size();
+  const unsigned int nybins = coefficients.at(0).at(0).size();
+  const unsigned int ncy = coefficients.at(0).at(0).at(0).size();
+  const unsigned int nzbins = coefficients.at(0).at(0).at(0).at(0).size();
+  const unsigned int ncz = coefficients.at(0).at(0).at(0).at(0).at(0).size();
+  const unsigned int ncell = ncx*ncy*ncz;
+  if (flatCoefficients.empty()){
+    flatCoefficients.reserve(nxbins*nybins*nzbins*ncell);
+    for (unsigned int ix=0; ix<nxbins; ix++){
+      for (unsigned int iy=0; iy<nybins; iy++){
+        for (unsigned int iz=0; iz<nzbins; iz++){
+          for (unsigned int icx=0; icx<ncx; icx++){
+            for (unsigned int icy=0; icy<ncy; icy++){
+              const vector<RooNCSplineCore::T>& cz = coefficients.at(ix).at(icx).at(iy).at(icy).at(iz);
+              flatCoefficients.insert(flatCoefficients.end(), cz.begin(), cz.end());
+            }
+          }
+        }
+      }
+    }
+  }
+
+  const Double_t* x = coords.at(0);
+  const Double_t* y = coords.at(1);
+  const Double_t* z = coords.at(2);
+  vector<Int_t> xbin, ybin, zbin; vector<RooNCSplineCore::T> tx, ty, tz; vector<char> inRange(n, 1);
+  getBinsAndTVars(n, x, XList, kappaX, 0, xbin, tx, inRange);
+  getBinsAndTVars(n, y, YList, kappaY, 1, ybin, ty, inRange);
+  getBinsAndTVars(n, z, ZList, kappaZ, 2, zbin, tz, inRange);
+
+  const RooNCSplineCore::T* coefs = &flatCoefficients[0];
+  for (unsigned int i=0; i<n; i++){
+    const RooNCSplineCore::T* c = coefs + ((xbin[i]*nybins + ybin[i])*nzbins + zbin[i])*ncell;
+    Double_t value = 0;
+    for (unsigned int icx=ncx; icx-->0;){
+      Double_t xcoef = 0;
+      for (unsigned int icy=ncy; icy-->0;){
+        const RooNCSplineCore::T* cz = c + (icx*ncy + icy)*ncz;
+        Double_t ycoef = 0;
+        for (unsigned int icz=ncz; icz-->0;) ycoef = ycoef*tz[i] + cz[icz];
+        xcoef = xcoef*ty[i] + ycoef;
+      }
+      value = value*tx[i] + xcoef;
+    }
+    out[i] = (inRange[i] ? value : 0.);
+  }
+  if (useFloor){
+    for (unsigned int i=0; i<n; i++){
+      if (out[i]<floorEval){
+        if (verbosity>=RooNCSplineCore::kError) coutE(Eval) << "RooNCSpline_3D_fast ERROR::RooNCSpline_3D_fast(" << GetName() << ") evaluation returned " << out[i] << " at (x, y, z) = (" << x[i] << ", " << y[i] << ", " << z[i] << ")" << endl;
+        out[i] = floorEval;
+      }
+    }
+  }
+}
+
 Bool_t RooNCSpline_3D_fast::testRangeValidity(const T& val, const Int_t whichDirection) const{
   const T* range[2];
   if (whichDirection==0){
@@ -1,8 +1,11 @@
 #include "HiggsAnalysis/CombinedLimit/interface/RooSplineND.h"
+#include "vectorized.h"
+#include <algorithm>
 
 RooSplineND::RooSplineND(const char *name, const char *title, RooArgList &vars, TTree *tree, const char *fName, double eps, bool rescale, std::string cutstring) :
   RooAbsReal(name,title),
-  vars_("vars","Variables", this)
+  vars_("vars","Variables", this),
+  cutoff_(0.), init_(false)
 {
   rescaleAxis = rescale;
   ndim_ = vars.getSize();
@@ -16,7 +19,7 @@ RooSplineND::RooSplineND(const char *name, const char *title, RooArgList &vars,
   std::cout << "RooSplineND -- Num Dimensions == " << ndim_ <<std::endl;
   std::cout << "RooSplineND -- Num Samples    == " << M_ << std::endl;
 
-  float *b_map = new float(ndim_);
+  float *b_map = new float[ndim_];
 
   RooAbsReal *rIt;	
   TIterator *iter = vars.createIterator(); int it_c=0;
@@ -57,7 +60,7 @@ RooSplineND::RooSplineND(const char *name, const char *title, RooArgList &vars,
   axis_pts_ = TMath::Power(M_,1./ndim_);
   eps_= eps;
   calculateWeights(F_vec); 
-  delete b_map;	
+  delete [] b_map;	
 }
 
 //_____________________________________________________________________________
@@ -85,6 +88,8 @@ RooSplineND::RooSplineND(const RooSplineND& other, const char *name) :
   r_map = other.r_map;
   
   rescaleAxis=other.rescaleAxis;
+  cutoff_ = other.cutoff_;
+  init_ = false;
 }
 //_____________________________________________________________________________
 // Clone Constructor
@@ -112,13 +117,17 @@ RooSplineND::RooSplineND(const char *name, const char *title, const RooListProxy
   w_mean = wrms;
   
   rescaleAxis = rescale;
+  cutoff_ = 0.;
+  init_ = false;
 }
 
 //_____________________________________________________________________________
 TObject *RooSplineND::clone(const char *newname) const 
 {
-    return new RooSplineND(newname, this->GetTitle(), 
+    RooSplineND *ret = new RooSplineND(newname, this->GetTitle(), 
 	vars_,ndim_,M_,eps_,rescaleAxis,w_,v_map,r_map,w_mean,w_rms);
+    ret->setCutoff(cutoff_);
+    return ret;
 }
 //_____________________________________________________________________________
 RooSplineND::~RooSplineND() 
@@ -155,15 +164,17 @@ void RooSplineND::calculateWeights(std::vector<double> &f){
   }
   // Solve system of Linear equations for weights vector 
   TMatrixTSym<double> fMatrix(M_);
-  // Fill the Matrix
+  // Fill the Matrix one row at a time from the flat copy of the points
+  initCache();
+  double *row = fMatrix.GetMatrixArray();
   for (int i=0;i<M_;i++){
-    fMatrix(i,i)=1.;
-    for (int j=i+1;j<M_;j++){
-        double d2  = getDistSquare(i,j);
-	double rad = radialFunc(d2,eps_);
-        fMatrix(i,j) =  rad;
-	fMatrix(j,i) =  rad; // it is symmetric	
+    std::fill(work_.begin(), work_.end(), 0.);
+    for (int k=0;k<ndim_;k++){
+      const double *xk = &pts_[k*M_];
+      vectorized::sqr_diff_add(M_, xk[i], xk, &work_[0]);
     }
+    vectorized::gaussian_kernel(M_, 1./(eps_*eps_), &work_[0], &row[i*M_]);
+    row[i*M_+i] = 1.;
   }
 
   TVectorD weights(M_);
@@ -176,7 +187,7 @@ void RooSplineND::calculateWeights(std::vector<double> &f){
   decomp.Solve(weights); // Solution now in weights
   std::cout << "RooSplineND -- ........ Done" << std::endl;
 
-  w_mean = 0.;
+  w_mean = 0.; w_rms = 0.;
   for (int i=0;i<M_;i++){
     double tw = weights[i];
     w_.push_back(tw);
@@ -224,16 +235,85 @@ double RooSplineND::radialFunc(double d2, double eps) const{
   return retval;
 }
 //_____________________________________________________________________________
+void RooSplineND::initCache() const {
+  // Flat copy of the sample points with the axis rescaling folded in,
+  // so that all distances can be computed as plain sums of squares
+  scale_.resize(ndim_);
+  pts_.resize(ndim_*M_);
+  for (int k=0;k<ndim_;k++){
+    const std::pair<double,double> &r = r_map.find(k)->second;
+    scale_[k] = rescaleAxis ? axis_pts_/(r.second-r.first) : 1.;
+    const std::vector<double> &vk = v_map.find(k)->second;
+    for (int i=0;i<M_;i++) pts_[k*M_+i] = scale_[k]*vk[i];
+  }
+  work_.resize(M_);
+  work2_.resize(M_);
+  x_.resize(ndim_);
+  // the kd-tree is only needed with a cutoff, and is built on the first evaluation that uses it
+  kdIdx_.clear();
+  kdDim_.clear();
+  init_ = true;
+}
+//_____________________________________________________________________________
+void RooSplineND::buildKDTree(int lo, int hi) const {
+  if (hi - lo < 2) { if (hi > lo) kdDim_[lo] = 0; return; }
+  // split along the axis with the largest spread in this range
+  int dim = 0; double spread = -1;
+  for (int k=0;k<ndim_;k++){
+    const double *xk = &pts_[k*M_];
+    double xmin = xk[kdIdx_[lo]], xmax = xmin;
+    for (int i=lo+1;i<hi;i++){
+      double x = xk[kdIdx_[i]];
+      if (x < xmin) xmin = x;
+      if (x > xmax) xmax = x;
+    }
+    if (xmax - xmin > spread) { spread = xmax - xmin; dim = k; }
+  }
+  int mid = (lo + hi)/2;
+  const double *xd = &pts_[dim*M_];
+  std::nth_element(kdIdx_.begin()+lo, kdIdx_.begin()+mid, kdIdx_.begin()+hi,
+                   [xd](int a, int b) { return xd[a] < xd[b]; });
+  kdDim_[mid] = dim;
+  buildKDTree(lo, mid);
+  buildKDTree(mid+1, hi);
+}
+//_____________________________________________________________________________
+double RooSplineND::sumKDTree(int lo, int hi, const double *x, double r2) const {
+  if (lo >= hi) return 0.;
+  int mid = (lo + hi)/2, i = kdIdx_[mid], dim = kdDim_[mid];
+  double ret = 0., d2 = 0.;
+  for (int k=0;k<ndim_;k++){
+    double dk = pts_[k*M_+i] - x[k];
+    d2 += dk*dk;
+  }
+  if (d2 < r2) ret += w_[i]*radialFunc(d2,eps_);
+  double delta = x[dim] - pts_[dim*M_+i];
+  if (delta <= 0 || delta*delta < r2) ret += sumKDTree(lo, mid, x, r2);
+  if (delta >= 0 || delta*delta < r2) ret += sumKDTree(mid+1, hi, x, r2);
+  return ret;
+}
+//_____________________________________________________________________________
 Double_t RooSplineND::evaluate() const {
- double ret = 0;
- for (int i=0;i<M_;i++){
- //  std::cout << "EVAL == "<< i << " " << w_[i] << " " << getDistFromSquare(i) << std::endl;
-   double w = w_[i];
-   if (w==0) continue;
-   ret+=((w/w_mean)*radialFunc(getDistFromSquare(i),eps_));
+ if (M_==0) return 0.;
+ if (!init_) initCache();
+ // n.b. the w_mean normalization used in the weights cancels out in the sum
+ if (cutoff_ > 0) {
+   if (kdIdx_.empty()) {
+     kdIdx_.resize(M_);
+     kdDim_.resize(M_);
+     for (int i=0;i<M_;i++) kdIdx_[i] = i;
+     buildKDTree(0, M_);
+   }
+   for (int k=0;k<ndim_;k++) x_[k] = scale_[k]*((RooAbsReal*)vars_.at(k))->getVal();
+   return sumKDTree(0, M_, &x_[0], cutoff_*cutoff_*eps_*eps_);
+ }
+ std::fill(work_.begin(), work_.end(), 0.);
+ for (int k=0;k<ndim_;k++){
+   double xk = scale_[k]*((RooAbsReal*)vars_.at(k))->getVal();
+   vectorized::sqr_diff_add(M_, xk, &pts_[k*M_], &work_[0]);
  }
- ret*=w_mean;
- return ret;
+ vectorized::gaussian_kernel(M_, 1./(eps_*eps_), &work_[0], &work2_[0]);
+ return vectorized::dot_product(M_, &w_[0], &work2_[0]);
 }
 //_____________________________________________________________________________
 
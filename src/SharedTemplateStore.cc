@@ -0,0 +1,168 @@
+#include "HiggsAnalysis/CombinedLimit/interface/SharedTemplateStore.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistFunc.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <TIterator.h>
+#include <RooArgSet.h>
+#include <RooWorkspace.h>
+
+namespace {
+    const unsigned long long kMagic = 0x434d53534854504cULL; // "CMSSHTPL"
+    struct Header {
+        unsigned long long magic;
+        unsigned long long layoutHash;
+        unsigned long long narrays;
+        unsigned long long ndoubles;
+        unsigned long long ready;
+    };
+    const std::size_t kDataStart = 64; // keep the data aligned to a cache line
+    
+    unsigned long long fnv1a(unsigned long long hash, const void *data, std::size_t size) {
+        const unsigned char *ptr = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < size; ++i) { hash ^= ptr[i]; hash *= 1099511628211ULL; }
+        return hash;
+    }
+
+    // the stores must live as long as the functions that point to them, i.e. until the end of the job
+    std::vector<SharedTemplateStore *> g_stores;
+}
+
+SharedTemplateStore::SharedTemplateStore(const std::string &key) :
+    length_(0), addr_(0), data_(0)
+{
+    char buff[64];
+    snprintf(buff, 63, "/combine_tpl_%016llx", fnv1a(14695981039346656037ULL, key.data(), key.size()));
+    name_ = buff;
+}
+
+SharedTemplateStore::~SharedTemplateStore() 
+{
+    if (addr_) munmap(addr_, length_);
+}
+
+void SharedTemplateStore::add(const double *data, unsigned int size) 
+{
+    inputs_.push_back(data);
+    sizes_.push_back(size);
+}
+
+unsigned long long SharedTemplateStore::layoutHash() const 
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    return fnv1a(hash, sizes_.data(), sizes_.size()*sizeof(unsigned int));
+}
+
+bool SharedTemplateStore::open() 
+{
+    offsets_.resize(sizes_.size());
+    std::size_t ndoubles = 0;
+    for (unsigned int i = 0, n = sizes_.size(); i < n; ++i) {
+        offsets_[i] = ndoubles;
+        ndoubles += sizes_[i];
+    }
+    length_ = kDataStart + ndoubles * sizeof(double);
+
+    // serialize creation among the processes on the node
+    std::string lockName = name_ + "_lock";
+    int lfd = shm_open(lockName.c_str(), O_CREAT | O_RDWR, 0666);
+    if (lfd == -1) { perror("SharedTemplateStore: cannot open lock"); return false; }
+    while (flock(lfd, LOCK_EX) == -1 && errno == EINTR) {}
+    bool ok = attach() || create();
+    flock(lfd, LOCK_UN);
+    close(lfd);
+    if (ok) data_ = reinterpret_cast<const double *>(static_cast<const char *>(addr_) + kDataStart);
+    return ok;
+}
+
+bool SharedTemplateStore::attach() 
+{
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd == -1) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || std::size_t(st.st_size) != length_) {
+        std::cerr << "SharedTemplateStore: segment /dev/shm" << name_ << " exists but has a different size, will not use it." << std::endl;
+        close(fd);
+        return false;
+    }
+    void *addr = mmap(0, length_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return false;
+    const Header *hdr = static_cast<const Header *>(addr);
+    if (hdr->magic != kMagic || hdr->layoutHash != layoutHash() || hdr->narrays != sizes_.size() || !hdr->ready) {
+        std::cerr << "SharedTemplateStore: segment /dev/shm" << name_ << " is incomplete or does not match this workspace, will not use it." << std::endl;
+        munmap(addr, length_);
+        return false;
+    }
+    addr_ = addr;
+    return true;
+}
+
+bool SharedTemplateStore::create() 
+{
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1) return false; // exists, but we could not attach to it
+    if (ftruncate(fd, length_) != 0) { 
+        perror("SharedTemplateStore: cannot allocate the segment");
+        close(fd); shm_unlink(name_.c_str()); 
+        return false; 
+    }
+    void *addr = mmap(0, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) { shm_unlink(name_.c_str()); return false; }
+    Header *hdr = static_cast<Header *>(addr);
+    double *data = reinterpret_cast<double *>(static_cast<char *>(addr) + kDataStart);
+    for (unsigned int i = 0, n = sizes_.size(); i < n; ++i) {
+        if (sizes_[i]) std::memcpy(data + offsets_[i], inputs_[i], sizes_[i]*sizeof(double));
+    }
+    hdr->magic = kMagic;
+    hdr->layoutHash = layoutHash();
+    hdr->narrays = sizes_.size();
+    hdr->ndoubles = (length_ - kDataStart)/sizeof(double);
+    hdr->ready = 1;
+    mprotect(addr, length_, PROT_READ);
+    addr_ = addr;
+    return true;
+}
+
+unsigned int SharedTemplateStore::shareCMSHistFuncs(RooWorkspace &w, const std::string &key, int verbose) 
+{
+    std::unique_ptr<SharedTemplateStore> store(new SharedTemplateStore(key));
+    std::vector<CMSHistFunc *> funcs;
+    std::vector<unsigned int> first;
+    RooArgSet comps(w.components());
+    std::unique_ptr<TIterator> iter(comps.createIterator());
+    for (RooAbsArg *a = (RooAbsArg *) iter->Next(); a != 0; a = (RooAbsArg *) iter->Next()) {
+        CMSHistFunc *hf = dynamic_cast<CMSHistFunc *>(a);
+        if (hf == 0 || hf->hasSharedStorage()) continue;
+        funcs.push_back(hf);
+        first.push_back(store->sizes_.size());
+        for (FastTemplate const& t : hf->storage()) store->add(t.fullsize() ? &t[0] : 0, t.fullsize());
+    }
+    if (funcs.empty()) return 0;
+    if (!store->open()) {
+        std::cerr << "SharedTemplateStore: could not use shared memory, the templates will be kept in each process." << std::endl;
+        return 0;
+    }
+    for (unsigned int i = 0, n = funcs.size(); i < n; ++i) {
+        unsigned int ntpl = funcs[i]->storage().size();
+        std::vector<const double *> ptrs(ntpl);
+        for (unsigned int j = 0; j < ntpl; ++j) ptrs[j] = store->get(first[i] + j);
+        funcs[i]->useSharedStorage(ptrs);
+    }
+    if (verbose > 0) {
+        std::cout << "Templates of " << funcs.size() << " CMSHistFuncs (" << (store->bytes() >> 20) << " MB) are in shared memory segment /dev/shm" << store->name() << std::endl;
+    }
+    store->inputs_.clear();
+    g_stores.push_back(store.release());
+    return funcs.size();
+}
@@ -1,5 +1,8 @@
 #include "HiggsAnalysis/CombinedLimit/interface/SimplerLikelihoodRatioTestStatExt.h"
 #include "HiggsAnalysis/CombinedLimit/interface/utils.h"
+#include "HiggsAnalysis/CombinedLimit/interface/ProfilingTools.h"
+#include <RooAbsCategory.h>
+#include <cmath>
 
 SimplerLikelihoodRatioTestStatOpt::SimplerLikelihoodRatioTestStatOpt(
         const RooArgSet &obs, 
@@ -51,31 +54,49 @@ SimplerLikelihoodRatioTestStatOpt::~SimplerLikelihoodRatioTestStatOpt()
 Double_t
 SimplerLikelihoodRatioTestStatOpt::Evaluate(RooAbsData& data, RooArgSet& nullPOI) 
 {
+    static bool noCache = runtimedef::get("SLRTSO_NO_CACHE");
+
     // get parameters, if not there already
     if (paramsNull_.get() == 0) paramsNull_.reset(pdfNull_->getParameters(data));
     if (paramsAlt_.get() == 0)  paramsAlt_.reset(pdfAlt_->getParameters(data));
 
-    // if the dataset is not empty, redirect pdf nodes to the dataset
+    // if the entries and the parameters are the same as last time, the NLLs can be computed
+    // from the cached terms without evaluating the pdfs (NaN if some term is missing)
+    bool sameData = !noCache && sameEntries(data);
+
+    // pdf nodes are redirected to the dataset only if the pdfs have to be evaluated
     std::auto_ptr<TIterator> iterDepObs(pdfDepObs_.createIterator());
-    bool nonEmpty = data.numEntries() > 0;
-    if (nonEmpty) {
+    bool redirected = false;
+    auto redirect = [&]() {
+        if (redirected || data.numEntries() == 0) return;
         const RooArgSet *entry = data.get(0);
         for (RooAbsArg *a = (RooAbsArg *) iterDepObs->Next(); a != 0; a = (RooAbsArg *) iterDepObs->Next()) {
             a->redirectServers(*entry);    
         }
-    }
+        redirected = true;
+    };
 
     // evaluate null pdf
     *paramsNull_ = snapNull_;
     *paramsNull_ = nullPOI;
-    double nullNLL = simPdfNull_ ? evalSimNLL(data, simPdfNull_, simPdfComponentsNull_) : evalSimpleNLL(data, pdfNull_);
+    bool sameNull = sameParams(*paramsNull_, cacheNull_.params);
+    double nullNLL = (sameData && sameNull) ? evalCachedNLL(data, cacheNull_) : NAN;
+    if (std::isnan(nullNLL)) {
+        redirect();
+        nullNLL = simPdfNull_ ? evalSimNLL(data, simPdfNull_, simPdfComponentsNull_, cacheNull_) : evalSimpleNLL(data, pdfNull_, cacheNull_);
+    }
 
     // evaluate alt pdf
     *paramsAlt_ = snapAlt_;
-    double altNLL = simPdfAlt_ ? evalSimNLL(data, simPdfAlt_, simPdfComponentsAlt_) : evalSimpleNLL(data, pdfAlt_);
+    bool sameAlt = sameParams(*paramsAlt_, cacheAlt_.params);
+    double altNLL = (sameData && sameAlt) ? evalCachedNLL(data, cacheAlt_) : NAN;
+    if (std::isnan(altNLL)) {
+        redirect();
+        altNLL = simPdfAlt_ ? evalSimNLL(data, simPdfAlt_, simPdfComponentsAlt_, cacheAlt_) : evalSimpleNLL(data, pdfAlt_, cacheAlt_);
+    }
 
     // put back links in pdf nodes, otherwise if the dataset goes out of scope they have dangling pointers
-    if (nonEmpty) {
+    if (redirected) {
         iterDepObs->Reset();
         for (RooAbsArg *a = (RooAbsArg *) iterDepObs->Next(); a != 0; a = (RooAbsArg *) iterDepObs->Next()) {
             a->redirectServers(*obs_);    
@@ -103,7 +124,7 @@ void SimplerLikelihoodRatioTestStatOpt::unrollSimPdf(RooSimultaneous *simpdf, st
     }
 }
 
-double SimplerLikelihoodRatioTestStatOpt::evalSimNLL(RooAbsData &data,  RooSimultaneous *pdf, std::vector<RooAbsPdf *> &components) {
+double SimplerLikelihoodRatioTestStatOpt::evalSimNLL(RooAbsData &data,  RooSimultaneous *pdf, std::vector<RooAbsPdf *> &components, CachedNLL &cache) {
     data.setDirtyProp(false);
 
     double sum = 0.0;
@@ -118,6 +139,7 @@ double SimplerLikelihoodRatioTestStatOpt::evalSimNLL(RooAbsData &data,  RooSimul
     }
 
     // now loop on the dataset, and dispatch the request to the appropriate pdf
+    cache.reset(n, components.size());
     std::vector<double> sumw(components.size(), 0);
     for (i = 0; i < n; ++i) {
         data.get(i); 
@@ -125,31 +147,128 @@ double SimplerLikelihoodRatioTestStatOpt::evalSimNLL(RooAbsData &data,  RooSimul
         int bin = cat->getBin();
         assert(bin < int(components.size()) && "Bin outside range");
         if (components[bin] == 0) continue;
-        sum  += -w*components[bin]->getLogVal(obs_);
+        double logVal = components[bin]->getLogVal(obs_);
+        sum  += -w*logVal;
         sumw[bin] +=  w;
+        cache.logVals[i] = logVal; cache.bins[i] = bin;
     }
 
     // then compute extended term
     for (i = 0, n = components.size(); i < n; ++i) {
-        if (components[i]) sum += components[i]->extendedTerm(UInt_t(sumw[i]), obs_);
+        if (components[i]) sum += cacheExtendedTerm(*components[i], UInt_t(sumw[i]), cache, i);
     }
     return sum;
 }
 
-double SimplerLikelihoodRatioTestStatOpt::evalSimpleNLL(RooAbsData &data,  RooAbsPdf *pdf) {
+double SimplerLikelihoodRatioTestStatOpt::evalSimpleNLL(RooAbsData &data,  RooAbsPdf *pdf, CachedNLL &cache) {
     data.setDirtyProp(false);
     double sum = 0.0, sumw = 0.0;
     int i, n = data.numEntries(); 
+    cache.reset(n, 1);
     for (i = 0; i < n; ++i) {
         data.get(i); 
         double w = data.weight(); if (w == 0) continue;
-        sum  += -w*pdf->getLogVal(obs_);
+        double logVal = pdf->getLogVal(obs_);
+        sum  += -w*logVal;
         sumw +=  w;
+        cache.logVals[i] = logVal; cache.bins[i] = 0;
+    }
+    sum += cacheExtendedTerm(*pdf, UInt_t(sumw), cache, 0);
+    return sum;
+}
+
+double SimplerLikelihoodRatioTestStatOpt::evalCachedNLL(RooAbsData &data, const CachedNLL &cache) {
+    if (cache.expected.empty() || int(cache.bins.size()) != data.numEntries()) return NAN; // never filled
+    double sum = 0.0;
+    std::vector<double> sumw(cache.expected.size(), 0);
+    for (int i = 0, n = data.numEntries(); i < n; ++i) {
+        data.get(i);
+        double w = data.weight(); if (w == 0) continue;
+        int bin = cache.bins[i];
+        if (bin == -1) return NAN;
+        sum  += -w*cache.logVals[i];
+        sumw[bin] += w;
+    }
+    for (int i = 0, n = cache.expected.size(); i < n; ++i) {
+        UInt_t observed = UInt_t(sumw[i]);
+        if (!std::isnan(cache.expected[i])) {
+            sum += extendedTerm(cache.expected[i], observed);
+        } else if (cache.fixedObserved[i] != -1) {
+            // term returned by a pdf that can't be extended, only known for the same number of events
+            if (int(observed) != cache.fixedObserved[i]) return NAN;
+            sum += cache.fixedTerm[i];
+        }
     }
-    sum += pdf->extendedTerm(UInt_t(sumw), obs_);
     return sum;
 }
 
+double SimplerLikelihoodRatioTestStatOpt::cacheExtendedTerm(RooAbsPdf &pdf, UInt_t observed, CachedNLL &cache, unsigned int channel) {
+    double term = pdf.extendedTerm(observed, obs_);
+    if (pdf.canBeExtended()) {
+        cache.expected[channel] = pdf.expectedEvents(obs_);
+    } else {
+        cache.fixedTerm[channel] = term;
+        cache.fixedObserved[channel] = observed;
+    }
+    return term;
+}
+
+void SimplerLikelihoodRatioTestStatOpt::CachedNLL::reset(unsigned int nentries, unsigned int nchannels) {
+    logVals.assign(nentries, 0.);
+    bins.assign(nentries, -1);
+    expected.assign(nchannels, NAN);
+    fixedTerm.assign(nchannels, 0.);
+    fixedObserved.assign(nchannels, -1);
+}
+
+bool SimplerLikelihoodRatioTestStatOpt::sameEntries(RooAbsData &data) {
+    int n = data.numEntries();
+    // the dataset returns the same set of observables for every entry, so they are resolved only once
+    std::vector<RooAbsCategory *> cats; std::vector<RooAbsReal *> reals;
+    if (n) {
+        RooFIter iter = data.get(0)->fwdIterator();
+        for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+            RooAbsCategory *cat = dynamic_cast<RooAbsCategory *>(a);
+            cats.push_back(cat);
+            reals.push_back(cat ? 0 : static_cast<RooAbsReal *>(a));
+        }
+    }
+    // compare with the values of the last dataset in place, and overwrite them from the first difference on
+    bool same = true;
+    unsigned int k = 0, nvars = cats.size();
+    for (int i = 0; i < n; ++i) {
+        data.get(i);
+        for (unsigned int j = 0; j < nvars; ++j, ++k) {
+            double val = cats[j] ? cats[j]->getIndex() : reals[j]->getVal();
+            if (same && (k >= cacheEntries_.size() || cacheEntries_[k] != val)) { same = false; cacheEntries_.resize(k); }
+            if (!same) cacheEntries_.push_back(val);
+        }
+    }
+    if (same && k != cacheEntries_.size()) { same = false; cacheEntries_.resize(k); }
+    return same;
+}
+
+bool SimplerLikelihoodRatioTestStatOpt::sameParams(const RooArgSet &params, std::vector<double> &values) {
+    std::vector<double> now;
+    now.reserve(params.getSize());
+    RooFIter iter = params.fwdIterator();
+    for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+        RooAbsCategory *cat = dynamic_cast<RooAbsCategory *>(a);
+        RooAbsReal *rar = dynamic_cast<RooAbsReal *>(a);
+        now.push_back(cat ? cat->getIndex() : (rar ? rar->getVal() : 0.));
+    }
+    if (now == values) return true;
+    values.swap(now);
+    return false;
+}
+
+double SimplerLikelihoodRatioTestStatOpt::extendedTerm(double expected, double observed) {
+    // as RooAbsPdf::extendedTerm
+    if (expected < 0) return 0;
+    if (std::abs(expected) < 1e-10 && std::abs(observed) < 1e-10) return 0;
+    return expected - observed*std::log(expected);
+}
+
 // ===== This below is identical to the RooStats::SimpleLikelihoodRatioTestStat also in implementation
 //       I've made a copy here just to be able to put some debug hooks inside.
 #if 0
@@ -221,12 +221,14 @@ toymcoptutils::SinglePdfGenInfo::generateWithHisto(RooRealVar *&weightVar, bool
     RooArgSet obsPlusW(obs); obsPlusW.add(*weightVar);
     RooDataSet *data = new RooDataSet(TString::Format("%sData", pdf_->GetName()), "", obsPlusW, weightVar->GetName());
     RooAbsArg::setDirtyInhibit(true); // don't propagate dirty flags while filling histograms 
+    binWeights_.clear();
     switch (obs.getSize()) {
         case 1:
             for (int i = 1, n = histoSpec_->GetNbinsX(); i <= n; ++i) {
                 x->setVal(histoSpec_->GetXaxis()->GetBinCenter(i));
                 double w = histoSpec_->GetXaxis()->GetBinWidth(i);
-                data->add(observables_,  weightScale*(asimov ? w*histoSpec_->GetBinContent(i) : RooRandom::randomGenerator()->Poisson(w*histoSpec_->GetBinContent(i))) );
+                binWeights_.push_back(weightScale*(asimov ? w*histoSpec_->GetBinContent(i) : RooRandom::randomGenerator()->Poisson(w*histoSpec_->GetBinContent(i))));
+                data->add(observables_, binWeights_.back());
             }
             break;
         case 2:
@@ -237,7 +239,8 @@ toymcoptutils::SinglePdfGenInfo::generateWithHisto(RooRealVar *&weightVar, bool
                 x->setVal(h2.GetXaxis()->GetBinCenter(ix));
                 y->setVal(h2.GetYaxis()->GetBinCenter(iy));
                 double w = h2.GetXaxis()->GetBinWidth(ix) * h2.GetYaxis()->GetBinWidth(iy);
-                data->add(observables_, weightScale*(asimov ? w*h2.GetBinContent(ix,iy) : RooRandom::randomGenerator()->Poisson(w*h2.GetBinContent(ix,iy))) );
+                binWeights_.push_back(weightScale*(asimov ? w*h2.GetBinContent(ix,iy) : RooRandom::randomGenerator()->Poisson(w*h2.GetBinContent(ix,iy))));
+                data->add(observables_, binWeights_.back());
             } }
             }
             break;
@@ -251,7 +254,8 @@ toymcoptutils::SinglePdfGenInfo::generateWithHisto(RooRealVar *&weightVar, bool
                 y->setVal(h3.GetYaxis()->GetBinCenter(iy));
                 z->setVal(h3.GetZaxis()->GetBinCenter(iz));
                 double w = h3.GetXaxis()->GetBinWidth(ix) * h3.GetYaxis()->GetBinWidth(iy) * h3.GetZaxis()->GetBinWidth(iz);
-                data->add(observables_, weightScale*(asimov ? w*h3.GetBinContent(ix,iy,iz) : RooRandom::randomGenerator()->Poisson(w*h3.GetBinContent(ix,iy,iz))) );
+                binWeights_.push_back(weightScale*(asimov ? w*h3.GetBinContent(ix,iy,iz) : RooRandom::randomGenerator()->Poisson(w*h3.GetBinContent(ix,iy,iz))));
+                data->add(observables_, binWeights_.back());
             } } }
             }
     }
@@ -330,11 +334,13 @@ toymcoptutils::SimPdfGenInfo::SimPdfGenInfo(RooAbsPdf &pdf, const RooArgSet& obs
         cat_ = const_cast<RooAbsCategoryLValue *>(&simPdf->indexCat());
         int nbins = cat_->numBins((const char *)0);
         pdfs_.resize(nbins, 0);
+        binned_.resize(nbins);
         RooArgList dummy;
         for (int ic = 0; ic < nbins; ++ic) {
             cat_->setBin(ic);
             RooAbsPdf *pdfi = simPdf->getPdf(cat_->getLabel());
             if (pdfi == 0) throw std::logic_error(std::string("Unmapped category state: ") + cat_->getLabel());
+            binned_[ic].label = cat_->getLabel();
             RooAbsPdf *newpdf = utils::factorizePdf(observables, *pdfi, dummy);
             pdfs_[ic] = new SinglePdfGenInfo(*newpdf, observables, preferBinned);
             if (newpdf != 0 && newpdf != pdfi) {
@@ -374,6 +380,15 @@ toymcoptutils::SimPdfGenInfo::generate(RooRealVar *&weightVar, const RooDataSet*
             cat_->setBin(i);
             RooAbsData *&data =  datasetPieces_[cat_->getLabel()]; delete data;
             assert(protoData == 0);
+            if (!copyData_ && pdfs_[i]->mode() == SinglePdfGenInfo::Poisson) {
+                // binned toy: made directly with the common weight variable, and the contents
+                // of the bins are also handed over as they are through binned_
+                data = pdfs_[i]->generatePoisson(weightVar);
+                binned_[i].source  = pdfs_[i];
+                binned_[i].weights = &pdfs_[i]->binWeights();
+                continue;
+            }
+            binned_[i].source = 0; binned_[i].weights = 0;
             data = pdfs_[i]->generate(protoData); // I don't really know if protoData != 0 would make sense here
             if (data->isWeighted()) {
                 if (weightVar == 0) weightVar = new RooRealVar("_weight_","",1.0);
@@ -409,7 +424,9 @@ toymcoptutils::SimPdfGenInfo::generate(RooRealVar *&weightVar, const RooDataSet*
             // not copyData is the "fast" mode used when generating toys as a ToyMCSampler.
             // this doesn't copy the data, so the toys cannot outlive this class and each new
             // toy over-writes the memory of the previous one.
-            ret = new RooDataSet(retName, "", observables_, RooFit::Index((RooCategory&)*cat_), RooFit::Link(datasetPieces_) /*, RooFit::OwnLinked()*/);
+            // the same goes for the bins in binned_, that CachingSimNLL can read directly
+            if (binned_.empty()) ret = new RooDataSet(retName, "", observables_, RooFit::Index((RooCategory&)*cat_), RooFit::Link(datasetPieces_) /*, RooFit::OwnLinked()*/);
+            else ret = new BinnedToyDataSet(retName, "", observables_, RooFit::Index((RooCategory&)*cat_), RooFit::Link(datasetPieces_), &binned_);
         }
     } else ret = pdfs_[0]->generate(protoData, forceEvents);
     //std::cout << "Dataset generated from sim pdf (weighted? " << ret->isWeighted() << ")" << std::endl; utils::printRAD(ret);
@@ -0,0 +1,61 @@
+#include "HiggsAnalysis/CombinedLimit/interface/VectorizedBernsteinFast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/RooBernsteinFast.h"
+#include "vectorized.h"
+#include <RooRealVar.h>
+#include <algorithm>
+#include <stdexcept>
+
+template<int N>
+VectorizedBernsteinFast<N>::VectorizedBernsteinFast(const RooBernsteinFast<N> &pdf, const RooAbsData &data, bool includeZeroWeights) :
+    pdf_(&pdf)
+{
+    RooArgSet obs(*data.get());
+    const RooRealVar *x = dynamic_cast<const RooRealVar *>(obs.find(pdf.xvar().GetName()));
+    if (x == 0) {
+        throw std::invalid_argument(std::string("The x of ") + pdf.GetName() + " is not an observable: if this is intended, set --X-rtd ADDNLL_BERNSTEINNLL=0 to disable its vectorization in NLL.");
+    }
+
+    std::vector<Double_t> xvals;
+    xvals.reserve(data.numEntries());
+    for (unsigned int i = 0, n = data.numEntries(); i < n; ++i) {
+        data.get(i);
+        if (data.weight() || includeZeroWeights) xvals.push_back(x->getVal());
+    }
+    nentries_ = xvals.size();
+
+    // same rescaling to [0,1] as in RooBernsteinFast::evaluate
+    double xmin = x->getMin();
+    xrange_ = x->getMax() - xmin;
+    for (Double_t &xv : xvals) xv = (xv - xmin) / xrange_;
+    basis_.resize(N * nentries_);
+    if (nentries_ == 0) return;
+    std::copy(xvals.begin(), xvals.end(), basis_.begin());
+    for (int ipow = 2; ipow <= N; ++ipow) {
+        const Double_t *prev = &basis_[(ipow-2) * nentries_];
+        Double_t *here = &basis_[(ipow-1) * nentries_];
+        for (unsigned int k = 0; k < nentries_; ++k) here[k] = prev[k] * xvals[k];
+    }
+}
+
+template<int N>
+void VectorizedBernsteinFast<N>::fill(std::vector<Double_t> &out) const {
+    out.resize(nentries_);
+    if (nentries_ == 0) return;
+    pdf_->getPowerCoefficients(coefs_);
+    // integral over the rescaled x: sum_i c_i/(i+1), times (xmax-xmin) as in RooBernsteinFast::analyticalIntegral
+    double integral = coefs_[0];
+    for (int ipow = 1; ipow <= N; ++ipow) integral += coefs_[ipow] / (ipow + 1.0);
+    double inorm = 1.0 / (xrange_ * integral);
+    std::fill(out.begin(), out.end(), coefs_[0] * inorm);
+    for (int ipow = 1; ipow <= N; ++ipow) {
+        vectorized::mul_add(nentries_, coefs_[ipow] * inorm, &basis_[(ipow-1) * nentries_], &out[0]);
+    }
+}
+
+template class VectorizedBernsteinFast<1>;
+template class VectorizedBernsteinFast<2>;
+template class VectorizedBernsteinFast<3>;
+template class VectorizedBernsteinFast<4>;
+template class VectorizedBernsteinFast<5>;
+template class VectorizedBernsteinFast<6>;
+template class VectorizedBernsteinFast<7>;
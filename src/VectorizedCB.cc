@@ -2,8 +2,11 @@
 #include "RooMath.h"
 #include "vectorized.h"
 #include "HiggsAnalysis/CombinedLimit/interface/ProfilingTools.h"
+#include "HiggsAnalysis/CombinedLimit/interface/GBRMath.h"
+#include "TMath.h"
 #include <RooRealVar.h>
 #include <stdexcept>
+#include <algorithm>
 
 VectorizedCBShape::VectorizedCBShape(const RooCBShape &gaus, const RooAbsData &data, bool includeZeroWeights)
 {
@@ -56,15 +59,7 @@ VectorizedCBShape::VectorizedCBShape(const RooCBShape &gaus, const RooAbsData &d
         mode_ = Plain; // anything else will be broken in these circumstances
     }
     if (hasPreSort()) {
-        xindex_.resize(xvals_.size());
-        for (unsigned int i = 0, n = xvals_.size(); i < n; ++i) {
-            xindex_[i] = i;
-        }
-        std::sort(xindex_.begin(), xindex_.end(), [this](int i1, int i2) { return xvals_[i1] < xvals_[i2]; });
-        xsorted_.resize(xvals_.size());
-        for (unsigned int i = 0, n = xvals_.size(); i < n; ++i) {
-            xsorted_[i] = xvals_[xindex_[i]];
-        }
+        VectorizedSortedX::sort(xvals_, xindex_, xsorted_);
     }
 }
 
@@ -104,7 +99,7 @@ void VectorizedCBShape::fill(std::vector<Double_t> &out) const {
         }
         std::fill(&out[iend], &*out.end(), 0.);
         if (hasPreSort()) { // put back in place
-            for (unsigned int i = 0; i < n; ++i) work2_[xindex_[i]] = out[i];
+            VectorizedSortedX::unsort(xindex_, out, work2_);
             std::swap(out, work2_);
         }
     } else {
@@ -249,3 +244,228 @@ void VectorizedCBShape::cbCB(double* __restrict__ t, unsigned int n, double norm
         out[i] = prefactor*work2[i];
     }
 }
+
+void VectorizedSortedX::init(const RooRealVar &x, const RooAbsData &data, bool includeZeroWeights) {
+    xvals_.clear(); xindex_.clear(); xsorted_.clear();
+    xvals_.reserve(data.numEntries());
+    for (unsigned int i = 0, n = data.numEntries(); i < n; ++i) {
+        data.get(i);
+        if (data.weight() || includeZeroWeights) xvals_.push_back(x.getVal());
+    }
+    if (!std::is_sorted(xvals_.begin(), xvals_.end())) sort(xvals_, xindex_, xsorted_);
+}
+
+void VectorizedSortedX::unsort(const std::vector<Double_t> &sortedvals, std::vector<Double_t> &out) const {
+    if (xindex_.empty()) {
+        out.resize(sortedvals.size());
+        std::copy(sortedvals.begin(), sortedvals.end(), out.begin());
+    } else {
+        unsort(xindex_, sortedvals, out);
+    }
+}
+
+void VectorizedSortedX::sort(const std::vector<Double_t> &vals, std::vector<int> &index, std::vector<Double_t> &sorted) {
+    index.resize(vals.size());
+    for (unsigned int i = 0, n = vals.size(); i < n; ++i) {
+        index[i] = i;
+    }
+    std::sort(index.begin(), index.end(), [&vals](int i1, int i2) { return vals[i1] < vals[i2]; });
+    sorted.resize(vals.size());
+    for (unsigned int i = 0, n = vals.size(); i < n; ++i) {
+        sorted[i] = vals[index[i]];
+    }
+}
+
+void VectorizedSortedX::unsort(const std::vector<int> &index, const std::vector<Double_t> &sortedvals, std::vector<Double_t> &out) {
+    out.resize(sortedvals.size());
+    for (unsigned int i = 0, n = sortedvals.size(); i < n; ++i) out[index[i]] = sortedvals[i];
+}
+
+VectorizedDoubleCBFast::VectorizedDoubleCBFast(const RooDoubleCBFast &pdf, const RooAbsData &data, bool includeZeroWeights) :
+    pdf_(&pdf)
+{
+    RooArgSet obs(*data.get());
+    Worker w(pdf);
+    const RooRealVar *x = dynamic_cast<const RooRealVar*>(obs.find(w.xvar().GetName()));
+    if (x == 0) {
+        throw std::invalid_argument("RooDoubleCBFast observable is not x: if this is intended, set --X-rtd ADDNLL_CBNLL=0 to disable its vectorization in NLL.");
+    }
+    params_[0] = & w.meanvar();
+    params_[1] = & w.widthvar();
+    params_[2] = & w.alpha1var();
+    params_[3] = & w.n1var();
+    params_[4] = & w.alpha2var();
+    params_[5] = & w.n2var();
+    std::fill(lastParams_, lastParams_+6, std::nan(""));
+    lastIntegral_ = 0;
+
+    x_.init(*x, data, includeZeroWeights);
+    work1_.resize(x_.size());
+    work2_.resize(x_.size());
+    work3_.resize(x_.size());
+}
+
+double VectorizedDoubleCBFast::getIntegral() const {
+    bool changed = false;
+    for (int i = 0; i < 6; ++i) {
+        double val = params_[i]->getVal();
+        if (val != lastParams_[i]) { lastParams_[i] = val; changed = true; }
+    }
+    if (changed) lastIntegral_ = pdf_->analyticalIntegral(1);
+    return lastIntegral_;
+}
+
+void VectorizedDoubleCBFast::fill(std::vector<Double_t> &out) const {
+    double norm = 1.0/getIntegral();
+    double mean = lastParams_[0], width = lastParams_[1], invw = vdt::fast_inv(width);
+    double alpha1 = lastParams_[2], n1 = lastParams_[3], alpha2 = lastParams_[4], n2 = lastParams_[5];
+
+    unsigned int n = x_.size();
+    out.resize(n);
+    if (n == 0) return;
+
+    if (width > 0) {
+        // left tail for t <= -alpha1, i.e. x <= mean - alpha1*width; right tail for t >= alpha2
+        const std::vector<Double_t> & x = x_.sorted();
+        std::vector<Double_t> & vals = (x_.isSorted() ? out : work3_);
+        auto cut1 = std::upper_bound(x.begin(), x.end(), mean - alpha1 * width);
+        auto cut2 = std::lower_bound(cut1,      x.end(), mean + alpha2 * width);
+        unsigned int ibegin = cut1 - x.begin();
+        unsigned int iend   = cut2 - x.begin();
+        for (unsigned int i = 0; i < n; ++i) {
+            work1_[i] = (x[i]-mean)*invw;
+        }
+        if (ibegin > 0) {
+            tail(&work1_[0], ibegin, alpha1, n1, +1, norm, &vals[0], &work2_[0]);
+        }
+        if (iend > ibegin) {
+            for (unsigned int i = ibegin; i < iend; ++i) {
+                work2_[i] = -0.5*work1_[i]*work1_[i];
+            }
+            vdt::fast_expv(iend-ibegin, &work2_[ibegin], &vals[ibegin]);
+            for (unsigned int i = ibegin; i < iend; ++i) {
+                vals[i] *= norm;
+            }
+        }
+        if (n > iend) {
+            tail(&work1_[iend], n-iend, alpha2, n2, -1, norm, &vals[iend], &work2_[iend]);
+        }
+        if (&vals != &out) x_.unsort(vals, out);
+    } else {
+        // same as RooDoubleCBFast::evaluate, one entry at a time
+        const std::vector<Double_t> & x = x_.values();
+        for (unsigned int i = 0; i < n; ++i) {
+            double t = (x[i]-mean)*invw;
+            if (t > -alpha1 && t < alpha2) {
+                out[i] = norm * vdt::fast_exp(-0.5*t*t);
+            } else if (t <= -alpha1) {
+                out[i] = norm * vdt::fast_exp(-0.5*alpha1*alpha1)*gbrmath::fast_pow(1. - alpha1*vdt::fast_inv(n1)*(alpha1+t), -n1);
+            } else {
+                out[i] = norm * vdt::fast_exp(-0.5*alpha2*alpha2)*gbrmath::fast_pow(1. - alpha2*vdt::fast_inv(n2)*(alpha2-t), -n2);
+            }
+        }
+    }
+}
+
+void VectorizedDoubleCBFast::tail(double* __restrict__ t, unsigned int n, double alpha, double nn, double sign, double norm, double* __restrict__ out, double* __restrict__ work2) const {
+    double alphainvn = alpha*vdt::fast_inv(nn), notn = -nn;
+    double prefactor = norm*vdt::fast_exp(-0.5*alpha*alpha);
+    for (unsigned int i = 0; i < n; ++i) {
+        work2[i] = 1 - alphainvn*(alpha+sign*t[i]);
+    }
+    vdt::fast_logv(n, work2, t);
+    for (unsigned int i = 0; i < n; ++i) {
+        t[i] *= notn;
+    }
+    vdt::fast_expv(n, t, work2);
+    for (unsigned int i = 0; i < n; ++i) {
+        out[i] = prefactor*work2[i];
+    }
+}
+
+VectorizedGaussExp::VectorizedGaussExp(const GaussExp &pdf, const RooAbsData &data, bool includeZeroWeights)
+{
+    RooArgSet obs(*data.get());
+    Worker w(pdf);
+    xvar_ = dynamic_cast<const RooRealVar*>(obs.find(w.xvar().GetName()));
+    if (xvar_ == 0) {
+        throw std::invalid_argument("GaussExp observable is not x: if this is intended, set --X-rtd ADDNLL_CBNLL=0 to disable its vectorization in NLL.");
+    }
+    params_[0] = & w.p0var();
+    params_[1] = & w.p1var();
+    params_[2] = & w.p2var();
+    std::fill(lastParams_, lastParams_+3, std::nan(""));
+    lastIntegral_ = 0;
+
+    x_.init(*xvar_, data, includeZeroWeights);
+    work1_.resize(x_.size());
+    work2_.resize(x_.size());
+    work3_.resize(x_.size());
+}
+
+double VectorizedGaussExp::getIntegral() const {
+    bool changed = false;
+    for (int i = 0; i < 3; ++i) {
+        double val = params_[i]->getVal();
+        if (val != lastParams_[i]) { lastParams_[i] = val; changed = true; }
+    }
+    if (!changed) return lastIntegral_;
+
+    static const double rootPiBy2 = std::sqrt(std::atan2(0.0,-1.0)/2.0);
+    static const double invRoot2 = 1.0/std::sqrt(2);
+
+    double mean = lastParams_[0], sigma = lastParams_[1], k = lastParams_[2];
+    double tmin = (xvar_->getMin()-mean)/sigma;
+    double tmax = (xvar_->getMax()-mean)/sigma;
+    if (tmin > tmax) std::swap(tmin, tmax); // negative sigma
+
+    // gaussian core for t < k, exp(k^2/2 - k*t) for t >= k; dx = |sigma| dt
+    double central = 0, right = 0;
+    double central_high = std::min(tmax, k);
+    if (tmin < central_high) {
+        central = rootPiBy2*(TMath::Erf(central_high*invRoot2)-TMath::Erf(tmin*invRoot2));
+    }
+    double right_low = std::max(tmin, k);
+    if (right_low < tmax) {
+        if (k != 0) right = (std::exp(0.5*k*k - k*right_low) - std::exp(0.5*k*k - k*tmax))/k;
+        else right = tmax - right_low;
+    }
+    lastIntegral_ = std::abs(sigma)*(central + right);
+    return lastIntegral_;
+}
+
+void VectorizedGaussExp::fill(std::vector<Double_t> &out) const {
+    double norm = 1.0/getIntegral();
+    double mean = lastParams_[0], sigma = lastParams_[1], k = lastParams_[2];
+    double invs = 1.0/sigma;
+
+    unsigned int n = x_.size();
+    out.resize(n);
+    if (n == 0) return;
+
+    if (sigma > 0) {
+        // core for t < k, i.e. x < mean + k*sigma
+        const std::vector<Double_t> & x = x_.sorted();
+        std::vector<Double_t> & vals = (x_.isSorted() ? out : work3_);
+        unsigned int icut = std::lower_bound(x.begin(), x.end(), mean + k * sigma) - x.begin();
+        for (unsigned int i = 0; i < icut; ++i) {
+            double t = (x[i]-mean)*invs;
+            work1_[i] = -0.5*t*t;
+        }
+        for (unsigned int i = icut; i < n; ++i) {
+            work1_[i] = 0.5*k*k - k*(x[i]-mean)*invs;
+        }
+        vdt::expv(n, &work1_[0], &work2_[0]);
+        for (unsigned int i = 0; i < n; ++i) {
+            vals[i] = norm*work2_[i];
+        }
+        if (&vals != &out) x_.unsort(vals, out);
+    } else {
+        // same as GaussExp::evaluate, one entry at a time
+        const std::vector<Double_t> & x = x_.values();
+        for (unsigned int i = 0; i < n; ++i) {
+            double t = (x[i]-mean)*invs;
+            out[i] = norm * (t < k ? std::exp(-0.5*t*t) : std::exp(0.5*k*k - k*t));
+        }
+    }
+}
@@ -124,11 +124,17 @@ cacheutils::CachingPiecewiseInterpolation::~CachingPiecewiseInterpolation()
 
 
 const std::vector<Double_t> & cacheutils::CachingPiecewiseInterpolation::eval(const RooAbsData &data)
+{
+    evalInto(data, work_);
+    return work_;
+}
+
+void cacheutils::CachingPiecewiseInterpolation::evalInto(const RooAbsData &data, std::vector<Double_t> &out)
 {
     const std::vector<Double_t> & nominal = cachingPdfNominal_->eval(data);
     unsigned int size = nominal.size();
-    work_.resize(size);
-    std::copy(nominal.begin(), nominal.end(), work_.begin());
+    out.resize(size);
+    std::copy(nominal.begin(), nominal.end(), out.begin());
     for (int i = 0, n =  coeffs_.size(); i < n; ++i) {
         double param = coeffs_[i]->getVal();
         int    code  = codes_[i];
@@ -138,12 +144,12 @@ const std::vector<Double_t> & cacheutils::CachingPiecewiseInterpolation::eval(co
                     if (param > 0) {
                         const std::vector<Double_t> & hi = cachingPdfsHi_[i].eval(data);
                         for (unsigned int j = 0; j < size; ++j) {
-                            work_[j] += param * (hi[j] - nominal[j]);
+                            out[j] += param * (hi[j] - nominal[j]);
                         }
                     } else {
                         const std::vector<Double_t> & lo = cachingPdfsLow_[i].eval(data);
                         for (unsigned int j = 0; j < size; ++j) {
-                            work_[j] += param * (nominal[j] - lo[j]);
+                            out[j] += param * (nominal[j] - lo[j]);
                         }
                     }
                 } break;
@@ -152,12 +158,12 @@ const std::vector<Double_t> & cacheutils::CachingPiecewiseInterpolation::eval(co
                     if (param > 0) {
                         const std::vector<Double_t> & hi = cachingPdfsHi_[i].eval(data);
                         for (unsigned int j = 0; j < size; ++j) {
-                            work_[j] *= std::pow(hi[j]/nominal[j], param);
+                            out[j] *= std::pow(hi[j]/nominal[j], param);
                         }
                     } else {
                         const std::vector<Double_t> & lo = cachingPdfsLow_[i].eval(data);
                         for (unsigned int j = 0; j < size; ++j) {
-                            work_[j] *= std::pow(lo[j]/nominal[j], -param);
+                            out[j] *= std::pow(lo[j]/nominal[j], -param);
                         }
                     }
                 } break;
@@ -166,12 +172,12 @@ const std::vector<Double_t> & cacheutils::CachingPiecewiseInterpolation::eval(co
                     if (param > 1.) {
                         const std::vector<Double_t> & hi = cachingPdfsHi_[i].eval(data);
                         for (unsigned int j = 0; j < size; ++j) {
-                            work_[j] += param * (hi[j] - nominal[j]);
+                            out[j] += param * (hi[j] - nominal[j]);
                         }
                     } else if (param < -1.){
                         const std::vector<Double_t> & lo = cachingPdfsLow_[i].eval(data);
                         for (unsigned int j = 0; j < size; ++j) {
-                            work_[j] += param * (nominal[j] - lo[j]);
+                            out[j] += param * (nominal[j] - lo[j]);
                         }
                     } else {
                         const std::vector<Double_t> & hi = cachingPdfsHi_[i].eval(data);
@@ -183,7 +189,7 @@ const std::vector<Double_t> & cacheutils::CachingPiecewiseInterpolation::eval(co
                             double A = 0.0625*(eps_plus-eps_minus);
                             double val = nominal[j] + param * (S + param * A * ( 15 + param * param * (-10 + param * param * 3  ) ) );
                             if (val < 0) val = 0;
-                            work_[j] += (val - nominal[j]);
+                            out[j] += (val - nominal[j]);
                         }
                     }
                 } break;
@@ -194,10 +200,9 @@ const std::vector<Double_t> & cacheutils::CachingPiecewiseInterpolation::eval(co
     }
     if (positiveDefinite_) {
         for (unsigned int j = 0; j < size; ++j) {
-            if (work_[j] < 0) work_[j] = 0;
+            if (out[j] < 0) out[j] = 0;
         }
     }
-    return work_;
 }
 
 void cacheutils::CachingPiecewiseInterpolation::setDataDirty()
@@ -0,0 +1,39 @@
+#include "HiggsAnalysis/CombinedLimit/interface/VectorizedNCSpline.h"
+#include <RooRealVar.h>
+#include <stdexcept>
+
+VectorizedNCSpline::VectorizedNCSpline(const RooNCSplineCore &spline, const RooAbsData &data, bool includeZeroWeights)
+{
+    RooArgSet obs(*data.get());
+    RooArgList coords(spline.getCoordinates());
+    std::vector<const RooRealVar *> vars(coords.getSize());
+    for (int i = 0, n = coords.getSize(); i < n; ++i) {
+        vars[i] = dynamic_cast<const RooRealVar *>(obs.find(coords.at(i)->GetName()));
+        if (vars[i] == 0) throw std::invalid_argument(std::string("VectorizedNCSpline: coordinate ")+coords.at(i)->GetName()+" of "+spline.GetName()+" is not an observable (set --X-rtd ADDNLL_SPLINENLL=0)");
+    }
+
+    std::vector<std::vector<Double_t>> vals(vars.size());
+    for (auto &v : vals) v.reserve(data.numEntries());
+    for (unsigned int i = 0, n = data.numEntries(); i < n; ++i) {
+        data.get(i);
+        if (data.weight() || includeZeroWeights) {
+            for (unsigned int j = 0; j < vars.size(); ++j) vals[j].push_back(vars[j]->getVal());
+        }
+    }
+
+    unsigned int n = vals.front().size();
+    values_.resize(n);
+    if (n == 0) return;
+    std::vector<const Double_t *> columns;
+    for (const auto &v : vals) columns.push_back(&v[0]);
+    spline.evaluateBatch(n, columns, &values_[0]);
+}
+
+bool VectorizedNCSpline::canVectorize(const RooNCSplineCore &spline, const RooArgSet &obs)
+{
+    RooArgList coords(spline.getCoordinates());
+    for (int i = 0, n = coords.getSize(); i < n; ++i) {
+        if (dynamic_cast<const RooRealVar *>(coords.at(i)) == 0 || !obs.contains(*coords.at(i))) return false;
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#include "HiggsAnalysis/CombinedLimit/interface/VectorizedSpinZeroPdfs.h"
+#include "HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_1D_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_2D_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_phase_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/VBFHZZ4L_RooSpinZeroPdf_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/VVHZZ4L_RooSpinZeroPdf_1D_fast.h"
+#include "vectorized.h"
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+
+template<typename PdfT>
+VectorizedSpinZeroPdf<PdfT>::VectorizedSpinZeroPdf(const PdfT &pdf, const RooAbsData &data, bool includeZeroWeights) :
+    pdf_(&pdf)
+{
+    std::unique_ptr<RooArgSet> obs(pdf.getObservables(data));
+    RooArgSet analVars;
+    Int_t code = pdf.getAnalyticalIntegral(*obs, analVars);
+    if (code == 0 || analVars.getSize() != obs->getSize()) {
+        throw std::invalid_argument(std::string("Can't integrate ") + pdf.GetName() + " analytically over its observables: if this is intended, set --X-rtd ADDNLL_SPINZERONLL=0 to disable its vectorization in NLL.");
+    }
+
+    const RooArgList &comps = pdf.getCoefList();
+    unsigned int ncomp = comps.getSize();
+    std::vector<const RooAbsReal *> compv(ncomp);
+    integrals_.resize(ncomp);
+    for (unsigned int ic = 0; ic < ncomp; ++ic) {
+        compv[ic] = static_cast<const RooAbsReal *>(comps.at(ic));
+        integrals_[ic] = compv[ic]->analyticalIntegral(code);
+    }
+
+    nentries_ = 0;
+    for (unsigned int i = 0, n = data.numEntries(); i < n; ++i) {
+        data.get(i);
+        if (data.weight() || includeZeroWeights) nentries_++;
+    }
+    templates_.resize(ncomp * nentries_);
+    for (unsigned int i = 0, n = data.numEntries(), k = 0; i < n; ++i) {
+        data.get(i);
+        if (!(data.weight() || includeZeroWeights)) continue;
+        for (unsigned int ic = 0; ic < ncomp; ++ic) {
+            templates_[ic * nentries_ + k] = compv[ic]->getVal();
+        }
+        ++k;
+    }
+}
+
+template<typename PdfT>
+bool VectorizedSpinZeroPdf<PdfT>::canVectorize(const PdfT &pdf, const RooArgSet &obs)
+{
+    const RooArgList &comps = pdf.getCoefList();
+    for (int ic = 0, n = comps.getSize(); ic < n; ++ic) {
+        std::unique_ptr<RooArgSet> params(comps.at(ic)->getParameters(obs));
+        if (params->getSize() != 0) return false;
+    }
+    return true;
+}
+
+template<typename PdfT>
+void VectorizedSpinZeroPdf<PdfT>::fill(std::vector<Double_t> &out) const {
+    out.resize(nentries_);
+    if (nentries_ == 0) return;
+    // as in the pdf, values and integral are 1e-100 where they would not be positive
+    if (!pdf_->getCoefficients(coefs_)) {
+        std::fill(out.begin(), out.end(), 1.0);
+        return;
+    }
+    double norm = 0;
+    std::fill(out.begin(), out.end(), 0.0);
+    for (unsigned int ic = 0, ncomp = coefs_.size(); ic < ncomp; ++ic) {
+        if (coefs_[ic] == 0) continue;
+        norm += coefs_[ic] * integrals_[ic];
+        vectorized::mul_add(nentries_, coefs_[ic], &templates_[ic * nentries_], &out[0]);
+    }
+    double invnorm = 1.0/(norm > 0 ? norm : 1e-100);
+    for (unsigned int i = 0; i < nentries_; ++i) {
+        out[i] = (out[i] > 0 ? out[i] : 1e-100) * invnorm;
+    }
+}
+
+template class VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_1D_fast>;
+template class VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_2D_fast>;
+template class VectorizedSpinZeroPdf<HZZ4L_RooSpinZeroPdf_phase_fast>;
+template class VectorizedSpinZeroPdf<VBFHZZ4L_RooSpinZeroPdf_fast>;
+template class VectorizedSpinZeroPdf<VVHZZ4L_RooSpinZeroPdf_1D_fast>;
@@ -10,6 +10,8 @@
 #include "RooRealVar.h"
 #include "RooMsgService.h"
 #include "RooAbsData.h"
+#include "TBuffer.h"
+#include "vectorized.h"
 
 //#define TRACE_CALLS
 #ifdef TRACE_CALLS
@@ -754,7 +756,7 @@ ClassImp(FastVerticalInterpHistPdf2)
 
 //_____________________________________________________________________________
 FastVerticalInterpHistPdf2Base::FastVerticalInterpHistPdf2Base() :
-    _initBase(false)
+    _initBase(false), _packedStride(0), _packedActiveSize(0), _nIncremental(0)
 {
   // Default constructor
 }
@@ -767,7 +769,8 @@ FastVerticalInterpHistPdf2Base::FastVerticalInterpHistPdf2Base(const char *name,
   _smoothRegion(smoothRegion),
   _smoothAlgo(smoothAlgo),
   _initBase(false),
-  _morphs(), _morphParams()
+  _morphs(), _morphParams(),
+  _packedStride(0), _packedActiveSize(0), _nIncremental(0)
 { 
   if (inFuncList.GetSize()!=2*inCoefList.getSize()+1) {
     coutE(InputArguments) << "VerticalInterpHistPdf::VerticalInterpHistPdf(" << GetName() 
@@ -810,7 +813,9 @@ FastVerticalInterpHistPdf2Base::FastVerticalInterpHistPdf2Base(const FastVertica
   _smoothRegion(other._smoothRegion),
   _smoothAlgo(other._smoothAlgo),
   _initBase(other._initBase),
-  _morphs(other._morphs), _morphParams(other._morphParams)
+  _morphs(other._morphs), _morphParams(other._morphParams),
+  _packedMorphs(other._packedMorphs), _packedStride(other._packedStride), _packedActiveSize(other._packedActiveSize),
+  _nIncremental(0)
 {
     if (_initBase) {
         // Morph params are already set, but we must set the sentry
@@ -826,7 +831,8 @@ FastVerticalInterpHistPdf2Base::FastVerticalInterpHistPdf2Base(const FastVertica
   _smoothRegion(other._smoothRegion),
   _smoothAlgo(other._smoothAlgo),
   _initBase(false),
-  _morphs(), _morphParams()
+  _morphs(), _morphParams(),
+  _packedStride(0), _packedActiveSize(0), _nIncremental(0)
 {
   // Convert constructor
 }
@@ -835,6 +841,7 @@ FastVerticalInterpHistPdf2Base::FastVerticalInterpHistPdf2Base(const FastVertica
 Bool_t FastVerticalInterpHistPdf2Base::importWorkspaceHook(RooWorkspace& ws) {
   _initBase = false;
   _morphParams.clear();
+  _morphSum = FastTemplate();
   _sentry.reset();
   return kFALSE;
 }
@@ -955,10 +962,15 @@ void FastVerticalInterpHistPdf2::setActiveBins(unsigned int bins) {
   _cache.SetActiveSize(bins);
   _cacheNominal.SetActiveSize(bins);
   _cacheNominalLog.SetActiveSize(bins);
-  for (Morph & m : _morphs) {
-    m.sum.SetActiveSize(bins);
-    m.diff.SetActiveSize(bins);
+  if (!_packedMorphs.empty()) {
+    _packedActiveSize = bins;
+  } else {
+    for (Morph & m : _morphs) {
+      m.sum.SetActiveSize(bins);
+      m.diff.SetActiveSize(bins);
+    }
   }
+  _morphSum = FastTemplate(); // force a full recomputation at the next sync
   //printf("Setting the number of active bins to be %d/%d for %s\n", bins, _cacheNominal.fullsize(), GetName());
 }
 
@@ -1093,17 +1105,37 @@ void FastVerticalInterpHistPdf2Base::syncTotal(FastTemplate &cache, const FastTe
      * so we just do template += (0.5 * x) * (diff + smoothStepFunc(x) * sum)
      * ========================================== */
 
-    // start from nominal
-    cache.CopyValues(_smoothAlgo < 0 ? cacheNominalLog : cacheNominal);
-    //printf("Cache initialized to nominal template: \n");  cacheNominal.Dump();
-
-    // apply all morphs one by one
-    for (int i = 0, ndim = _coefList.getSize(); i < ndim; ++i) {
+    // Each morph enters as template += (0.5 * x) * diff + (0.5 * x * smoothStepFunc(x)) * sum,
+    // i.e. linearly in the rows of _packedMorphs. The nominal plus all the morphs
+    // is kept in _morphSum, so that when only some of the parameters changed
+    // (e.g. while computing the gradient) only those morphs are re-applied, as deltas.
+    // A full recomputation is done every kMaxIncrementalUpdates updates to avoid
+    // accumulating rounding errors.
+    if (_packedMorphs.empty()) packMorphs();
+    const FastTemplate &nominal = (_smoothAlgo < 0 ? cacheNominalLog : cacheNominal);
+    unsigned int nbins = cache.size(), ndim = _coefList.getSize();
+    bool full = (_morphSum.size() != nbins || _nIncremental >= kMaxIncrementalUpdates);
+    if (full) {
+        _morphSum = nominal;
+        _morphCoeffs.assign(2*ndim, 0.);
+        _nIncremental = 0;
+    }
+    bool changed = false;
+    for (unsigned int i = 0; i < ndim; ++i) {
         double x = _morphParams[i]->getVal();
         double a = 0.5*x, b = smoothStepFunc(x);
-        cache.Meld(_morphs[i].diff, _morphs[i].sum, a, b);    
-        //printf("Merged transformation for dimension %d, x = %+5.3f, step = %.3f: \n", i, x, b);  cache.Dump();
+        double coeffs[2] = { a, a*b };
+        for (unsigned int j = 0; j < 2; ++j) {
+            double &old = _morphCoeffs[2*i+j];
+            if (coeffs[j] == old) continue;
+            vectorized::mul_add(nbins, coeffs[j] - old, &_packedMorphs[(2*i+j)*_packedStride], &_morphSum[0]);
+            old = coeffs[j];
+            changed = true;
+        }
     }
+    if (changed && !full) ++_nIncremental;
+    cache.CopyValues(_morphSum);
+    //printf("Cache after applying all morphs: \n");  cache.Dump();
 
     // if necessary go back to linear scale
     if (_smoothAlgo < 0) {
@@ -1117,6 +1149,48 @@ void FastVerticalInterpHistPdf2Base::syncTotal(FastTemplate &cache, const FastTe
     _sentry.reset();
 }
 
+void FastVerticalInterpHistPdf2Base::packMorphs() const {
+    _packedStride = _morphs.empty() ? 0 : _morphs.front().diff.fullsize();
+    _packedMorphs.assign(2*_morphs.size()*_packedStride, 0.);
+    for (unsigned int i = 0, n = _morphs.size(); i < n; ++i) {
+        const Morph &m = _morphs[i];
+        assert(m.diff.fullsize() == _packedStride && m.sum.fullsize() == _packedStride);
+        std::copy(&m.diff[0], &m.diff[0] + _packedStride, &_packedMorphs[(2*i)*_packedStride]);
+        std::copy(&m.sum[0],  &m.sum[0]  + _packedStride, &_packedMorphs[(2*i+1)*_packedStride]);
+    }
+    _packedActiveSize = _morphs.empty() ? 0 : _morphs.front().diff.size();
+    for (Morph &m : _morphs) {
+        m.diff.Release();
+        m.sum.Release();
+    }
+    _morphSum = FastTemplate();
+}
+
+void FastVerticalInterpHistPdf2Base::unpackMorphs() const {
+    if (_packedMorphs.empty()) return;
+    for (unsigned int i = 0, n = _morphs.size(); i < n; ++i) {
+        Morph &m = _morphs[i];
+        m.diff = FastTemplate(_packedStride);
+        m.sum  = FastTemplate(_packedStride);
+        std::copy(&_packedMorphs[(2*i)*_packedStride],   &_packedMorphs[(2*i+1)*_packedStride], &m.diff[0]);
+        std::copy(&_packedMorphs[(2*i+1)*_packedStride], &_packedMorphs[(2*i+2)*_packedStride], &m.sum[0]);
+        m.diff.SetActiveSize(_packedActiveSize);
+        m.sum.SetActiveSize(_packedActiveSize);
+    }
+    std::vector<double>().swap(_packedMorphs);
+    _morphSum = FastTemplate();
+}
+
+void FastVerticalInterpHistPdf2Base::Streamer(TBuffer &R__b) {
+    // the morphs are persisted, so they must be taken out of the packed block before writing
+    if (R__b.IsReading()) {
+        R__b.ReadClassBuffer(FastVerticalInterpHistPdf2Base::Class(), this);
+    } else {
+        unpackMorphs();
+        R__b.WriteClassBuffer(FastVerticalInterpHistPdf2Base::Class(), this);
+    }
+}
+
 void FastVerticalInterpHistPdf2::syncTotal() const {
     FastVerticalInterpHistPdf2Base::syncTotal(_cache, _cacheNominal, _cacheNominalLog);
 
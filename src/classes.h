@@ -1,4 +1,5 @@
 #include "HiggsAnalysis/CombinedLimit/interface/TestProposal.h"
+#include "HiggsAnalysis/CombinedLimit/interface/AdaptiveProposal.h"
 #include "HiggsAnalysis/CombinedLimit/interface/DebugProposal.h"
 #include "HiggsAnalysis/CombinedLimit/interface/VerticalInterpPdf.h"
 #include "HiggsAnalysis/CombinedLimit/interface/VerticalInterpHistPdf.h"
@@ -7,11 +7,19 @@
 #include <sstream>
 #include <cmath>
 #include <vector>
+#include <map>
 #include <unordered_map>
 #include <string>
 #include <memory>
 #include <typeinfo>
 #include <stdexcept>
+#include <limits>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
 
 #include <TIterator.h>
 #include <TString.h>
@@ -28,6 +36,7 @@
 #include <RooSimultaneous.h>
 #include <RooWorkspace.h>
 #include <RooPlot.h>
+#include <RooRandom.h>
 #include <RooStats/ModelConfig.h>
 #include <RooStats/RooStatsUtils.h>
 
@@ -40,6 +49,9 @@
 #include "HiggsAnalysis/CombinedLimit/interface/ProfilingTools.h"
 #include "HiggsAnalysis/CombinedLimit/interface/Logger.h"
 #include "HiggsAnalysis/CombinedLimit/interface/RooMultiPdf.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistFunc.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistErrorPropagator.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CachingNLL.h"
 
 using namespace std;
 
@@ -1105,6 +1117,140 @@ bool utils::freezeAllDisassociatedRooMultiPdfParameters(const RooArgSet & multiP
 	return false;
 }
 
+namespace {
+    bool writeAll(int fd, const void *buff, size_t size) {
+        const char *ptr = static_cast<const char *>(buff);
+        while (size > 0) {
+            ssize_t n = write(fd, ptr, size);
+            if (n == -1 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            ptr += n; size -= n;
+        }
+        return true;
+    }
+    /// take out of buff the complete results (header + values) sent by a worker; returns false for a corrupted header
+    bool consumeResults(std::string &buff, std::vector<std::vector<double> > &ret, std::vector<char> &received) {
+        size_t pos = 0;
+        while (buff.size() - pos >= 2*sizeof(uint32_t)) {
+            uint32_t header[2];
+            memcpy(header, buff.data() + pos, sizeof(header));
+            if (header[0] >= ret.size()) return false;
+            size_t size = sizeof(header) + size_t(header[1])*sizeof(double);
+            if (buff.size() - pos < size) break;
+            std::vector<double> &res = ret[header[0]];
+            res.resize(header[1]);
+            if (header[1]) memcpy(res.data(), buff.data() + pos + sizeof(header), header[1]*sizeof(double));
+            received[header[0]] = 1;
+            pos += size;
+        }
+        buff.erase(0, pos);
+        return true;
+    }
+}
+
+std::vector<std::vector<double> > utils::forkJobs(unsigned int njobs, unsigned int nworkers, const std::function<std::vector<double>(unsigned int)> &job, bool reseed) {
+    std::vector<std::vector<double> > ret(njobs);
+    if (njobs == 0) return ret;
+    if (nworkers > njobs) nworkers = njobs;
+    if (nworkers == 0) nworkers = 1;
+    // seeds are drawn only if needed, otherwise the random stream of the parent would depend on the use of workers
+    std::vector<UInt_t> seeds;
+    if (reseed) {
+        seeds.resize(njobs);
+        for (unsigned int ij = 0; ij < njobs; ++ij) seeds[ij] = RooRandom::integer(std::numeric_limits<UInt_t>::max()-1);
+    }
+    // flush now, or the buffered output would be printed once per child
+    std::cout.flush(); std::cerr.flush(); fflush(stdout); fflush(stderr);
+    Logger::instance().flush();
+    std::vector<int> fds; std::vector<pid_t> pids;
+    for (unsigned int iw = 0; iw < nworkers; ++iw) {
+        int pfd[2];
+        if (pipe(pfd) != 0) throw std::runtime_error("utils::forkJobs: cannot create pipe");
+        pid_t pid = fork();
+        if (pid == -1) throw std::runtime_error("utils::forkJobs: fork failed");
+        if (pid == 0) { // child
+            close(pfd[0]);
+            for (int fd : fds) close(fd); // the pipes of the previous workers belong to the parent
+            int status = 0;
+            for (unsigned int ij = iw; ij < njobs; ij += nworkers) {
+                if (reseed) RooRandom::randomGenerator()->SetSeed(seeds[ij]);
+                std::vector<double> res;
+                try {
+                    res = job(ij);
+                } catch (std::exception &ex) {
+                    std::cerr << "utils::forkJobs: job " << ij << " failed: " << ex.what() << std::endl;
+                    status = 1;
+                    continue;
+                } catch (...) {
+                    std::cerr << "utils::forkJobs: job " << ij << " failed." << std::endl;
+                    status = 1;
+                    continue;
+                }
+                uint32_t header[2] = { ij, uint32_t(res.size()) };
+                if (!writeAll(pfd[1], header, sizeof(header)) || !writeAll(pfd[1], res.data(), res.size()*sizeof(double))) { status = 2; break; }
+            }
+            close(pfd[1]);
+            std::cout.flush(); std::cerr.flush(); fflush(stdout); fflush(stderr);
+            Logger::instance().flush();
+            _exit(status); // don't run static destructors or ROOT cleanup, they belong to the parent
+        }
+        close(pfd[1]);
+        fds.push_back(pfd[0]);
+        pids.push_back(pid);
+    }
+    // read from all the workers at the same time, so that none of them is blocked on a full pipe
+    std::vector<struct pollfd> pfds(fds.size());
+    std::vector<std::string> buffers(fds.size());
+    std::vector<char> received(njobs, 0);
+    for (unsigned int iw = 0; iw < fds.size(); ++iw) { pfds[iw].fd = fds[iw]; pfds[iw].events = POLLIN; pfds[iw].revents = 0; }
+    unsigned int nopen = fds.size();
+    bool corrupted = false;
+    std::vector<char> chunk(1 << 16);
+    while (nopen > 0 && !corrupted) {
+        int nready = poll(pfds.data(), pfds.size(), -1);
+        if (nready == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (unsigned int iw = 0; iw < pfds.size(); ++iw) {
+            if (pfds[iw].fd < 0 || pfds[iw].revents == 0) continue;
+            ssize_t n = read(pfds[iw].fd, chunk.data(), chunk.size());
+            if (n == -1 && errno == EINTR) continue;
+            if (n > 0) {
+                buffers[iw].append(chunk.data(), n);
+                if (!consumeResults(buffers[iw], ret, received)) { corrupted = true; break; }
+                continue;
+            }
+            close(pfds[iw].fd); pfds[iw].fd = -1; --nopen; // EOF or error
+        }
+    }
+    for (unsigned int iw = 0; iw < pfds.size(); ++iw) {
+        if (pfds[iw].fd >= 0) close(pfds[iw].fd);
+        if (corrupted) kill(pids[iw], SIGKILL);
+    }
+    for (unsigned int iw = 0; iw < pids.size(); ++iw) {
+        int cstatus, wret;
+        do { wret = waitpid(pids[iw], &cstatus, 0); } while (wret == -1 && errno == EINTR);
+        if (corrupted || wret == -1) continue;
+        if (WIFSIGNALED(cstatus)) {
+            std::cerr << "utils::forkJobs: worker " << iw << " was killed by signal " << WTERMSIG(cstatus) << std::endl;
+        } else if (WIFEXITED(cstatus) && WEXITSTATUS(cstatus) != 0) {
+            std::cerr << "utils::forkJobs: worker " << iw << " exited with status " << WEXITSTATUS(cstatus) << std::endl;
+        }
+    }
+    if (corrupted) throw std::runtime_error("utils::forkJobs: corrupted result from child");
+    std::vector<unsigned int> missing;
+    for (unsigned int ij = 0; ij < njobs; ++ij) {
+        if (!received[ij]) missing.push_back(ij);
+    }
+    if (!missing.empty()) {
+        std::cerr << "utils::forkJobs: " << missing.size() << " of " << njobs << " jobs did not report back:";
+        for (unsigned int ij : missing) std::cerr << " " << ij;
+        std::cerr << std::endl;
+    }
+    return ret;
+}
+
 void utils::RooAddPdfFixer::Fix(RooAddPdf & fixme) {
   RooAddPdfFixer & fixme_casted = static_cast<RooAddPdfFixer &>(fixme);
   delete[] fixme_casted.RooAddPdf::_coefCache;
@@ -1123,3 +1269,94 @@ void utils::RooAddPdfFixer::FixAll(RooWorkspace & w) {
   }
 }
 
+namespace {
+    // Memory of the objects of the classes we know how to account for, 0 for the others
+    size_t memoryUsageOf(const RooAbsArg *arg, std::string &cls) {
+        if (const CMSHistFunc *hf = dynamic_cast<const CMSHistFunc *>(arg)) {
+            cls = "CMSHistFunc";
+            return hf->memoryUsage();
+        }
+        if (const CMSHistErrorPropagator *ep = dynamic_cast<const CMSHistErrorPropagator *>(arg)) {
+            cls = "CMSHistErrorPropagator";
+            return ep->memoryUsage();
+        }
+        return 0;
+    }
+
+    long residentMemoryKB() {
+        FILE *f = fopen("/proc/self/status", "r");
+        if (f == 0) return -1;
+        char line[256]; long kb = -1;
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "VmRSS: %ld", &kb) == 1) break;
+        }
+        fclose(f);
+        return kb;
+    }
+}
+
+void utils::printMemoryReport(const RooWorkspace &w, const RooAbsPdf *pdf) {
+    std::map<std::string, std::pair<int,size_t> > perClass;
+    size_t total = 0;
+    RooFIter iter = w.components().fwdIterator();
+    for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+        std::string cls;
+        size_t bytes = memoryUsageOf(a, cls);
+        if (cls.empty()) continue;
+        perClass[cls].first++;
+        perClass[cls].second += bytes;
+        total += bytes;
+    }
+    std::cout << "Memory report:" << std::endl;
+    std::cout << Form("   %-40s %8s %12s", "class", "objects", "MB") << std::endl;
+    for (const auto &c : perClass) {
+        std::cout << Form("   %-40s %8d %12.3f", c.first.c_str(), c.second.first, c.second.second/1048576.) << std::endl;
+    }
+    std::cout << Form("   %-40s %8s %12.3f", "total", "", total/1048576.) << std::endl;
+
+    // the NLLs evaluate clones of the pdfs, which have their own templates and caches;
+    // only the NLLs still alive at this point (e.g. kept by the method) can be counted
+    std::map<std::string, std::pair<int,size_t> > perClassClones;
+    size_t totalClones = 0;
+    for (const cacheutils::CachingPdf *cp : cacheutils::CachingPdf::instances()) {
+        RooFIter citer = cp->clonedPieces().fwdIterator();
+        for (RooAbsArg *a = citer.next(); a != 0; a = citer.next()) {
+            std::string cls;
+            size_t bytes = memoryUsageOf(a, cls);
+            if (cls.empty()) continue;
+            perClassClones[cls].first++;
+            perClassClones[cls].second += bytes;
+            totalClones += bytes;
+        }
+    }
+    if (!perClassClones.empty()) {
+        std::cout << Form("   %-40s %8s %12s", "clones in the NLLs still alive", "objects", "MB") << std::endl;
+        for (const auto &c : perClassClones) {
+            std::cout << Form("   %-40s %8d %12.3f", c.first.c_str(), c.second.first, c.second.second/1048576.) << std::endl;
+        }
+        std::cout << Form("   %-40s %8s %12.3f", "total (clones)", "", totalClones/1048576.) << std::endl;
+    }
+
+    const RooSimultaneous *sim = dynamic_cast<const RooSimultaneous *>(pdf);
+    if (sim != 0) {
+        std::cout << Form("   %-40s %8s %12s", "channel", "objects", "MB") << std::endl;
+        std::unique_ptr<RooAbsCategoryLValue> cat((RooAbsCategoryLValue *) sim->indexCat().Clone());
+        for (int i = 0, n = cat->numBins((const char *)0); i < n; ++i) {
+            cat->setBin(i);
+            RooAbsPdf *chpdf = sim->getPdf(cat->getLabel());
+            if (chpdf == 0) continue;
+            std::unique_ptr<RooArgSet> comps(chpdf->getComponents());
+            int nobj = 0; size_t bytes = 0;
+            RooFIter citer = comps->fwdIterator();
+            for (RooAbsArg *a = citer.next(); a != 0; a = citer.next()) {
+                std::string cls;
+                size_t b = memoryUsageOf(a, cls);
+                if (cls.empty()) continue;
+                nobj++; bytes += b;
+            }
+            std::cout << Form("   %-40s %8d %12.3f", cat->getLabel(), nobj, bytes/1048576.) << std::endl;
+        }
+    }
+    long rss = residentMemoryKB();
+    if (rss >= 0) std::cout << Form("   %-40s %8s %12.3f", "process resident size", "", rss/1024.) << std::endl;
+}
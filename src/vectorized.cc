@@ -13,6 +13,18 @@ void vectorized::mul_add_sqr(const uint32_t size, double coeff, double const * _
     } 
 }
 
+void vectorized::sqr_mul_add(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    for (uint32_t i = 0; i < size; ++i) {
+        oarray[i] += coeff * iarray[i] * iarray[i];
+    } 
+}
+
+void vectorized::lin_comb(const uint32_t size, double coeff1, double const * __restrict__ iarray1, double coeff2, double const * __restrict__ iarray2, double* __restrict__ oarray) {
+    for (uint32_t i = 0; i < size; ++i) {
+        oarray[i] = coeff1 * iarray1[i] + coeff2 * iarray2[i];
+    } 
+}
+
 void vectorized::mul_inplace(const uint32_t size, double const * __restrict__ iarray, double* __restrict__ oarray) {
     for (uint32_t i = 0; i < size; ++i) {
         oarray[i] *= iarray[i];
@@ -81,6 +93,20 @@ void vectorized::powers(const uint32_t size, double exponent, double norm, const
     vdt::fast_expv(size, workingArea, out);
 }
 
+void vectorized::sqr_diff_add(const uint32_t size, double x0, double const * __restrict__ iarray, double* __restrict__ oarray) {
+    for (uint32_t i = 0; i < size; ++i) {
+        double d = iarray[i] - x0;
+        oarray[i] += d * d;
+    }
+}
+
+void vectorized::gaussian_kernel(const uint32_t size, double iscale, double* __restrict__ iarray, double* __restrict__ oarray) {
+    for (uint32_t i = 0; i < size; ++i) {
+        iarray[i] *= -iscale;
+    }
+    vdt::fast_expv(size, iarray, oarray);
+}
+
 double vectorized::dot_product(const uint32_t size, double const * __restrict__ vec1, double const *  __restrict__ vec2) {
     DefaultAccumulator<double> ret = 0;
     for (uint32_t i = 0; i < size; ++i) {
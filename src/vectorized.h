@@ -7,6 +7,12 @@ namespace vectorized {
     // oarray += (coeff * iarray)^2
     void mul_add_sqr(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) ;
 
+    // oarray += coeff * iarray^2
+    void sqr_mul_add(const uint32_t size, double coeff, double const * __restrict__ iarray, double* __restrict__ oarray) ;
+
+    // oarray = coeff1 * iarray1 + coeff2 * iarray2
+    void lin_comb(const uint32_t size, double coeff1, double const * __restrict__ iarray1, double coeff2, double const * __restrict__ iarray2, double* __restrict__ oarray) ;
+
     // oarray += sqrt(iarray)
     void sqrt(const uint32_t size, double const * __restrict__ iarray, double* __restrict__ oarray) ;
 
@@ -25,6 +31,12 @@ namespace vectorized {
     // powers
     void powers(const uint32_t size, double lambda, double norm, const double* __restrict__ xvals, double * __restrict__ out, double * __restrict__ workingArea) ;
 
+    // oarray += (iarray - x0)^2
+    void sqr_diff_add(const uint32_t size, double x0, double const * __restrict__ iarray, double* __restrict__ oarray) ;
+
+    // oarray = exp(- iscale * iarray); iarray is overwritten
+    void gaussian_kernel(const uint32_t size, double iscale, double* __restrict__ iarray, double* __restrict__ oarray) ;
+
     // dot product of two vectors 
     double dot_product(const uint32_t size, double const * __restrict__ iarray, double const * __restrict__ iarray2) ;
 }
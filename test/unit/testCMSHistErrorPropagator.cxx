@@ -0,0 +1,103 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <TH1D.h>
+#include <RooRealVar.h>
+#include <RooArgList.h>
+#include <RooBinning.h>
+#include <RooRandom.h>
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistFunc.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistErrorPropagator.h"
+
+// Compare the incremental update of CMSHistErrorPropagator, used when only the coefficients
+// change, with a fresh clone of it, which always makes a full update. Most steps change a
+// single coefficient, so that long runs of incremental updates (more than the 200 after
+// which a full update is forced) are covered; some steps move a shape, or set a coefficient
+// to zero, or change the bin parameters.
+
+bool differ(double full, double incr) {
+    return !(std::abs(full - incr) <= 1e-9 * (std::abs(full) + std::abs(incr)) + 1e-12);
+}
+
+TH1D *makeHist(const char *name, int nbins, const double *edges, double slope, double scale) {
+    TH1D *h = new TH1D(name, "", nbins, edges);
+    h->SetDirectory(0);
+    for (int b = 1; b <= nbins; ++b) {
+        double x = h->GetBinCenter(b), w = h->GetBinWidth(b);
+        double y = scale * w * std::exp(-slope * x);
+        h->SetBinContent(b, y);
+        h->SetBinError(b, 0.1 * std::sqrt(y) + 0.01);
+    }
+    return h;
+}
+
+unsigned int compare(CMSHistErrorPropagator &prop, RooRealVar &x, int step, unsigned int &ntry) {
+    std::unique_ptr<RooAbsReal> full((RooAbsReal *) prop.clone(""));
+    unsigned int nfail = 0;
+    for (int b = 0, nb = x.getBins(); b < nb; ++b, ++ntry) {
+        x.setVal(x.getBinning().binCenter(b));
+        double yincr = prop.getVal(), yfull = full->getVal();
+        if (differ(yfull, yincr)) {
+            printf("step %d bin %d: full %14.8g, incremental %14.8g\n", step, b, yfull, yincr);
+            nfail++;
+        }
+    }
+    return nfail;
+}
+
+unsigned int run(int steps) {
+    const int nbins = 8;
+    const double edges[nbins+1] = { 0, 1, 2, 3, 4, 6, 8, 12, 20 };
+    RooRealVar x("x", "x", 0, 20);
+    x.setBinning(RooBinning(nbins, edges));
+
+    const int nproc = 3;
+    std::vector<std::unique_ptr<RooRealVar>> thetas, coeffs;
+    std::vector<std::unique_ptr<CMSHistFunc>> funcs;
+    RooArgList funcList, coeffList;
+    for (int p = 0; p < nproc; ++p) {
+        TString name = TString::Format("proc%d", p);
+        thetas.emplace_back(new RooRealVar("theta_"+name, "", 0, -3, 3));
+        coeffs.emplace_back(new RooRealVar("norm_"+name, "", 1 + p, 0, 10));
+        std::unique_ptr<TH1D> nominal(makeHist(name, nbins, edges, 0.1 * (p + 1), 20. / (p + 1)));
+        std::unique_ptr<TH1D> up(makeHist(name+"_up", nbins, edges, 0.08 * (p + 1), 22. / (p + 1)));
+        std::unique_ptr<TH1D> down(makeHist(name+"_down", nbins, edges, 0.12 * (p + 1), 19. / (p + 1)));
+        funcs.emplace_back(new CMSHistFunc("shape_"+name, "", x, *nominal));
+        funcs.back()->setVerticalMorphs(RooArgList(*thetas.back()));
+        funcs.back()->prepareStorage();
+        funcs.back()->setShape(0, 0, 0, 0, *nominal);
+        funcs.back()->setShape(0, 0, 1, 0, *down);
+        funcs.back()->setShape(0, 0, 1, 1, *up);
+        funcList.add(*funcs.back());
+        coeffList.add(*coeffs.back());
+    }
+    CMSHistErrorPropagator prop("prop", "", x, funcList, coeffList);
+    std::unique_ptr<RooArgList> binpars(prop.setupBinPars(0.));
+
+    unsigned int ntry = 0, nfail = 0;
+    nfail += compare(prop, x, -1, ntry);
+    for (int step = 0; step < steps; ++step) {
+        int p = int(RooRandom::uniform() * nproc);
+        if (step % 97 == 96) {
+            thetas[p]->setVal(RooRandom::randomGenerator()->Gaus(0, 1));
+        } else if (step % 31 == 30) {
+            coeffs[p]->setVal(0.);
+        } else if (step % 53 == 52 && binpars->getSize()) {
+            RooRealVar *bp = dynamic_cast<RooRealVar *>(binpars->at(int(RooRandom::uniform() * binpars->getSize())));
+            if (bp) bp->setVal(RooRandom::randomGenerator()->Gaus(0, 1));
+        } else {
+            coeffs[p]->setVal(RooRandom::uniform() * 10);
+        }
+        nfail += compare(prop, x, step, ntry);
+    }
+    printf("%s (%s), %d steps: %u attempts, %u failures\n", prop.GetName(), prop.ClassName(), steps, ntry, nfail);
+    return nfail;
+}
+
+int main(int argc, char **argv) {
+    RooRandom::randomGenerator()->SetSeed(42);
+    unsigned int nfail = run(argc >= 2 ? atoi(argv[1]) : 1000);
+    return nfail == 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <typeinfo>
+#include <vector>
+#include <TH1D.h>
+#include <RooRealVar.h>
+#include <RooFormulaVar.h>
+#include <RooProduct.h>
+#include <RooCategory.h>
+#include <RooBinning.h>
+#include <RooDataSet.h>
+#include <RooRealSumPdf.h>
+#include <RooRandom.h>
+#include "HiggsAnalysis/CombinedLimit/interface/CachingNLL.h"
+#include "HiggsAnalysis/CombinedLimit/interface/ProfilingTools.h"
+#include "HiggsAnalysis/CombinedLimit/interface/RooSimultaneousOpt.h"
+#include "HiggsAnalysis/CombinedLimit/interface/SimpleGaussianConstraint.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistFunc.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistErrorPropagator.h"
+#include "HiggsAnalysis/CombinedLimit/interface/ToyMCSamplerOpt.h"
+#include "HiggsAnalysis/CombinedLimit/interface/BinnedToyData.h"
+
+// Compare CachingSimNLL::setData on new datasets, where the fast paths only update the
+// weights (refreshWeights when the datasets of the channels are refilled with the same
+// entries, setBinnedWeights for the binned toys of toymcoptutils::SimPdfGenInfo), with a
+// CachingSimNLL created from scratch on a plain copy of the same data.
+// SIMNLL_NO_FAST_SETDATA is read once per process, so the reference is a new NLL, which
+// always goes through the full setData.
+// The model is like a combine binned model: a RooSimultaneousOpt of RooRealSumPdfs of
+// CMSHistErrorPropagators, one channel per observable, with variable bins in one channel
+// and few events per bin in another, and gaussian constraints as extra constraints.
+
+struct Model {
+    RooCategory *cat;
+    std::vector<RooRealVar *> xs;
+    std::vector<std::vector<double>> expected;  // events per bin at the initial point, used to make the data
+    RooArgSet obs, nuis, params;
+    RooRealVar *bkgScale;  // constant, to generate toys with more events
+    RooSimultaneousOpt *pdf;
+};
+
+TH1D *makeHist(const char *name, const RooRealVar &x, double norm, double slope, double peak) {
+    const RooAbsBinning &bins = x.getBinning();
+    TH1D *h = new TH1D(name, "", bins.numBins(), bins.array());
+    h->SetDirectory(0);
+    for (int b = 1; b <= h->GetNbinsX(); ++b) {
+        double c = h->GetBinCenter(b), w = h->GetBinWidth(b);
+        double y = w * (std::exp(-slope * (c - x.getMin()) / (x.getMax() - x.getMin())) + peak * std::exp(-0.5 * std::pow((c - 0.5 * (x.getMin() + x.getMax())) / (0.1 * (x.getMax() - x.getMin())), 2)));
+        h->SetBinContent(b, y);
+    }
+    h->Scale(norm / h->Integral());
+    for (int b = 1; b <= h->GetNbinsX(); ++b) h->SetBinError(b, 0.1 * std::sqrt(h->GetBinContent(b)));
+    return h;
+}
+
+// background with a vertical shape morph on theta, signal scaled by r; the objects live as long as the program
+void addChannel(Model &m, const char *label, RooRealVar *x, double nsig, double nbkg, RooRealVar &r, RooRealVar &theta) {
+    m.cat->defineType(label);
+    m.xs.push_back(x);
+    m.obs.add(*x);
+    TString ch(label);
+    std::unique_ptr<TH1D> sig(makeHist("sig_"+ch, *x, nsig, 0, 20)), bkg(makeHist("bkg_"+ch, *x, nbkg, 3, 0));
+    std::unique_ptr<TH1D> bkgUp(makeHist("bkg_"+ch+"_up", *x, 1.1 * nbkg, 2.5, 0)), bkgDown(makeHist("bkg_"+ch+"_down", *x, 0.9 * nbkg, 3.5, 0));
+    CMSHistFunc *fsig = new CMSHistFunc("shape_sig_"+ch, "", *x, *sig);
+    CMSHistFunc *fbkg = new CMSHistFunc("shape_bkg_"+ch, "", *x, *bkg);
+    fbkg->setVerticalMorphs(RooArgList(theta));
+    fbkg->prepareStorage();
+    fbkg->setShape(0, 0, 0, 0, *bkg);
+    fbkg->setShape(0, 0, 1, 0, *bkgDown);
+    fbkg->setShape(0, 0, 1, 1, *bkgUp);
+    // per-channel normalization nuisance, like a lnN
+    RooRealVar *nu = new RooRealVar("nu_"+ch, "", 0, -4, 4);
+    RooRealVar *nuIn = new RooRealVar("nu_"+ch+"_In", "", 0, -4, 4);
+    nuIn->setConstant(true);
+    RooRealVar *one = new RooRealVar("one_"+ch, "", 1);
+    one->setConstant(true);
+    m.nuis.add(*nu);
+    m.params.add(*nu);
+    m.pdf->addExtraConstraint(*new SimpleGaussianConstraint("nu_"+ch+"_Pdf", "", *nu, *nuIn, *one));
+    RooAbsReal *csig = new RooProduct("n_sig_"+ch, "", RooArgList(r));
+    RooAbsReal *cbkg = new RooFormulaVar("n_bkg_"+ch, "", "@1*pow(1.1,@0)", RooArgList(*nu, *m.bkgScale));
+    CMSHistErrorPropagator *prop = new CMSHistErrorPropagator("prop_"+ch, "", *x, RooArgList(*fsig, *fbkg), RooArgList(*csig, *cbkg));
+    prop->setAttribute("CachingPdf_Direct", true);
+    RooRealSumPdf *sum = new RooRealSumPdf("pdf_bin"+ch, "", RooArgList(*prop), RooArgList(*one), true);
+    m.pdf->addPdf(*sum, label);
+    std::vector<double> exp(x->getBins());
+    for (int b = 0; b < x->getBins(); ++b) exp[b] = sig->GetBinContent(b+1) + bkg->GetBinContent(b+1);
+    m.expected.push_back(exp);
+}
+
+Model makeModel() {
+    Model m;
+    m.cat = new RooCategory("CMS_channel", "");
+    m.pdf = new RooSimultaneousOpt("model_s", "", *m.cat);
+    RooRealVar *r = new RooRealVar("r", "", 1, 0, 5);
+    RooRealVar *theta = new RooRealVar("theta", "", 0, -4, 4);
+    RooRealVar *thetaIn = new RooRealVar("theta_In", "", 0, -4, 4);
+    RooRealVar *one = new RooRealVar("one", "", 1);
+    thetaIn->setConstant(true); one->setConstant(true);
+    m.bkgScale = new RooRealVar("bkgScale", "", 1);
+    m.bkgScale->setConstant(true);
+    m.nuis.add(*theta);
+    m.params.add(*r); m.params.add(*theta);
+    m.pdf->addExtraConstraint(*new SimpleGaussianConstraint("theta_Pdf", "", *theta, *thetaIn, *one));
+
+    RooRealVar *x1 = new RooRealVar("x1", "", 0, 10);
+    x1->setBins(10);
+    addChannel(m, "ch1", x1, 50, 1000, *r, *theta);
+
+    const double edges2[] = { 0, 1, 2, 4, 7, 12, 20 };
+    RooRealVar *x2 = new RooRealVar("x2", "", 0, 20);
+    x2->setBinning(RooBinning(6, edges2));
+    addChannel(m, "ch2", x2, 10, 40, *r, *theta);
+
+    RooRealVar *x3 = new RooRealVar("x3", "", 0, 8);
+    x3->setBins(8);
+    addChannel(m, "ch3", x3, 1, 4, *r, *theta);
+
+    m.obs.add(*m.cat);
+    return m;
+}
+
+// one entry per bin center, with Poisson weights (plus one if noZeros, so that the entries never change)
+RooDataSet *makeData(Model &m, bool noZeros) {
+    RooRealVar weight("_weight_", "", 1);
+    RooArgSet vars(m.obs); vars.add(weight);
+    RooDataSet *data = new RooDataSet("data", "", vars, "_weight_");
+    for (unsigned int ich = 0; ich < m.xs.size(); ++ich) {
+        m.cat->setIndex(ich);
+        RooRealVar *x = m.xs[ich];
+        for (int b = 0; b < x->getBins(); ++b) {
+            x->setVal(x->getBinning().binCenter(b));
+            double w = RooRandom::randomGenerator()->Poisson(m.expected[ich][b]);
+            data->add(m.obs, noZeros ? w + 1 : w);
+        }
+    }
+    return data;
+}
+
+RooDataSet *plainCopy(const RooAbsData &data) {
+    RooRealVar weight("_weight_", "", 1);
+    RooArgSet vars(*data.get()); vars.add(weight);
+    RooDataSet *ret = new RooDataSet("plain", "", vars, "_weight_");
+    for (int i = 0, n = data.numEntries(); i < n; ++i) {
+        const RooArgSet *entry = data.get(i);
+        ret->add(*entry, data.weight());
+    }
+    return ret;
+}
+
+void randomize(const RooArgSet &params) {
+    RooFIter iter = params.fwdIterator();
+    for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+        RooRealVar *v = dynamic_cast<RooRealVar *>(a);
+        if (v == 0 || v->isConstant()) continue;
+        if (std::string(v->GetName()) == "r") v->setVal(RooRandom::uniform() * 3);
+        else v->setVal(RooRandom::randomGenerator()->Gaus(0, 1));
+    }
+}
+
+// nll has already been used on other data; data goes through its setData, and the result
+// is compared with a new CachingSimNLL at a few parameter points
+unsigned int compare(Model &m, cacheutils::CachingSimNLL &nll, const RooAbsData &data, const char *what, unsigned int &ntry) {
+    nll.setData(data);
+    nll.clearConstantZeroPoint();
+    std::unique_ptr<RooDataSet> plain(plainCopy(data));
+    cacheutils::CachingSimNLL ref(m.pdf, plain.get(), &m.nuis);
+    ref.clearConstantZeroPoint();
+    RooArgSet snap; m.params.snapshot(snap);
+    unsigned int nfail = 0;
+    for (int p = 0; p < 5; ++p, ++ntry) {
+        if (p) randomize(m.params);
+        double fast = nll.getVal(), full = ref.getVal();
+        if (!(std::abs(fast - full) <= 1e-9 * std::abs(full) + 1e-8)) {
+            printf("%s, point %d: setData %.10g, new NLL %.10g, diff %.3g\n", what, p, fast, full, fast - full);
+            nfail++;
+        }
+    }
+    m.params = snap;
+    return nfail;
+}
+
+// datasets with the same entries and new weights (refreshWeights); then some with
+// zero weights, whose entries change unless zero weights are kept
+unsigned int testRefreshWeights(Model &m, int ntoys, bool keepZeros) {
+    runtimedef::set("ADDNLL_ROOREALSUM_BASICINT", keepZeros);
+    runtimedef::set("ADDNLL_ROOREALSUM_KEEPZEROS", keepZeros);
+    std::unique_ptr<RooDataSet> first(makeData(m, true));
+    cacheutils::CachingSimNLL nll(m.pdf, first.get(), &m.nuis);
+    unsigned int ntry = 0, nfail = 0;
+    for (int i = 0; i < ntoys; ++i) {
+        bool noZeros = (i < ntoys / 2);
+        std::unique_ptr<RooDataSet> data(makeData(m, noZeros));
+        nfail += compare(m, nll, *data, TString::Format("dataset %d (%s)", i, noZeros ? "no empty bins" : "empty bins"), ntry);
+    }
+    printf("refreshWeights%s, %d datasets: %u attempts, %u failures\n", keepZeros ? " keeping zero weights" : "", ntoys, ntry, nfail);
+    runtimedef::set("ADDNLL_ROOREALSUM_BASICINT", 0);
+    runtimedef::set("ADDNLL_ROOREALSUM_KEEPZEROS", 0);
+    return nfail;
+}
+
+// binned toys, which are BinnedToyDataSets; while the same bins are empty, the NLL only
+// takes the new contents of the bins (setBinnedWeights), otherwise it reads the dataset.
+// The first toys have many events in every bin, the others leave empty bins that change
+// from toy to toy.
+unsigned int testBinnedToys(Model &m, int ntoys) {
+    toymcoptutils::SimPdfGenInfo gen(*m.pdf, m.obs, /*preferBinned=*/true);
+    gen.setCopyData(false);
+    RooRealVar *weightVar = 0;
+    std::unique_ptr<RooDataSet> first(makeData(m, true));
+    cacheutils::CachingSimNLL nll(m.pdf, first.get(), &m.nuis);
+    unsigned int ntry = 0, nfail = 0, nsame = 0, nchanged = 0;
+    std::vector<bool> pattern, lastPattern;
+    for (int i = 0; i < ntoys; ++i) {
+        m.bkgScale->setVal(i < ntoys / 2 ? 50 : 1);
+        std::unique_ptr<RooAbsData> toy(gen.generate(weightVar));
+        m.bkgScale->setVal(1);
+        if (typeid(*toy) != typeid(BinnedToyDataSet)) {
+            printf("toy %d: got a %s, not a BinnedToyDataSet\n", i, toy->ClassName());
+            nfail++; ntry++;
+            continue;
+        }
+        pattern.clear();
+        for (int j = 0, n = toy->numEntries(); j < n; ++j) {
+            toy->get(j);
+            pattern.push_back(toy->weight() > 0);
+        }
+        if (i > 0) (pattern == lastPattern ? nsame : nchanged)++;
+        lastPattern.swap(pattern);
+        nfail += compare(m, nll, *toy, TString::Format("toy %d", i), ntry);
+    }
+    printf("binned toys, %d toys (%u with the same empty bins as the one before, %u with other ones): %u attempts, %u failures\n", ntoys, nsame, nchanged, ntry, nfail);
+    delete weightVar;
+    return nfail;
+}
+
+int main(int argc, char **argv) {
+    RooRandom::randomGenerator()->SetSeed(42);
+    int ntoys = argc >= 2 ? atoi(argv[1]) : 20;
+    Model m = makeModel();
+    unsigned int nfail = 0;
+    nfail += testRefreshWeights(m, ntoys, false);
+    nfail += testRefreshWeights(m, ntoys, true);
+    nfail += testBinnedToys(m, ntoys);
+    return nfail == 0 ? 0 : 1;
+}
@@ -2,6 +2,8 @@
 #include <cstdio>
 #include <TMath.h>
 #include <TFile.h>
+#include <TH1F.h>
+#include <TList.h>
 #include <TStopwatch.h>
 #include <RooWorkspace.h>
 #include <RooRealVar.h>
@@ -65,6 +67,53 @@ double testPerformances(PdfT &pdf, RooAbsData &data, RooAbsData &nuisdata) {
     return time;
 }
 
+// Change one nuisance at a time for many steps, which FastVerticalInterpHistPdf2 applies as a delta
+// on the sum of the morphs (with a full recomputation every so often), and compare each time with
+// a fresh clone, which starts from a full recomputation.
+unsigned int testIncrementalUpdates(int steps, int smoothAlgo)
+{
+    const int nbins = 12, ndim = 4;
+    RooRealVar x("x", "x", 0, 12);
+    x.setBins(nbins);
+    TList hists;
+    hists.SetOwner(true);
+    for (int k = 0; k <= 2*ndim; ++k) {
+        TH1F *h = new TH1F(TString::Format("h%d", k), "", nbins, 0, 12);
+        h->SetDirectory(0);
+        for (int b = 1; b <= nbins; ++b) {
+            double nominal = 10 * exp(-0.2 * b) + 1;
+            // up and down variations of nuisance (k+1)/2, each shifting a different part of the spectrum
+            double shift = (k == 0 ? 0 : 0.02 * ((k+1)/2) * (k % 2 ? +1 : -1) * (b % ((k+1)/2 + 1) + 1));
+            h->SetBinContent(b, nominal * (1 + shift));
+        }
+        hists.Add(h);
+    }
+    RooArgList thetas;
+    for (int i = 0; i < ndim; ++i) thetas.addOwned(*new RooRealVar(TString::Format("theta%d", i), "", 0, -5, 5));
+    FastVerticalInterpHistPdf2 pdf("pdf", "", x, hists, thetas, 1., smoothAlgo);
+    RooArgSet obs(x);
+
+    unsigned int ntry = 0, nfail = 0;
+    for (int step = 0; step < steps; ++step) {
+        RooRealVar *theta = (RooRealVar *) thetas.at(step % 7 == 6 ? 0 : int(RooRandom::uniform() * ndim));
+        theta->setVal(RooRandom::randomGenerator()->Gaus(0, 1.5));
+        RooAbsPdf *fresh = (RooAbsPdf *) pdf.clone("fresh");
+        for (int b = 0; b < nbins; ++b) {
+            x.setVal(b + 0.5);
+            double yincr = pdf.getVal(&obs), yfull = fresh->getVal(&obs);
+            bool ok = fabs(yincr - yfull) <= 1e-9 * (fabs(yincr) + fabs(yfull)) + 1e-12;
+            ntry++;
+            if (!ok) {
+                printf("step %d bin %d: full %12.8g, incremental %12.8g\n", step, b, yfull, yincr);
+                nfail++;
+            }
+        }
+        delete fresh;
+    }
+    printf("FastVerticalInterpHistPdf2 (smoothAlgo %d), %d steps: %u attempts, %u failures\n", smoothAlgo, steps, ntry, nfail);
+    return nfail;
+}
+
 void testPdfs(RooStats::ModelConfig &mc, RooAbsData *data, int tries, bool performances) {
     RooAbsPdf *nuispdf = utils::makeNuisancePdf(mc);
     RooAbsData *nuisdata = nuispdf->generate(*mc.GetNuisanceParameters(), tries);
@@ -120,7 +169,10 @@ int main(int argc, char **argv) {
                         argc >= 4 ? argv[3] : "w",  
                         argc >= 5 ? argv[4] : "data_obs", 
                         argc >= 6 ? argv[5] : "ModelConfig");
+            return 0;
         } 
     }
-    return 0;
+    int steps = argc >= 2 ? atoi(argv[1]) : 1000;
+    unsigned int nfail = testIncrementalUpdates(steps, 1) + testIncrementalUpdates(steps, -1);
+    return nfail == 0 ? 0 : 1;
 }
@@ -0,0 +1,61 @@
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <TH1.h>
+#include <RooRealVar.h>
+#include <RooBinning.h>
+#include <RooGaussian.h>
+#include <RooExponential.h>
+#include <RooAddPdf.h>
+#include <RooRandom.h>
+#include "HiggsAnalysis/CombinedLimit/interface/FitDiagnostics.h"
+
+// Compare the binned shapes of FitDiagnostics::evalBinnedShape with those of
+// createHistogram + Scale(norm/Integral("width")), on uniform and variable bins
+unsigned int testShape(RooAbsPdf &pdf, RooRealVar &x, RooArgList &params, int tries) {
+    unsigned int nfail = 0;
+    int nbins = x.getBinning().numBins();
+    std::vector<double> fast(nbins);
+    for (int t = 0; t < tries; ++t) {
+        for (int ip = 0, np = params.getSize(); ip < np; ++ip) {
+            RooRealVar *p = (RooRealVar *) params.at(ip);
+            p->setVal(p->getMin() + RooRandom::uniform() * (p->getMax() - p->getMin()));
+        }
+        double norm = 10 + 1000 * RooRandom::uniform();
+        std::unique_ptr<TH1> hist(pdf.createHistogram(pdf.GetName(), x));
+        hist->Scale(norm / hist->Integral("width"));
+        FitDiagnostics::evalBinnedShape(pdf, x, norm, nbins, &fast[0]);
+        for (int b = 0; b < nbins; ++b) {
+            double slow = hist->GetBinContent(b+1);
+            if (std::abs(slow - fast[b]) > 1e-9 * (std::abs(slow) + 1e-6)) {
+                printf("try %d bin %d: createHistogram %12.6g, evalBinnedShape %12.6g\n", t, b, slow, fast[b]);
+                nfail++;
+            }
+        }
+    }
+    printf("%s, %d bins: %d attempts, %u failures\n", x.getBinning().isUniform() ? "uniform" : "variable", nbins, tries*nbins, nfail);
+    return nfail;
+}
+
+int main(int argc, char **argv) {
+    RooRandom::randomGenerator()->SetSeed(42);
+    int tries = argc >= 2 ? atoi(argv[1]) : 20;
+    RooRealVar x("x", "x", 0, 0, 100);
+    RooRealVar mean("mean", "mean", 50, 30, 70), sigma("sigma", "sigma", 10, 5, 20);
+    RooRealVar slope("slope", "slope", -0.05, -0.1, -0.01), frac("frac", "frac", 0.3, 0.1, 0.9);
+    RooGaussian gaus("gaus", "gaus", x, mean, sigma);
+    RooExponential expo("expo", "expo", x, slope);
+    RooAddPdf pdf("pdf", "pdf", RooArgList(gaus, expo), RooArgList(frac));
+    RooArgList params(mean, sigma, slope, frac);
+
+    unsigned int nfail = 0;
+    x.setBins(25);
+    nfail += testShape(pdf, x, params, tries);
+
+    double edges[] = { 0, 2, 5, 10, 20, 30, 35, 40, 45, 50, 55, 60, 70, 85, 100 };
+    RooBinning variable(sizeof(edges)/sizeof(edges[0]) - 1, edges);
+    x.setBinning(variable);
+    nfail += testShape(pdf, x, params, tries);
+
+    return nfail == 0 ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <typeinfo>
+#include <vector>
+#include <TH1D.h>
+#include <RooRealVar.h>
+#include <RooFormulaVar.h>
+#include <RooProduct.h>
+#include <RooCategory.h>
+#include <RooBinning.h>
+#include <RooDataSet.h>
+#include <RooRealSumPdf.h>
+#include <RooRandom.h>
+#include <RooWorkspace.h>
+#include <RooMsgService.h>
+#include <RooStats/ModelConfig.h>
+#include "HiggsAnalysis/CombinedLimit/interface/Combine.h"
+#include "HiggsAnalysis/CombinedLimit/interface/GoodnessOfFit.h"
+#include "HiggsAnalysis/CombinedLimit/interface/RooSimultaneousOpt.h"
+#include "HiggsAnalysis/CombinedLimit/interface/SimpleGaussianConstraint.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistFunc.h"
+#include "HiggsAnalysis/CombinedLimit/interface/CMSHistErrorPropagator.h"
+#include "HiggsAnalysis/CombinedLimit/interface/ToyMCSamplerOpt.h"
+#include "HiggsAnalysis/CombinedLimit/interface/BinnedToyData.h"
+
+// Compare the saturated goodness of fit computed with runSaturatedModelAnalytic, which keeps
+// one NLL across datasets and takes the saturated NLL from the channel weights, with the one
+// of runSaturatedModel, which builds a saturated pdf for each dataset.
+// The model is like a combine binned model: a RooSimultaneousOpt of RooRealSumPdfs of
+// CMSHistErrorPropagators with gaussian constraints, one channel with variable bins, one with
+// few events per bin, so that many bins are empty, and one masked channel.
+// The datasets are the observed data, datasets with the same entries and new weights
+// (refreshWeights) and binned toys (BinnedToyDataSet, setBinnedWeights).
+
+// Gives access to the NLL kept by the analytic saturated model, to detect a fall back
+class GoodnessOfFitCheck : public GoodnessOfFit {
+    public:
+        GoodnessOfFitCheck(bool analytic) { analyticSaturated_ = analytic; }
+        bool analytic() const { return analyticSaturated_ && saturatedNominalNLL_.get() != 0; }
+};
+
+struct Model {
+    RooCategory *cat;
+    std::vector<RooRealVar *> xs;
+    std::vector<std::vector<double>> expected;  // events per bin at the initial point, used to make the data
+    RooArgSet obs, nuis, params;
+    RooRealVar *bkgScale;  // constant, to generate toys with more events
+    RooSimultaneousOpt *pdf;
+    RooArgList masks;
+};
+
+TH1D *makeHist(const char *name, const RooRealVar &x, double norm, double slope, double peak) {
+    const RooAbsBinning &bins = x.getBinning();
+    TH1D *h = new TH1D(name, "", bins.numBins(), bins.array());
+    h->SetDirectory(0);
+    for (int b = 1; b <= h->GetNbinsX(); ++b) {
+        double c = h->GetBinCenter(b), w = h->GetBinWidth(b);
+        double y = w * (std::exp(-slope * (c - x.getMin()) / (x.getMax() - x.getMin())) + peak * std::exp(-0.5 * std::pow((c - 0.5 * (x.getMin() + x.getMax())) / (0.1 * (x.getMax() - x.getMin())), 2)));
+        h->SetBinContent(b, y);
+    }
+    h->Scale(norm / h->Integral());
+    for (int b = 1; b <= h->GetNbinsX(); ++b) h->SetBinError(b, 0.1 * std::sqrt(h->GetBinContent(b)));
+    return h;
+}
+
+// background with a vertical shape morph on theta, signal scaled by r; the objects live as long as the program
+void addChannel(Model &m, const char *label, RooRealVar *x, double nsig, double nbkg, RooRealVar &r, RooRealVar &theta, bool masked) {
+    m.cat->defineType(label);
+    m.xs.push_back(x);
+    m.obs.add(*x);
+    TString ch(label);
+    std::unique_ptr<TH1D> sig(makeHist("sig_"+ch, *x, nsig, 0, 20)), bkg(makeHist("bkg_"+ch, *x, nbkg, 3, 0));
+    std::unique_ptr<TH1D> bkgUp(makeHist("bkg_"+ch+"_up", *x, 1.1 * nbkg, 2.5, 0)), bkgDown(makeHist("bkg_"+ch+"_down", *x, 0.9 * nbkg, 3.5, 0));
+    CMSHistFunc *fsig = new CMSHistFunc("shape_sig_"+ch, "", *x, *sig);
+    CMSHistFunc *fbkg = new CMSHistFunc("shape_bkg_"+ch, "", *x, *bkg);
+    fbkg->setVerticalMorphs(RooArgList(theta));
+    fbkg->prepareStorage();
+    fbkg->setShape(0, 0, 0, 0, *bkg);
+    fbkg->setShape(0, 0, 1, 0, *bkgDown);
+    fbkg->setShape(0, 0, 1, 1, *bkgUp);
+    // per-channel normalization nuisance, like a lnN
+    RooRealVar *nu = new RooRealVar("nu_"+ch, "", 0, -4, 4);
+    RooRealVar *nuIn = new RooRealVar("nu_"+ch+"_In", "", 0, -4, 4);
+    nuIn->setConstant(true);
+    RooRealVar *one = new RooRealVar("one_"+ch, "", 1);
+    one->setConstant(true);
+    m.nuis.add(*nu);
+    m.params.add(*nu);
+    m.pdf->addExtraConstraint(*new SimpleGaussianConstraint("nu_"+ch+"_Pdf", "", *nu, *nuIn, *one));
+    RooAbsReal *csig = new RooProduct("n_sig_"+ch, "", RooArgList(r));
+    RooAbsReal *cbkg = new RooFormulaVar("n_bkg_"+ch, "", "@1*pow(1.1,@0)", RooArgList(*nu, *m.bkgScale));
+    CMSHistErrorPropagator *prop = new CMSHistErrorPropagator("prop_"+ch, "", *x, RooArgList(*fsig, *fbkg), RooArgList(*csig, *cbkg));
+    prop->setAttribute("CachingPdf_Direct", true);
+    RooRealSumPdf *sum = new RooRealSumPdf("pdf_bin"+ch, "", RooArgList(*prop), RooArgList(*one), true);
+    m.pdf->addPdf(*sum, label);
+    RooRealVar *mask = new RooRealVar("mask_"+ch, "", masked ? 1 : 0);
+    mask->setConstant(true);
+    m.masks.add(*mask);
+    std::vector<double> exp(x->getBins());
+    for (int b = 0; b < x->getBins(); ++b) exp[b] = sig->GetBinContent(b+1) + bkg->GetBinContent(b+1);
+    m.expected.push_back(exp);
+}
+
+// the model is imported in the workspace, as ModelConfig needs, and the returned Model points to the copies there
+Model makeModel(RooWorkspace &w) {
+    Model m;
+    m.cat = new RooCategory("CMS_channel", "");
+    m.pdf = new RooSimultaneousOpt("model_s", "", *m.cat);
+    RooRealVar *r = new RooRealVar("r", "", 1, 0, 5);
+    RooRealVar *theta = new RooRealVar("theta", "", 0, -4, 4);
+    RooRealVar *thetaIn = new RooRealVar("theta_In", "", 0, -4, 4);
+    RooRealVar *one = new RooRealVar("one", "", 1);
+    thetaIn->setConstant(true); one->setConstant(true);
+    m.bkgScale = new RooRealVar("bkgScale", "", 1);
+    m.bkgScale->setConstant(true);
+    m.nuis.add(*theta);
+    m.params.add(*r); m.params.add(*theta);
+    m.pdf->addExtraConstraint(*new SimpleGaussianConstraint("theta_Pdf", "", *theta, *thetaIn, *one));
+
+    RooRealVar *x1 = new RooRealVar("x1", "", 0, 10);
+    x1->setBins(10);
+    addChannel(m, "ch1", x1, 50, 1000, *r, *theta, false);
+
+    const double edges2[] = { 0, 1, 2, 4, 7, 12, 20 };
+    RooRealVar *x2 = new RooRealVar("x2", "", 0, 20);
+    x2->setBinning(RooBinning(6, edges2));
+    addChannel(m, "ch2", x2, 10, 40, *r, *theta, false);
+
+    RooRealVar *x3 = new RooRealVar("x3", "", 0, 8);
+    x3->setBins(8);
+    addChannel(m, "ch3", x3, 1, 4, *r, *theta, false);
+
+    RooRealVar *x4 = new RooRealVar("x4", "", 0, 10);
+    x4->setBins(5);
+    addChannel(m, "ch4", x4, 20, 200, *r, *theta, true);
+
+    m.pdf->addChannelMasks(m.masks);
+    m.obs.add(*m.cat);
+
+    w.import(*m.pdf);
+    Model ret;
+    ret.cat = w.cat(m.cat->GetName());
+    for (RooRealVar *x : m.xs) ret.xs.push_back(w.var(x->GetName()));
+    ret.expected = m.expected;
+    for (RooRealVar *x : ret.xs) ret.obs.add(*x);
+    ret.obs.add(*ret.cat);
+    RooFIter iter = m.nuis.fwdIterator();
+    for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) ret.nuis.add(*w.var(a->GetName()));
+    iter = m.params.fwdIterator();
+    for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) ret.params.add(*w.var(a->GetName()));
+    ret.bkgScale = w.var(m.bkgScale->GetName());
+    ret.pdf = dynamic_cast<RooSimultaneousOpt *>(w.pdf(m.pdf->GetName()));
+    return ret;
+}
+
+// one entry per bin center, with Poisson weights
+RooDataSet *makeData(Model &m) {
+    RooRealVar weight("_weight_", "", 1);
+    RooArgSet vars(m.obs); vars.add(weight);
+    RooDataSet *data = new RooDataSet("data", "", vars, "_weight_");
+    for (unsigned int ich = 0; ich < m.xs.size(); ++ich) {
+        m.cat->setIndex(ich);
+        RooRealVar *x = m.xs[ich];
+        for (int b = 0; b < x->getBins(); ++b) {
+            x->setVal(x->getBinning().binCenter(b));
+            data->add(m.obs, RooRandom::randomGenerator()->Poisson(m.expected[ich][b]));
+        }
+    }
+    return data;
+}
+
+RooDataSet *plainCopy(const RooAbsData &data) {
+    RooRealVar weight("_weight_", "", 1);
+    RooArgSet vars(*data.get()); vars.add(weight);
+    RooDataSet *ret = new RooDataSet("plain", "", vars, "_weight_");
+    for (int i = 0, n = data.numEntries(); i < n; ++i) {
+        const RooArgSet *entry = data.get(i);
+        ret->add(*entry, data.weight());
+    }
+    return ret;
+}
+
+// data goes to the analytic saturated model as it is, and a plain copy of it to the saturated pdf;
+// both start the fits from the same parameters
+unsigned int compare(Model &m, RooWorkspace &w, RooStats::ModelConfig &mc, GoodnessOfFitCheck &analytic, RooAbsData &data, const char *what, unsigned int &ntry) {
+    RooArgSet snap; m.params.snapshot(snap);
+    double limitErr = 0, fast = NAN, full = NAN;
+    bool okFast = analytic.runSaturatedModelAnalytic(&w, &mc, &mc, data, fast, limitErr, 0);
+    bool stillAnalytic = analytic.analytic();
+    m.params = snap;
+    std::unique_ptr<RooDataSet> plain(plainCopy(data));
+    GoodnessOfFitCheck saturatedPdf(false);
+    bool okFull = saturatedPdf.runSaturatedModel(&w, &mc, &mc, *plain, full, limitErr, 0);
+    m.params = snap;
+    ntry++;
+    if (!okFast || !okFull || !stillAnalytic || !(std::abs(fast - full) <= 1e-4 * std::abs(full) + 2e-3)) {
+        printf("%s: analytic %.6f (%s%s), saturated pdf %.6f (%s), diff %.3g\n", what, fast, okFast ? "ok" : "failed",
+                stillAnalytic ? "" : ", fell back to the saturated pdf", full, okFull ? "ok" : "failed", fast - full);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    RooRandom::randomGenerator()->SetSeed(42);
+    RooMsgService::instance().setGlobalKillBelow(RooFit::WARNING);
+    int ntoys = argc >= 2 ? atoi(argv[1]) : 10;
+    verbose = 0; withSystematics = true;
+
+    RooWorkspace w("w", "w");
+    Model m = makeModel(w);
+    RooStats::ModelConfig mc("ModelConfig", &w);
+    mc.SetPdf(*m.pdf);
+    mc.SetObservables(m.obs);
+    mc.SetParametersOfInterest(RooArgSet(*w.var("r")));
+    mc.SetNuisanceParameters(m.nuis);
+
+    GoodnessOfFitCheck analytic(true);
+    unsigned int ntry = 0, nfail = 0;
+
+    std::unique_ptr<RooDataSet> data(makeData(m));
+    nfail += compare(m, w, mc, analytic, *data, "data", ntry);
+
+    // same entries, new weights: refreshWeights
+    for (int i = 0; i < ntoys; ++i) {
+        std::unique_ptr<RooDataSet> toy(makeData(m));
+        nfail += compare(m, w, mc, analytic, *toy, TString::Format("dataset %d", i), ntry);
+    }
+
+    // binned toys, first with many events in every bin (also in the fits) and then with empty
+    // bins that change from toy to toy: setBinnedWeights, or a full setData when the empty bins change
+    toymcoptutils::SimPdfGenInfo gen(*m.pdf, m.obs, /*preferBinned=*/true);
+    gen.setCopyData(false);
+    RooRealVar *weightVar = 0;
+    for (int i = 0; i < ntoys; ++i) {
+        m.bkgScale->setVal(i < ntoys / 2 ? 50 : 1);
+        std::unique_ptr<RooAbsData> toy(gen.generate(weightVar));
+        if (typeid(*toy) != typeid(BinnedToyDataSet)) {
+            printf("toy %d: got a %s, not a BinnedToyDataSet\n", i, toy->ClassName());
+            nfail++; ntry++;
+        } else {
+            nfail += compare(m, w, mc, analytic, *toy, TString::Format("binned toy %d", i), ntry);
+        }
+        m.bkgScale->setVal(1);
+    }
+    delete weightVar;
+
+    printf("saturated model, data and %d + %d toys: %u attempts, %u failures\n", ntoys, ntoys, ntry, nfail);
+    return nfail == 0 ? 0 : 1;
+}
@@ -1,12 +1,24 @@
 #include <cmath>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
 #include <TMath.h>
 #include <TFile.h>
 #include <TStopwatch.h>
 #include <RooWorkspace.h>
 #include <RooRealVar.h>
+#include <RooCategory.h>
+#include <RooFormulaVar.h>
 #include <RooDataSet.h>
 #include <RooAbsPdf.h>
+#include <RooGaussian.h>
+#include <RooExponential.h>
+#include <RooAddPdf.h>
+#include <RooProdPdf.h>
+#include <RooExtendPdf.h>
+#include <RooSimultaneous.h>
 #include <RooRandom.h>
 #include <RooMinimizer.h>
 #include <RooFitResult.h>
@@ -105,6 +117,115 @@ void runPerf(const char *opt, const char *n, const char *file, const char *wsp,
     runPerfTS(strstr(opt,"opt") != NULL, *mc, data, atoi(n));
 }
 
+// ===== In-place check of the cache of SimplerLikelihoodRatioTestStatOpt across toys.
+//       SLRTSO_NO_CACHE is read once per process, so the uncached reference is a new
+//       test statistics for every evaluation, which has nothing in the cache yet.
+
+bool differ(double ref, double cached) {
+    return !(std::abs(ref - cached) <= 1e-9 * std::abs(ref) + 1e-8);
+}
+
+// refill toy with the same entries (x at the bin centers, in each channel) and new poisson weights,
+// so that the number of events and which entries are empty change from one toy to the next
+void fillWeightedToy(RooDataSet &toy, RooRealVar &x, RooCategory *cat, const std::vector<std::vector<double> > &mu) {
+    toy.reset();
+    RooArgSet entry(x); if (cat) entry.add(*cat);
+    for (int c = 0, nc = mu.size(); c < nc; ++c) {
+        if (cat) cat->setIndex(c);
+        for (int b = 0, nb = mu[c].size(); b < nb; ++b) {
+            x.setVal(x.getMin() + (b + 0.5) * (x.getMax() - x.getMin()) / nb);
+            toy.add(entry, RooRandom::randomGenerator()->Poisson(mu[c][b]));
+        }
+    }
+}
+
+unsigned int compareCached(SimplerLikelihoodRatioTestStatOpt &optTS, RooAbsData &data, const RooArgSet &obs, RooAbsPdf &pdf,
+                           const RooArgSet &snapB, const RooArgSet &snapS, RooArgSet &nullPOI, int toy, unsigned int &ntry) {
+    SimplerLikelihoodRatioTestStatOpt freshTS(obs, pdf, pdf, snapB, snapS);
+    double ref = freshTS.Evaluate(data, nullPOI);
+    unsigned int nfail = 0;
+    // the second evaluation on the same data and parameters comes all from the cache
+    for (int again = 0; again < 2; ++again, ++ntry) {
+        double cached = optTS.Evaluate(data, nullPOI);
+        if (differ(ref, cached)) {
+            printf("%s, toy %d (%d entries, sum of weights %.1f), evaluation %d: uncached %+14.8g, cached %+14.8g\n",
+                    pdf.GetName(), toy, data.numEntries(), data.sumEntries(), again, ref, cached);
+            nfail++;
+        }
+    }
+    return nfail;
+}
+
+unsigned int runCacheCheck(RooAbsPdf &pdf, RooRealVar &x, RooCategory *cat, RooRealVar &r, RooRealVar &nu, int ntoys) {
+    RooArgSet obs(x); if (cat) obs.add(*cat);
+    nu.setVal(0.3);
+    r.setVal(0);   RooArgSet snapB; snapB.addClone(r); snapB.addClone(nu);
+    r.setVal(1.0); RooArgSet snapS; snapS.addClone(r); snapS.addClone(nu);
+    RooArgSet nullPOI; nullPOI.addClone(r);
+    RooRealVar *nullR = (RooRealVar *) nullPOI.first();
+    SimplerLikelihoodRatioTestStatOpt optTS(obs, pdf, pdf, snapB, snapS);
+
+    // expected events at the bin centers, some small enough to give empty entries often
+    int nchann = cat ? cat->numTypes() : 1, nbins = 20;
+    std::vector<std::vector<double> > mu(nchann, std::vector<double>(nbins));
+    for (int c = 0; c < nchann; ++c) {
+        for (int b = 0; b < nbins; ++b) mu[c][b] = (c ? 0.2 : 5.0) * std::exp(-0.15 * b) + (b == 10 ? 1.0 : 0.0);
+    }
+    RooRealVar weight("weight", "", 1);
+    RooArgSet toyVars(obs); toyVars.add(weight);
+    RooDataSet weighted("weighted", "", toyVars, RooFit::WeightVar(weight));
+
+    unsigned int ntry = 0, nfail = 0;
+    for (int toy = 0; toy < ntoys; ++toy) {
+        // mostly toys with the same entries as the previous one, and now and then an unbinned toy with new entries
+        std::unique_ptr<RooAbsData> unbinned;
+        if (toy % 7 == 6) {
+            r.setVal(0); nu.setVal(0.3);
+            unbinned.reset(pdf.generate(obs, RooFit::Extended()));
+        } else {
+            fillWeightedToy(weighted, x, cat, mu);
+        }
+        RooAbsData &data = unbinned.get() ? *unbinned : (RooAbsData &) weighted;
+        // the null hypothesis at a different point changes only one of the two cached NLLs
+        nullR->setVal(0);
+        nfail += compareCached(optTS, data, obs, pdf, snapB, snapS, nullPOI, toy, ntry);
+        nullR->setVal(0.5);
+        nfail += compareCached(optTS, data, obs, pdf, snapB, snapS, nullPOI, toy, ntry);
+    }
+    printf("%s (%s), %d toys: %u attempts, %u failures\n", pdf.GetName(), pdf.ClassName(), ntoys, ntry, nfail);
+    return nfail;
+}
+
+unsigned int runCacheChecks(int ntoys) {
+    RooRealVar x("x", "x", 0, 10);
+    RooRealVar r("r", "r", 1, 0, 5);
+    RooRealVar nu("nu", "nu", 0, -4, 4), nu0("nu0", "", 0); nu0.setConstant(true);
+    RooRealVar mean("mean", "", 5), sigma("sigma", "", 0.5), slope("slope", "", -0.3), slope2("slope2", "", -0.1);
+    RooFormulaVar nsig("nsig", "20*@0", RooArgList(r));
+    RooFormulaVar nbkg("nbkg", "60*pow(1.1,@0)", RooArgList(nu));
+    RooFormulaVar nbkg2("nbkg2", "4*pow(1.2,@0)", RooArgList(nu));
+    RooGaussian sig("sig", "", x, mean, sigma);
+    RooExponential bkg("bkg", "", x, slope), bkg2("bkg2", "", x, slope2);
+    RooAddPdf sb("sb", "", RooArgList(sig, bkg), RooArgList(nsig, nbkg));
+    RooGaussian constr("nu_pdf", "", nu, nu0, RooFit::RooConst(1));
+    // constraint factorized away by the test statistics, extended terms from the RooAddPdf
+    RooProdPdf single("single", "", RooArgList(sb, constr));
+
+    // two channels with extended pdfs, the second with few events, and the constraint in each channel
+    RooCategory cat("channel", "channel");
+    cat.defineType("sr"); cat.defineType("cr");
+    RooExtendPdf cr("cr", "", bkg2, nbkg2);
+    RooProdPdf crc("crc", "", RooArgList(cr, constr));
+    RooSimultaneous sim("sim", "", cat);
+    sim.addPdf(single, "sr");
+    sim.addPdf(crc, "cr");
+
+    unsigned int nfail = 0;
+    nfail += runCacheCheck(single, x, 0, r, nu, ntoys);
+    nfail += runCacheCheck(sim, x, &cat, r, nu, ntoys);
+    return nfail;
+}
+
 
 int main(int argc, char **argv) {
     RooRandom::randomGenerator()->SetSeed(42);
@@ -123,12 +244,15 @@ int main(int argc, char **argv) {
                     argc >= 7 ? argv[6] : "ModelConfig");
         }
     } else {
+        unsigned int nfail = runCacheChecks(100);
         printf("usage: \n");
         printf("   - testSimplerLikelihoodRatioTestStatOpt rootfile [ N workspaceName dataName  modelConfig ]\n");
         printf("     run N times both test statistics, and compare values and times\n");
         printf("   - testSimplerLikelihoodRatioTestStatOpt (opt|plain) N rootfile [ workspaceName dataName  modelConfig ]\n");
         printf("     run N times the opt or plain test statistics, and print out total time\n");
         printf("defaults: N = 10, workspaceName = 'w', dataName = 'data_obs', modelConfig = 'ModelConfig'\n");
+        printf("without arguments, compare the cached and uncached evaluation on toys of an in-place model\n");
+        return nfail == 0 ? 0 : 1;
     }
     return 0;
 }
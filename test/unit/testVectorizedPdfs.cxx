@@ -0,0 +1,286 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <TFile.h>
+#include <TH1F.h>
+#include <TMath.h>
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooDataSet.h>
+#include <RooDataHist.h>
+#include <RooAbsPdf.h>
+#include <RooCBShape.h>
+#include <RooRandom.h>
+#include <RooStats/ModelConfig.h>
+#include "HiggsAnalysis/CombinedLimit/interface/CachingNLL.h"
+#include "HiggsAnalysis/CombinedLimit/interface/ProfilingTools.h"
+#include "HiggsAnalysis/CombinedLimit/interface/utils.h"
+#include "HiggsAnalysis/CombinedLimit/interface/FastTemplateFunc.h"
+#include "HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_1D_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_2D_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/HZZ4L_RooSpinZeroPdf_phase_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/VBFHZZ4L_RooSpinZeroPdf_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/VVHZZ4L_RooSpinZeroPdf_1D_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/RooNCSpline_1D_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/RooNCSpline_2D_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/RooNCSpline_3D_fast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/RooBernsteinFast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/RooDoubleCBFast.h"
+#include "HiggsAnalysis/CombinedLimit/interface/GaussExp.h"
+
+// Compare the vectorized evaluations chosen by cacheutils::makeCachingPdf for the NLL with
+// cacheutils::CachingPdf, which calls getVal() on each entry.
+// Without arguments, pdfs built here are tested on generated datasets, binned and not;
+// with a root file, all the pdfs of the workspace are tested on its dataset.
+
+bool differ(double slow, double fast, double tol) {
+    return !(std::abs(slow - fast) <= tol * (std::abs(slow) + std::abs(fast)) + 1e-12);
+}
+
+void randomize(const RooArgSet &params) {
+    RooFIter iter = params.fwdIterator();
+    for (RooAbsArg *a = iter.next(); a != 0; a = iter.next()) {
+        RooRealVar *v = dynamic_cast<RooRealVar *>(a);
+        if (v == 0 || v->isConstant()) continue;
+        v->setVal(v->getMin() + RooRandom::uniform() * (v->getMax() - v->getMin()));
+    }
+}
+
+// parameters are set either at random within their ranges, or from the entries of nuisdata;
+// tol is relative, and looser for the pdfs that evaluate in single precision
+unsigned int testCachingPdf(RooAbsReal &pdf, RooAbsData &data, int tries, RooAbsData *nuisdata=0, double tol=1e-6) {
+    std::unique_ptr<RooArgSet> obs(pdf.getObservables(data)), params(pdf.getParameters(data));
+    std::unique_ptr<cacheutils::CachingPdfBase> fast(cacheutils::makeCachingPdf(&pdf, obs.get()));
+    cacheutils::CachingPdf slow(&pdf, obs.get());
+    fast->setIncludeZeroWeights(true);
+    slow.setIncludeZeroWeights(true);
+    unsigned int ntry = 0, nfail = 0;
+    for (int t = 0; t < tries; ++t) {
+        if (nuisdata) *params = *nuisdata->get(t % nuisdata->numEntries());
+        else randomize(*params);
+        const std::vector<Double_t> &yfast = fast->eval(data);
+        const std::vector<Double_t> &yslow = slow.eval(data);
+        if (yfast.size() != yslow.size()) {
+            printf("%s: %u values from the fast path, %u from the slow one\n", pdf.GetName(), unsigned(yfast.size()), unsigned(yslow.size()));
+            nfail++; ntry++;
+            continue;
+        }
+        for (unsigned int i = 0, n = yslow.size(); i < n; ++i, ++ntry) {
+            if (differ(yslow[i], yfast[i], tol)) {
+                printf("try %d entry %u: slow %12.6g, fast %12.6g\n", t, i, yslow[i], yfast[i]);
+                nfail++;
+            }
+        }
+    }
+    printf("%s (%s), %s data: %u attempts, %u failures\n", pdf.GetName(), pdf.ClassName(), data.InheritsFrom("RooDataHist") ? "binned" : "unbinned", ntry, nfail);
+    return nfail;
+}
+
+// a FastHistoFunc_f template of x with the values of f at the bin centers
+FastHistoFunc_f *makeTemplate(const char *name, RooRealVar &x, const std::function<double(double)> &f) {
+    TH1F h(name, "", 40, x.getMin(), x.getMax());
+    h.SetDirectory(0);
+    for (int b = 1; b <= h.GetNbinsX(); ++b) h.SetBinContent(b, f(h.GetBinCenter(b)));
+    FastHisto_t<Float_t> tpl(h);
+    RooArgList obs(x);
+    return new FastHistoFunc_f(name, "", obs, tpl);
+}
+
+// The spin-zero templates are made from amplitudes r_k(x) exp(i a_k(x)), so that the pdfs are
+// positive everywhere: the squares r_k^2, and the interferences 2 r_j r_k cos(a_j - a_k) and
+// 2 r_j r_k sin(a_j - a_k). VBF and VV use the expansion of (u a1 + v ai1)^4 instead.
+unsigned int runSpinZero(RooRealVar &x, RooAbsData &unbinned, RooAbsData &binned, int tries) {
+    std::function<double(double)> r[3] = { [](double x) { return 1 + x; }, [](double x) { return 1.5 - x; }, [](double x) { return 0.5 + x * x; } };
+    std::function<double(double)> a[3] = { [](double x) { return 0.; }, [](double x) { return 2 * x; }, [](double x) { return -x; } };
+    auto sq = [&](int k) { return [&, k](double x) { return r[k](x) * r[k](x); }; };
+    auto cosint = [&](int j, int k) { return [&, j, k](double x) { return 2 * r[j](x) * r[k](x) * std::cos(a[j](x) - a[k](x)); }; };
+    auto sinint = [&](int j, int k) { return [&, j, k](double x) { return 2 * r[j](x) * r[k](x) * std::sin(a[j](x) - a[k](x)); }; };
+    auto u = [](double x) { return 1 + x; };
+    auto v = [](double x) { return 1 - 0.5 * x; };
+    auto quartic = [&](int k) {
+        static const double binom[5] = { 1, 4, 6, 4, 1 };
+        return [&, k](double x) { return binom[k] * std::pow(u(x), 4 - k) * std::pow(v(x), k); };
+    };
+
+    std::vector<std::unique_ptr<RooAbsArg>> owned;
+    auto templates = [&](const char *name, const std::vector<std::function<double(double)>> &fs) {
+        RooArgList coefs;
+        for (unsigned int i = 0; i < fs.size(); ++i) {
+            owned.emplace_back(makeTemplate(TString::Format("%s_T%u", name, i), x, fs[i]));
+            coefs.add(*owned.back());
+        }
+        return coefs;
+    };
+
+    RooRealVar fai1("fai1", "", 0.2, -1, 1), fai2("fai2", "", 0.1, -0.5, 0.5);
+    RooRealVar fai1_2D("fai1_2D", "", 0.1, -0.5, 0.5);
+    RooRealVar phi1("phi1", "", 0, -TMath::Pi(), TMath::Pi()), phi2("phi2", "", 0, -TMath::Pi(), TMath::Pi());
+    RooRealVar a1("a1", "", 1, 0, 2), ai1("ai1", "", 0.5, -2, 2);
+    RooRealVar fai1_VV("fai1_VV", "", 0.2, 0, 1);
+    RooArgList obs(x);
+
+    HZZ4L_RooSpinZeroPdf_1D_fast pdf1D("spinzero_1D", "", fai1, obs,
+            templates("spinzero_1D", { sq(0), sq(1), cosint(0, 1) }));
+    HZZ4L_RooSpinZeroPdf_2D_fast pdf2D("spinzero_2D", "", fai1_2D, fai2, phi1, phi2, obs,
+            templates("spinzero_2D", { sq(0), sq(1), sq(2), cosint(0, 1), cosint(0, 2), cosint(1, 2), sinint(0, 1), sinint(0, 2), sinint(1, 2) }));
+    HZZ4L_RooSpinZeroPdf_phase_fast pdfPhase("spinzero_phase", "", fai1, phi1, obs,
+            templates("spinzero_phase", { sq(0), sq(1), cosint(0, 1), sinint(0, 1) }));
+    VBFHZZ4L_RooSpinZeroPdf_fast pdfVBF("spinzero_VBF", "", a1, ai1, obs,
+            templates("spinzero_VBF", { quartic(0), quartic(1), quartic(2), quartic(3), quartic(4) }));
+    VVHZZ4L_RooSpinZeroPdf_1D_fast pdfVV("spinzero_VV", "", fai1_VV, obs,
+            templates("spinzero_VV", { quartic(0), quartic(1), quartic(2), quartic(3), quartic(4) }));
+    RooAbsReal *pdfs[] = { &pdf1D, &pdf2D, &pdfPhase, &pdfVBF, &pdfVV };
+
+    unsigned int nfail = 0;
+    for (RooAbsReal *pdf : pdfs) {
+        nfail += testCachingPdf(*pdf, unbinned, tries, 0, 1e-5);
+        nfail += testCachingPdf(*pdf, binned, tries, 0, 1e-5);
+    }
+    return nfail;
+}
+
+// Splines in one, two and three observables, with knots that do not cover the whole range so
+// that the extrapolation is used too; the dataset has all three observables.
+unsigned int runSplines(int tries) {
+    RooRealVar x("sx", "sx", 0, 1), y("sy", "sy", 0, 1), z("sz", "sz", 0, 1);
+    RooArgSet obs(x, y, z);
+    std::unique_ptr<RooDataSet> unbinned(new RooDataSet("unbinned3D", "", obs));
+    for (int i = 0; i < 500; ++i) {
+        x.setVal(RooRandom::uniform()); y.setVal(RooRandom::uniform()); z.setVal(RooRandom::uniform());
+        unbinned->add(obs);
+    }
+    x.setBins(10); y.setBins(10); z.setBins(10);
+    std::unique_ptr<RooDataHist> binned(new RooDataHist("binned3D", "", obs));
+    for (int i = 0; i < 300; ++i) {
+        x.setVal(RooRandom::uniform()); y.setVal(RooRandom::uniform()); z.setVal(RooRandom::uniform());
+        binned->add(obs);
+    }
+
+    auto f = [](double x, double y, double z) { return 2 + std::sin(3 * x) + 0.5 * std::cos(2 * y) * (1 + z) + z * z; };
+    std::vector<Float_t> knots;
+    for (int k = 0; k < 9; ++k) knots.push_back(0.05 + 0.1125 * k);
+    std::vector<Float_t> fcn1D;
+    std::vector<std::vector<Float_t>> fcn2D(knots.size());
+    std::vector<std::vector<std::vector<Float_t>>> fcn3D(knots.size(), std::vector<std::vector<Float_t>>(knots.size()));
+    for (unsigned int i = 0; i < knots.size(); ++i) {
+        fcn1D.push_back(f(knots[i], 0.5, 0.5));
+        for (unsigned int j = 0; j < knots.size(); ++j) {
+            fcn2D[j].push_back(f(knots[i], knots[j], 0.5));
+            for (unsigned int k = 0; k < knots.size(); ++k) fcn3D[k][j].push_back(f(knots[i], knots[j], knots[k]));
+        }
+    }
+    RooNCSpline_1D_fast spline1D("spline_1D", "", x, knots, fcn1D);
+    RooNCSpline_2D_fast spline2D("spline_2D", "", x, y, knots, knots, fcn2D);
+    RooNCSpline_3D_fast spline3D("spline_3D", "", x, y, z, knots, knots, knots, fcn3D);
+    RooAbsReal *splines[] = { &spline1D, &spline2D, &spline3D };
+
+    unsigned int nfail = 0;
+    for (RooAbsReal *spline : splines) {
+        nfail += testCachingPdf(*spline, *unbinned, tries, 0, 1e-5);
+        nfail += testCachingPdf(*spline, *binned, tries, 0, 1e-5);
+    }
+    return nfail;
+}
+
+// Pdfs of a mass-like observable, on entries in random order and on a binned dataset
+// (sorted, with some empty bins)
+unsigned int runShapes(int tries) {
+    RooRealVar x("mass", "mass", 100, 180);
+    RooRealVar c1("c1", "c1", 0.5, 0.1, 5), c2("c2", "c2", 0.5, 0.1, 5), c3("c3", "c3", 0.5, 0.1, 5);
+    RooRealVar c4("c4", "c4", 0.5, 0.1, 5), c5("c5", "c5", 0.5, 0.1, 5);
+    RooBernsteinFast<1> bern1("bern1", "bern1", x, RooArgList(c1));
+    RooBernsteinFast<3> bern3("bern3", "bern3", x, RooArgList(c1, c2, c3));
+    RooBernsteinFast<5> bern5("bern5", "bern5", x, RooArgList(c1, c2, c3, c4, c5));
+    RooRealVar mean("mean", "mean", 125, 120, 130), sigma("sigma", "sigma", 2, 1, 4);
+    RooRealVar alpha1("alpha1", "alpha1", 1.5, 0.5, 3), n1("n1", "n1", 3, 1.1, 10);
+    RooRealVar alpha2("alpha2", "alpha2", 1.5, 0.5, 3), n2("n2", "n2", 3, 1.1, 10);
+    RooCBShape cb("cb", "cb", x, mean, sigma, alpha1, n1);
+    RooDoubleCBFast dcb("dcb", "dcb", x, mean, sigma, alpha1, n1, alpha2, n2);
+    GaussExp gexp("gexp", "gexp", x, mean, sigma, alpha2);
+    RooAbsPdf *pdfs[] = { &bern1, &bern3, &bern5, &cb, &dcb, &gexp };
+
+    std::unique_ptr<RooDataSet> unbinned(new RooDataSet("unbinned", "", RooArgSet(x)));
+    for (int i = 0; i < 500; ++i) {
+        x.setVal(x.getMin() + RooRandom::uniform() * (x.getMax() - x.getMin()));
+        unbinned->add(RooArgSet(x));
+    }
+    x.setBins(160);
+    std::unique_ptr<RooDataHist> binned(new RooDataHist("binned", "", RooArgSet(x)));
+    for (int i = 0; i < 200; ++i) {
+        x.setVal(RooRandom::randomGenerator()->Gaus(125, 5));
+        if (x.getVal() > x.getMin() && x.getVal() < x.getMax()) binned->add(RooArgSet(x));
+    }
+
+    unsigned int nfail = 0;
+    for (RooAbsPdf *pdf : pdfs) {
+        nfail += testCachingPdf(*pdf, *unbinned, tries);
+        nfail += testCachingPdf(*pdf, *binned, tries);
+    }
+    return nfail;
+}
+
+unsigned int runStandalone(int tries) {
+    // entries in random order, and a binned dataset with some empty bins
+    RooRealVar x("x", "x", 0, 1);
+    std::unique_ptr<RooDataSet> unbinned(new RooDataSet("unbinned", "", RooArgSet(x)));
+    for (int i = 0; i < 500; ++i) {
+        x.setVal(RooRandom::uniform());
+        unbinned->add(RooArgSet(x));
+    }
+    x.setBins(40);
+    std::unique_ptr<RooDataHist> binned(new RooDataHist("binned", "", RooArgSet(x)));
+    for (int i = 0; i < 100; ++i) {
+        x.setVal(RooRandom::randomGenerator()->Gaus(0.5, 0.15));
+        if (x.getVal() > x.getMin() && x.getVal() < x.getMax()) binned->add(RooArgSet(x));
+    }
+
+    unsigned int nfail = 0;
+    nfail += runSpinZero(x, *unbinned, *binned, tries);
+    nfail += runSplines(tries);
+    nfail += runShapes(tries);
+    return nfail;
+}
+
+unsigned int run(const char *file, int tries, const char *wsp, const char *datan, const char *mcn) {
+    TFile *f = TFile::Open(file); if (f == 0) return 1;
+    RooWorkspace *w = (RooWorkspace *) f->Get(wsp); if (w == 0) return 1;
+    RooAbsData *data = w->data(datan); if (data == 0) return 1;
+    RooStats::ModelConfig *mc = (RooStats::ModelConfig *) w->genobj(mcn); if (mc == 0) return 1;
+    std::unique_ptr<RooAbsData> nuisdata;
+    if (mc->GetNuisanceParameters() && mc->GetNuisanceParameters()->getSize()) {
+        std::unique_ptr<RooAbsPdf> nuispdf(utils::makeNuisancePdf(*mc));
+        nuisdata.reset(nuispdf->generate(*mc->GetNuisanceParameters(), tries));
+    }
+    unsigned int nfail = 0;
+    RooArgList allPdfs(w->allPdfs());
+    for (int i = 0; i < allPdfs.getSize(); ++i) {
+        RooAbsPdf *pdf = (RooAbsPdf *) allPdfs.at(i);
+        if (!pdf->dependsOn(*data->get()) || pdf->InheritsFrom("RooSimultaneous")) continue;
+        nfail += testCachingPdf(*pdf, *data, tries, nuisdata.get());
+    }
+    return nfail;
+}
+
+int main(int argc, char **argv) {
+    RooRandom::randomGenerator()->SetSeed(42);
+    // the same optimizations that combine enables by default
+    runtimedef::set("ADDNLL_CBNLL", 1);
+    runtimedef::set("ADDNLL_SPINZERONLL", 1);
+    runtimedef::set("ADDNLL_SPLINENLL", 1);
+    runtimedef::set("ADDNLL_BERNSTEINNLL", 1);
+    unsigned int nfail = 0;
+    if (argc >= 2 && strstr(argv[1], "root")) {
+        nfail = run(argv[1],
+                    argc >= 3 ? atoi(argv[2]) : 10,
+                    argc >= 4 ? argv[3] : "w",
+                    argc >= 5 ? argv[4] : "data_obs",
+                    argc >= 6 ? argv[5] : "ModelConfig");
+    } else {
+        nfail = runStandalone(argc >= 2 ? atoi(argv[1]) : 20);
+    }
+    return nfail == 0 ? 0 : 1;
+}